@@ -0,0 +1,25 @@
+#!/bin/sh
+#
+#  run_benchmark_count_mmap.sh
+#
+#  Compare reading files normally and through a memory mapping. Only PBF
+#  files are read differently in osmium_benchmark_count_mmap.
+#
+
+set -e
+
+BENCHMARK_NAME=count_mmap
+
+. @CMAKE_BINARY_DIR@/benchmarks/setup.sh
+
+echo "# file size num mem time cpu_kernel cpu_user cpu_percent cmd options"
+for data in $OB_DATA_FILES; do
+    filename=`basename $data`
+    filesize=`stat --format="%s" --dereference $data`
+    for n in $OB_SEQ; do
+        for CMD in $OB_DIR/osmium_benchmark_count $OB_DIR/osmium_benchmark_$BENCHMARK_NAME; do
+            $OB_TIME_CMD -f "$filename $filesize $n $OB_TIME_FORMAT" $CMD $data 2>&1 >/dev/null | sed -e "s%$DATA_DIR/%%" | sed -e "s%$OB_DIR/%%"
+        done
+    done
+done
+
@@ -14,6 +14,11 @@ CMD=$OB_DIR/osmium_benchmark_$BENCHMARK_NAME
 #MAPS="sparse_mem_map sparse_mem_table sparse_mem_array sparse_mmap_array sparse_file_array dense_mem_array dense_mmap_array dense_file_array"
 MAPS="sparse_mem_map sparse_mem_table sparse_mem_array sparse_mmap_array sparse_file_array"
 
+# Memory mapping flags can be appended to the mmap based maps.
+MAPS="$MAPS sparse_mmap_array,huge_pages sparse_mmap_array,huge_pages,populate"
+MAPS="$MAPS dense_mmap_array dense_mmap_array,huge_pages dense_mmap_array,huge_pages,random_access"
+MAPS="$MAPS compressed_mem"
+
 echo "# file size num mem time cpu_kernel cpu_user cpu_percent cmd options"
 for data in $OB_DATA_FILES; do
     filename=`basename $data`
@@ -13,6 +13,7 @@
   * file input
   * location indexes and the NodeLocationsForWays handler
   * location indexes on disk
+  * filling a location index directly from a PBF file
 
   SIMPLER EXAMPLES you might want to understand first:
   * osmium_read
@@ -47,6 +48,9 @@
 // For the NodeLocationForWays handler
 #include <osmium/handler/node_locations_for_ways.hpp>
 
+// For osmium::io::read_pbf_node_locations()
+#include <osmium/io/pbf_node_locations.hpp>
+
 // For osmium::apply()
 #include <osmium/visitor.hpp>
 
@@ -65,12 +69,9 @@ int main(int argc, char* argv[]) {
     }
 
     try {
-        const std::string input_filename{argv[1]};
+        const osmium::io::File input_file{argv[1]};
         const std::string cache_filename{argv[2]};
 
-        // Construct Reader reading only nodes
-        osmium::io::Reader reader{input_filename, osmium::osm_entity_bits::node};
-
         // Initialize location index on disk creating a new file.
         const int fd = ::open(cache_filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0666); // NOLINT(hicpp-signed-bitwise)
         if (fd == -1) {
@@ -82,6 +83,17 @@ int main(int argc, char* argv[]) {
 #endif
         index_type index{fd};
 
+        // PBF files can be read much faster by only decoding
+        // the node ids and locations without creating any node objects.
+        if (input_file.format() == osmium::io::file_format::pbf &&
+            input_file.compression() == osmium::io::file_compression::none) {
+            osmium::io::read_pbf_node_locations(input_file, index);
+            return 0;
+        }
+
+        // Construct Reader reading only nodes
+        osmium::io::Reader reader{input_file, osmium::osm_entity_bits::node};
+
         // The handler that stores all node locations in the index.
         location_handler_type location_handler{index};
 
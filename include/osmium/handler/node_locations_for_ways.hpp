@@ -34,17 +34,24 @@ DEALINGS IN THE SOFTWARE.
 */
 
 #include <osmium/handler.hpp>
+#include <osmium/index/detail/parallel_sort.hpp>
 #include <osmium/index/index.hpp>
 #include <osmium/index/map/dummy.hpp>
 #include <osmium/index/node_locations_map.hpp>
+#include <osmium/memory/buffer.hpp>
 #include <osmium/osm/location.hpp>
 #include <osmium/osm/node.hpp>
 #include <osmium/osm/node_ref.hpp>
 #include <osmium/osm/types.hpp>
 #include <osmium/osm/way.hpp>
+#include <osmium/thread/pool.hpp>
 
+#include <algorithm>
+#include <cstddef>
+#include <future>
 #include <limits>
 #include <type_traits>
+#include <vector>
 
 namespace osmium {
 
@@ -88,6 +95,16 @@ namespace osmium {
 
             bool m_must_sort = false;
 
+            // Scratch space for the ids and locations of the nodes of a
+            // way, reused for all ways.
+            std::vector<osmium::unsigned_object_id_type> m_ids;
+            std::vector<osmium::Location> m_locations;
+
+            // Minimum number of ways handled in one task in the pool.
+            enum : std::size_t {
+                min_ways_per_part = 500
+            };
+
             // It is okay to have this static dummy instance, even when using several threads,
             // because it is read-only.
             static dummy_type& get_dummy() {
@@ -95,6 +112,101 @@ namespace osmium {
                 return instance;
             }
 
+            void sort_if_needed() {
+                if (m_must_sort) {
+                    m_storage_pos.sort();
+                    m_storage_neg.sort();
+                    m_must_sort = false;
+                    m_last_id = std::numeric_limits<osmium::unsigned_object_id_type>::max();
+                }
+            }
+
+            // Same as sort_if_needed() but sparse indexes are sorted
+            // using the threads of the pool.
+            void sort_if_needed(osmium::thread::Pool& pool) {
+                if (m_must_sort) {
+                    osmium::index::sort(m_storage_pos, pool);
+                    osmium::index::sort(m_storage_neg, pool);
+                    m_must_sort = false;
+                    m_last_id = std::numeric_limits<osmium::unsigned_object_id_type>::max();
+                }
+            }
+
+            // Set the locations of all nodes in the list. The ids and
+            // locations vectors are used as scratch space. Returns false
+            // if any location was not found.
+            bool set_locations(osmium::WayNodeList& nodes,
+                               std::vector<osmium::unsigned_object_id_type>& ids,
+                               std::vector<osmium::Location>& locations) const {
+                // Look up all positive ids at once, so the index can
+                // overlap the memory accesses.
+                ids.clear();
+                for (const auto& node_ref : nodes) {
+                    if (node_ref.ref() >= 0) {
+                        ids.push_back(static_cast<osmium::unsigned_object_id_type>(node_ref.ref()));
+                    }
+                }
+                locations.resize(ids.size());
+                m_storage_pos.get_many(ids.data(), locations.data(), ids.size());
+
+                bool found = true;
+                auto location = locations.cbegin();
+                for (auto& node_ref : nodes) {
+                    if (node_ref.ref() >= 0) {
+                        node_ref.set_location(*location++);
+                    } else {
+                        node_ref.set_location(m_storage_neg.get_noexcept(static_cast<osmium::unsigned_object_id_type>(-node_ref.ref())));
+                    }
+                    if (!node_ref.location()) {
+                        found = false;
+                    }
+                }
+                return found;
+            }
+
+            // Set the locations of the nodes of all ways, split into
+            // several parts handled in the pool threads. Small numbers of
+            // ways are handled in the calling thread. Returns false if any
+            // location was not found.
+            bool set_locations_in_parallel(const std::vector<osmium::Way*>& ways, osmium::thread::Pool& pool) {
+                sort_if_needed(pool);
+
+                const std::size_t parts = std::min(ways.size() / min_ways_per_part,
+                                                   2 * static_cast<std::size_t>(pool.num_threads()));
+                if (parts < 2) {
+                    bool found = true;
+                    for (auto* way : ways) {
+                        found = set_locations(way->nodes(), m_ids, m_locations) && found;
+                    }
+                    return found;
+                }
+
+                std::vector<std::future<bool>> futures;
+                const std::size_t part_size = (ways.size() + parts - 1) / parts;
+                for (std::size_t first = 0; first < ways.size(); first += part_size) {
+                    const std::size_t last = std::min(first + part_size, ways.size());
+                    futures.push_back(pool.submit([this, &ways, first, last]() {
+                        std::vector<osmium::unsigned_object_id_type> ids;
+                        std::vector<osmium::Location> locations;
+                        bool found = true;
+                        for (std::size_t i = first; i < last; ++i) {
+                            found = set_locations(ways[i]->nodes(), ids, locations) && found;
+                        }
+                        return found;
+                    }));
+                }
+
+                for (const auto& future : futures) {
+                    pool.help_while_waiting(future);
+                }
+
+                bool found = true;
+                for (auto& future : futures) {
+                    found = future.get() && found;
+                }
+                return found;
+            }
+
         public:
 
             explicit NodeLocationsForWays(TStoragePosIDs& storage_pos,
@@ -155,20 +267,52 @@ namespace osmium {
              * them to the way object.
              */
             void way(osmium::Way& way) {
-                if (m_must_sort) {
-                    m_storage_pos.sort();
-                    m_storage_neg.sort();
-                    m_must_sort = false;
-                    m_last_id = std::numeric_limits<osmium::unsigned_object_id_type>::max();
+                sort_if_needed();
+                const bool found = set_locations(way.nodes(), m_ids, m_locations);
+                if (!m_ignore_errors && !found) {
+                    throw osmium::not_found{"location for one or more nodes not found in node location index"};
                 }
-                bool error = false;
-                for (auto& node_ref : way.nodes()) {
-                    node_ref.set_location(get_node_location(node_ref.ref()));
-                    if (!node_ref.location()) {
-                        error = true;
+            }
+
+            /**
+             * Handle all nodes and ways in the buffer. The nodes are stored
+             * in the calling thread as node() does. The ways are split into
+             * several parts and the locations of their nodes are retrieved
+             * in the threads of the pool. Other objects are ignored.
+             *
+             * This only reads from the location indexes while the ways are
+             * handled, so they must be safe for concurrent reading, which
+             * all index maps in libosmium are. Sparse indexes are sorted
+             * in the threads of the pool first if needed.
+             *
+             * If there are nodes after ways in the buffer, the ways before
+             * them are handled first, so the result is the same as calling
+             * node() and way() for all objects in order. The only
+             * difference is that, if a location is not found, all ways
+             * still get their locations before the exception is thrown.
+             *
+             * @param buffer The buffer with the nodes and ways.
+             * @param pool The thread pool to use.
+             * @throws osmium::not_found If a location was not found and
+             *                           ignore_errors() wasn't called.
+             */
+            void handle_buffer(osmium::memory::Buffer& buffer, osmium::thread::Pool& pool = osmium::thread::Pool::default_instance()) {
+                bool found = true;
+                std::vector<osmium::Way*> ways;
+                for (auto& item : buffer) {
+                    if (item.type() == osmium::item_type::node) {
+                        if (!ways.empty()) {
+                            found = set_locations_in_parallel(ways, pool) && found;
+                            ways.clear();
+                        }
+                        node(static_cast<const osmium::Node&>(item));
+                    } else if (item.type() == osmium::item_type::way) {
+                        ways.push_back(&static_cast<osmium::Way&>(item));
                     }
                 }
-                if (!m_ignore_errors && error) {
+                found = set_locations_in_parallel(ways, pool) && found;
+
+                if (!m_ignore_errors && !found) {
                     throw osmium::not_found{"location for one or more nodes not found in node location index"};
                 }
             }
@@ -33,8 +33,12 @@ DEALINGS IN THE SOFTWARE.
 
 */
 
+#include <osmium/index/map.hpp>
+#include <osmium/util/memory_mapping.hpp>
+
 #include <cassert>
 #include <cerrno>
+#include <cstddef>
 #include <fcntl.h>
 #include <stdexcept>
 #include <string>
@@ -47,18 +51,83 @@ namespace osmium {
 
         namespace detail {
 
+            /**
+             * Get the memory mapping flag with the given name. Flags are
+             * named like the constants in osmium::memory_mapping_flags.
+             * Returns memory_mapping_flags::none if there is no flag with
+             * this name.
+             */
+            inline osmium::memory_mapping_flags::type memory_mapping_flag_from_name(const std::string& name) noexcept {
+                if (name == "huge_pages") {
+                    return osmium::memory_mapping_flags::huge_pages;
+                }
+                if (name == "huge_tlb") {
+                    return osmium::memory_mapping_flags::huge_tlb;
+                }
+                if (name == "populate") {
+                    return osmium::memory_mapping_flags::populate;
+                }
+                if (name == "random_access") {
+                    return osmium::memory_mapping_flags::random_access;
+                }
+                if (name == "will_need") {
+                    return osmium::memory_mapping_flags::will_need;
+                }
+                return osmium::memory_mapping_flags::none;
+            }
+
+            /**
+             * Get the memory mapping flags from the map config starting at
+             * the given index, for instance
+             * "dense_mmap_array,huge_pages,random_access".
+             *
+             * @throws osmium::map_factory_error if a flag is unknown.
+             */
+            inline osmium::memory_mapping_flags::type memory_mapping_flags_from_config(const std::vector<std::string>& config, std::size_t first) {
+                auto flags = osmium::memory_mapping_flags::none;
+                for (std::size_t i = first; i < config.size(); ++i) {
+                    const auto flag = memory_mapping_flag_from_name(config[i]);
+                    if (flag == osmium::memory_mapping_flags::none) {
+                        throw osmium::map_factory_error{"Unknown map option '" + config[i] + "'"};
+                    }
+                    flags |= flag;
+                }
+                return flags;
+            }
+
+            /**
+             * Create a map based on a file mapping. The config can contain
+             * the file name and, after it, memory mapping flags. Without
+             * a file name a temporary file is used. If the first option is
+             * the name of a memory mapping flag, it is taken as a flag,
+             * not as file name, so "dense_file_array,huge_pages" uses a
+             * temporary file.
+             */
             template <typename T>
             inline T* create_map_with_fd(const std::vector<std::string>& config) {
                 if (config.size() == 1) {
                     return new T{};
                 }
                 assert(config.size() > 1);
+                if (memory_mapping_flag_from_name(config[1]) != osmium::memory_mapping_flags::none) {
+                    return new T{memory_mapping_flags_from_config(config, 1)};
+                }
                 const std::string& filename = config[1];
+                const auto flags = memory_mapping_flags_from_config(config, 2);
                 const int fd = ::open(filename.c_str(), O_CREAT | O_RDWR, 0644); // NOLINT(hicpp-signed-bitwise)
                 if (fd == -1) {
                     throw std::system_error{errno, std::system_category(), "can't open file '" + filename + "'"};
                 }
-                return new T{fd};
+                return new T{fd, flags};
+            }
+
+            /**
+             * Create a map based on an anonymous memory mapping. The
+             * config can contain memory mapping flags.
+             */
+            template <typename T>
+            inline T* create_map_with_flags(const std::vector<std::string>& config) {
+                return new T{memory_mapping_flags_from_config(config, 1)};
             }
 
         } // namespace detail
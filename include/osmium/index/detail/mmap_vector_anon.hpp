@@ -36,6 +36,9 @@ DEALINGS IN THE SOFTWARE.
 #ifdef __linux__
 
 #include <osmium/index/detail/mmap_vector_base.hpp>
+#include <osmium/util/memory_mapping.hpp>
+
+#include <cstddef>
 
 namespace osmium {
 
@@ -54,6 +57,10 @@ namespace osmium {
                 mmap_vector_base<T>() {
             }
 
+            explicit mmap_vector_anon(const osmium::memory_mapping_flags::type flags) :
+                mmap_vector_base<T>(static_cast<std::size_t>(osmium::detail::mmap_vector_size_increment), flags) {
+            }
+
         }; // class mmap_vector_anon
 
     } // namespace detail
@@ -65,16 +65,16 @@ namespace osmium {
 
         public:
 
-            mmap_vector_base(const int fd, const std::size_t capacity, const std::size_t size = 0) :
+            mmap_vector_base(const int fd, const std::size_t capacity, const std::size_t size = 0, const osmium::memory_mapping_flags::type flags = osmium::memory_mapping_flags::none) :
                 m_size(size),
-                m_mapping(capacity, osmium::MemoryMapping::mapping_mode::write_shared, fd) {
+                m_mapping(capacity, osmium::MemoryMapping::mapping_mode::write_shared, fd, 0, flags) {
                 assert(size <= capacity);
                 std::fill(data() + size, data() + capacity, osmium::index::empty_value<T>());
                 shrink_to_fit();
             }
 
-            explicit mmap_vector_base(const std::size_t capacity = mmap_vector_size_increment) :
-                m_mapping(capacity) {
+            explicit mmap_vector_base(const std::size_t capacity = mmap_vector_size_increment, const osmium::memory_mapping_flags::type flags = osmium::memory_mapping_flags::none) :
+                m_mapping(capacity, flags) {
                 std::fill_n(data(), capacity, osmium::index::empty_value<T>());
             }
 
@@ -152,7 +152,14 @@ namespace osmium {
 
             void resize(const std::size_t new_size) {
                 if (new_size > capacity()) {
-                    reserve(new_size + mmap_vector_size_increment);
+                    std::size_t new_capacity = new_size + mmap_vector_size_increment;
+                    // Resizing a mapping with huge_tlb or populate flags
+                    // copies or populates the whole mapping, so grow those
+                    // geometrically to keep the total cost linear.
+                    if (m_mapping.flags() & (osmium::memory_mapping_flags::huge_tlb | osmium::memory_mapping_flags::populate)) {
+                        new_capacity = std::max(new_capacity, capacity() * 2);
+                    }
+                    reserve(new_capacity);
                 }
                 m_size = new_size;
             }
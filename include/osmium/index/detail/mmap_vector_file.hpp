@@ -71,11 +71,20 @@ namespace osmium {
                     osmium::detail::mmap_vector_size_increment) {
             }
 
-            explicit mmap_vector_file(const int fd) :
+            explicit mmap_vector_file(const osmium::memory_mapping_flags::type flags) :
+                mmap_vector_base<T>(
+                    osmium::detail::create_tmp_file(),
+                    osmium::detail::mmap_vector_size_increment,
+                    0,
+                    flags) {
+            }
+
+            explicit mmap_vector_file(const int fd, const osmium::memory_mapping_flags::type flags = osmium::memory_mapping_flags::none) :
                 mmap_vector_base<T>(
                     fd,
                     std::max(static_cast<std::size_t>(mmap_vector_size_increment), filesize(fd)),
-                    filesize(fd)) {
+                    filesize(fd),
+                    flags) {
             }
 
         }; // class mmap_vector_file
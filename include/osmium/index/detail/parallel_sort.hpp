@@ -0,0 +1,239 @@
+#ifndef OSMIUM_INDEX_DETAIL_PARALLEL_SORT_HPP
+#define OSMIUM_INDEX_DETAIL_PARALLEL_SORT_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2023 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <osmium/index/detail/vector_map.hpp>
+#include <osmium/index/detail/vector_multimap.hpp>
+#include <osmium/thread/pool.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <future>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+namespace osmium {
+
+    namespace index {
+
+        namespace detail {
+
+            // Ranges with fewer elements than this per pool thread are
+            // sorted in the calling thread.
+            enum : std::size_t {
+                min_parallel_sort_part_size = 64UL * 1024UL
+            };
+
+            // Wait for all tasks in the pool, helping with the work in the
+            // meantime. Rethrows the first exception from any of them.
+            inline void wait_for_sort_tasks(std::vector<std::future<void>>& futures, osmium::thread::Pool& pool) {
+                for (const auto& future : futures) {
+                    pool.help_while_waiting(future);
+                }
+                for (auto& future : futures) {
+                    future.get();
+                }
+                futures.clear();
+            }
+
+            // The id as unsigned number with the same order as the id.
+            template <typename TId>
+            typename std::make_unsigned<TId>::type sort_key(const TId id) noexcept {
+                using key_type = typename std::make_unsigned<TId>::type;
+                auto key = static_cast<key_type>(id);
+                if (std::is_signed<TId>::value) {
+                    key ^= static_cast<key_type>(static_cast<key_type>(1U) << static_cast<unsigned int>(std::numeric_limits<key_type>::digits - 1));
+                }
+                return key;
+            }
+
+            /**
+             * Split the range [first, last) in place into up to 256
+             * buckets by the highest 8 bits in which the ids in the range
+             * differ (American flag sort). Buckets larger than
+             * max_part_size are split again, all others are sorted in
+             * tasks in the pool. Because the buckets are in id order, the
+             * range is sorted when all tasks are done and nothing has to
+             * be merged. No memory besides the bucket counts is needed.
+             */
+            template <typename TIterator>
+            void parallel_sort_split(TIterator first, TIterator last, osmium::thread::Pool& pool, std::size_t max_part_size, std::vector<std::future<void>>& futures) {
+                enum : std::size_t {
+                    num_buckets = 256
+                };
+
+                const auto size = static_cast<std::size_t>(std::distance(first, last));
+                if (size < 2) {
+                    return;
+                }
+
+                auto min_key = sort_key(first->first);
+                auto max_key = min_key;
+                for (auto it = std::next(first); it != last; ++it) {
+                    const auto key = sort_key(it->first);
+                    min_key = std::min(min_key, key);
+                    max_key = std::max(max_key, key);
+                }
+
+                if (size <= max_part_size || min_key == max_key) {
+                    futures.push_back(pool.submit([first, last]() {
+                        if (!std::is_sorted(first, last)) {
+                            std::sort(first, last);
+                        }
+                    }));
+                    return;
+                }
+
+                unsigned int bits = 0;
+                for (auto diff = min_key ^ max_key; diff != 0; diff >>= 1U) {
+                    ++bits;
+                }
+                const unsigned int shift = bits > 8 ? bits - 8 : 0;
+                using value_type = typename std::iterator_traits<TIterator>::value_type;
+                const auto bucket_of = [shift](const value_type& element) {
+                    return static_cast<std::size_t>((sort_key(element.first) >> shift) & 0xffU);
+                };
+
+                std::array<std::size_t, num_buckets> counts{};
+                for (auto it = first; it != last; ++it) {
+                    ++counts[bucket_of(*it)];
+                }
+
+                std::array<TIterator, num_buckets> next;
+                std::array<TIterator, num_buckets> ends;
+                auto it = first;
+                for (std::size_t b = 0; b < num_buckets; ++b) {
+                    next[b] = it;
+                    std::advance(it, static_cast<typename std::iterator_traits<TIterator>::difference_type>(counts[b]));
+                    ends[b] = it;
+                }
+
+                // Move every element into its bucket by swapping it with
+                // an element from the place it belongs to.
+                for (std::size_t b = 0; b < num_buckets; ++b) {
+                    while (next[b] != ends[b]) {
+                        const auto target = bucket_of(*next[b]);
+                        if (target == b) {
+                            ++next[b];
+                        } else {
+                            std::iter_swap(next[b], next[target]++);
+                        }
+                    }
+                }
+
+                auto begin = first;
+                for (std::size_t b = 0; b < num_buckets; ++b) {
+                    parallel_sort_split(begin, ends[b], pool, max_part_size, futures);
+                    begin = ends[b];
+                }
+            }
+
+            /**
+             * Sort the range [first, last) of (id, value) pairs using the
+             * threads of the pool. The range is split in place into
+             * buckets by id (see parallel_sort_split()) which are then
+             * sorted in the pool threads. The result is the same as with
+             * std::sort.
+             *
+             * An already sorted range is only checked, not changed. Small
+             * ranges are sorted in the calling thread.
+             */
+            template <typename TIterator>
+            void parallel_sort(TIterator first, TIterator last, osmium::thread::Pool& pool) {
+                if (std::is_sorted(first, last)) {
+                    return;
+                }
+
+                const auto size = static_cast<std::size_t>(std::distance(first, last));
+                if (pool.num_threads() < 2 || size < 2 * min_parallel_sort_part_size) {
+                    std::sort(first, last);
+                    return;
+                }
+
+                const std::size_t max_part_size = std::max(static_cast<std::size_t>(min_parallel_sort_part_size),
+                                                           size / (4 * static_cast<std::size_t>(pool.num_threads())));
+
+                std::vector<std::future<void>> futures;
+                try {
+                    parallel_sort_split(first, last, pool, max_part_size, futures);
+                } catch (...) {
+                    // The tasks work on the range, so they must be done
+                    // before we leave.
+                    for (auto& future : futures) {
+                        future.wait();
+                    }
+                    throw;
+                }
+                wait_for_sort_tasks(futures, pool);
+            }
+
+        } // namespace detail
+
+        /**
+         * Sort the sparse map using the threads of the given pool. Use
+         * this instead of the sort() member function which sorts in the
+         * calling thread only.
+         */
+        template <typename TId, typename TValue, template <typename...> class TVector>
+        void sort(osmium::index::map::VectorBasedSparseMap<TId, TValue, TVector>& index, osmium::thread::Pool& pool) {
+            detail::parallel_sort(index.begin(), index.end(), pool);
+        }
+
+        /**
+         * Sort the sparse multimap using the threads of the given pool.
+         * Use this instead of the sort() member function which sorts in
+         * the calling thread only.
+         */
+        template <typename TId, typename TValue, template <typename...> class TVector>
+        void sort(osmium::index::multimap::VectorBasedSparseMultimap<TId, TValue, TVector>& index, osmium::thread::Pool& pool) {
+            detail::parallel_sort(index.begin(), index.end(), pool);
+        }
+
+        /**
+         * Sort any other index. This calls the sort() member function,
+         * the pool is not used.
+         */
+        template <typename TIndex>
+        void sort(TIndex& index, osmium::thread::Pool& /*pool*/) {
+            index.sort();
+        }
+
+    } // namespace index
+
+} // namespace osmium
+
+#endif // OSMIUM_INDEX_DETAIL_PARALLEL_SORT_HPP
@@ -36,10 +36,13 @@ DEALINGS IN THE SOFTWARE.
 #include <osmium/index/index.hpp>
 #include <osmium/index/map.hpp>
 #include <osmium/io/detail/read_write.hpp>
+#include <osmium/util/compatibility.hpp>
+#include <osmium/util/memory_mapping.hpp>
 
 #include <algorithm>
 #include <cstddef>
 #include <memory>
+#include <stdexcept>
 #include <utility>
 
 
@@ -52,6 +55,11 @@ namespace osmium {
             template <typename TVector, typename TId, typename TValue>
             class VectorBasedDenseMap : public Map<TId, TValue> {
 
+                // How many lookups get_many() prefetches ahead.
+                enum : std::size_t {
+                    prefetch_distance = 16
+                };
+
                 TVector m_vector;
 
             public:
@@ -77,6 +85,23 @@ namespace osmium {
                     m_vector(fd) {
                 }
 
+                /**
+                 * Create a map based on a memory mapping with the given
+                 * flags. Only for maps using mmap_vector_anon or
+                 * mmap_vector_file.
+                 */
+                explicit VectorBasedDenseMap(osmium::memory_mapping_flags::type flags) :
+                    m_vector(flags) {
+                }
+
+                /**
+                 * Create a map based on a mapping of the file with the given
+                 * flags. Only for maps using mmap_vector_file.
+                 */
+                VectorBasedDenseMap(int fd, osmium::memory_mapping_flags::type flags) :
+                    m_vector(fd, flags) {
+                }
+
                 void reserve(const std::size_t size) final {
                     m_vector.reserve(size);
                 }
@@ -88,6 +113,48 @@ namespace osmium {
                     m_vector[id] = value;
                 }
 
+                /**
+                 * Grow the index so that it can hold the values for all ids
+                 * up to and including max_id. Does nothing if the index is
+                 * already large enough. Call this before using set_range()
+                 * from several threads.
+                 *
+                 * For the DenseMemArray this allocates and initializes the
+                 * memory for all those ids, the mmap based indexes only
+                 * reserve address space (and file space) for them.
+                 */
+                void grow_to(const TId max_id) {
+                    if (size() <= max_id) {
+                        m_vector.resize(max_id + 1);
+                    }
+                }
+
+                /**
+                 * Set the values for several ids. Unlike set() this never
+                 * grows the index, so several threads can call this at the
+                 * same time, for instance each with the nodes from a
+                 * different PBF block, as long as they set different ids.
+                 * Call grow_to() with the largest id first. Do not call
+                 * set() or any other function changing the index at the
+                 * same time.
+                 *
+                 * @param ids Pointer to the first of count ids.
+                 * @param values Pointer to the first of count values.
+                 * @param count Number of ids and values.
+                 * @throws std::out_of_range If any of the ids is larger
+                 *         than the index. Nothing is set in that case.
+                 */
+                void set_range(const TId* ids, const TValue* values, const std::size_t count) {
+                    const std::size_t size = m_vector.size();
+                    if (std::any_of(ids, ids + count, [size](const TId id) { return id >= size; })) {
+                        throw std::out_of_range{"id larger than index in set_range(), call grow_to() first"};
+                    }
+                    TValue* data = m_vector.data();
+                    for (std::size_t i = 0; i < count; ++i) {
+                        data[ids[i]] = values[i];
+                    }
+                }
+
                 TValue get(const TId id) const final {
                     if (id >= m_vector.size()) {
                         throw osmium::not_found{id};
@@ -106,6 +173,27 @@ namespace osmium {
                     return m_vector[id];
                 }
 
+                /**
+                 * Retrieve values for several ids at once. The memory for
+                 * the ids a few positions ahead is prefetched, so several
+                 * lookups are in flight at the same time.
+                 */
+                void get_many(const TId* ids, TValue* values, const std::size_t count) const noexcept final {
+                    const std::size_t size = m_vector.size();
+                    const TValue* data = m_vector.data();
+                    for (std::size_t i = 0; i < count && i < prefetch_distance; ++i) {
+                        if (ids[i] < size) {
+                            OSMIUM_PREFETCH(data + ids[i]);
+                        }
+                    }
+                    for (std::size_t i = 0; i < count; ++i) {
+                        if (i + prefetch_distance < count && ids[i + prefetch_distance] < size) {
+                            OSMIUM_PREFETCH(data + ids[i + prefetch_distance]);
+                        }
+                        values[i] = ids[i] < size ? data[ids[i]] : osmium::index::empty_value<TValue>();
+                    }
+                }
+
                 std::size_t size() const final {
                     return m_vector.size();
                 }
@@ -187,6 +275,23 @@ namespace osmium {
                     m_vector(fd) {
                 }
 
+                /**
+                 * Create a map based on a memory mapping with the given
+                 * flags. Only for maps using mmap_vector_anon or
+                 * mmap_vector_file.
+                 */
+                explicit VectorBasedSparseMap(osmium::memory_mapping_flags::type flags) :
+                    m_vector(flags) {
+                }
+
+                /**
+                 * Create a map based on a mapping of the file with the given
+                 * flags. Only for maps using mmap_vector_file.
+                 */
+                VectorBasedSparseMap(int fd, osmium::memory_mapping_flags::type flags) :
+                    m_vector(fd, flags) {
+                }
+
                 VectorBasedSparseMap(const VectorBasedSparseMap&) = default;
                 VectorBasedSparseMap& operator=(const VectorBasedSparseMap&) = default;
 
@@ -234,8 +339,16 @@ namespace osmium {
                     m_vector.shrink_to_fit();
                 }
 
+                /**
+                 * Sort the index. If the data is already sorted, it is only
+                 * checked, not sorted again. To sort using the threads of a
+                 * pool, use osmium::index::sort() from
+                 * osmium/index/detail/parallel_sort.hpp.
+                 */
                 void sort() final {
-                    std::sort(m_vector.begin(), m_vector.end());
+                    if (!std::is_sorted(m_vector.begin(), m_vector.end())) {
+                        std::sort(m_vector.begin(), m_vector.end());
+                    }
                 }
 
                 void dump_as_array(const int fd) final {
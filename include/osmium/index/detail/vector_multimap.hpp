@@ -126,8 +126,16 @@ namespace osmium {
                     m_vector.shrink_to_fit();
                 }
 
+                /**
+                 * Sort the index. If the data is already sorted, it is only
+                 * checked, not sorted again. To sort using the threads of a
+                 * pool, use osmium::index::sort() from
+                 * osmium/index/detail/parallel_sort.hpp.
+                 */
                 void sort() final {
-                    std::sort(m_vector.begin(), m_vector.end());
+                    if (!std::is_sorted(m_vector.begin(), m_vector.end())) {
+                        std::sort(m_vector.begin(), m_vector.end());
+                    }
                 }
 
                 void remove(const TId id, const TValue value) {
@@ -141,7 +149,7 @@ namespace osmium {
                 }
 
                 void consolidate() {
-                    std::sort(m_vector.begin(), m_vector.end());
+                    sort();
                 }
 
                 void erase_removed() {
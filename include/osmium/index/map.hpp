@@ -146,6 +146,25 @@ namespace osmium {
                  */
                 virtual TValue get_noexcept(const TId id) const noexcept = 0;
 
+                /**
+                 * Retrieve values for several ids at once. This is the same
+                 * as calling get_noexcept() for each id, but implementations
+                 * can override it to look up several ids at the same time
+                 * which hides some of the memory latency.
+                 *
+                 * @param ids Pointer to the first of count ids to look for.
+                 * @param values Pointer to space for count values. Each is
+                 *               set to the value for the id at the same
+                 *               position or, if not found, to the empty
+                 *               value.
+                 * @param count Number of ids.
+                 */
+                virtual void get_many(const TId* ids, TValue* values, const std::size_t count) const noexcept {
+                    for (std::size_t i = 0; i < count; ++i) {
+                        values[i] = get_noexcept(ids[i]);
+                    }
+                }
+
                 /**
                  * Get the approximate number of items in the storage. The storage
                  * might allocate memory in blocks, so this size might not be
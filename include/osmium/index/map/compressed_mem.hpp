@@ -0,0 +1,380 @@
+#ifndef OSMIUM_INDEX_MAP_COMPRESSED_MEM_HPP
+#define OSMIUM_INDEX_MAP_COMPRESSED_MEM_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2023 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#include <osmium/index/index.hpp>
+#include <osmium/index/map.hpp>
+#include <osmium/osm/location.hpp>
+#include <osmium/util/compatibility.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#define OSMIUM_HAS_INDEX_MAP_COMPRESSED_MEM
+
+namespace osmium {
+
+    namespace index {
+
+        namespace map {
+
+            /**
+             * This is a dense index for node locations that needs much
+             * less memory than the DenseMemArray. The Ids are grouped into
+             * blocks of 256 consecutive Ids. For each block the minimum x
+             * and y coordinates are stored and, for each location, only the
+             * differences from those minima, bit-packed with as many bits
+             * as the block needs. Nodes close in Id are usually close in
+             * space, so this usually needs between a third and a half of
+             * the memory of the uncompressed locations.
+             *
+             * Locations are collected in an uncompressed block until a
+             * location for an Id in another block is set. So this works
+             * best if the locations are set in order of Id, which is the
+             * case when reading OSM files. Setting locations out of order
+             * is possible but slower and might waste some memory.
+             *
+             * Lookups decode the location directly from the packed block
+             * and don't change the index, so they can be done from several
+             * threads at the same time, but not while locations are set.
+             *
+             * Like other dense indexes this needs memory for every possible
+             * Id up to the largest one set, so it is not suitable for small
+             * extracts with large Ids. All data is held in memory.
+             *
+             * This can only be used for osmium::Location values.
+             */
+            template <typename TId, typename TValue>
+            class CompressedMem : public osmium::index::map::Map<TId, TValue> {
+
+                static_assert(std::is_same<TValue, osmium::Location>::value,
+                              "TValue template parameter for class CompressedMem must be osmium::Location");
+
+                // How many lookups get_many() prefetches ahead.
+                enum : std::size_t {
+                    prefetch_distance = 16
+                };
+
+                enum : uint64_t {
+                    bits = 8,
+                    block_size = 1ULL << bits,
+                    no_block = std::numeric_limits<uint64_t>::max()
+                };
+
+                // Number of 64 bit words needed for the values of one
+                // coordinate in a block per bit used for each value.
+                enum : uint64_t {
+                    words_per_bit = block_size / 64
+                };
+
+                // Information about one block: the minimum coordinates and
+                // where to find the packed values. The position in the
+                // data vector and the number of bits used for the x and y
+                // values are packed into one integer to save memory.
+                struct block_info {
+                    uint64_t pos_and_bits = 0;
+                    int32_t min_x = 0;
+                    int32_t min_y = 0;
+
+                    uint64_t pos() const noexcept {
+                        return pos_and_bits >> 16U;
+                    }
+
+                    unsigned int x_bits() const noexcept {
+                        return static_cast<unsigned int>((pos_and_bits >> 8U) & 0xffU);
+                    }
+
+                    unsigned int y_bits() const noexcept {
+                        return static_cast<unsigned int>(pos_and_bits & 0xffU);
+                    }
+
+                    uint64_t num_words() const noexcept {
+                        return words_per_bit * (x_bits() + y_bits());
+                    }
+
+                    void set(uint64_t pos, unsigned int xb, unsigned int yb) noexcept {
+                        pos_and_bits = (pos << 16U) | (static_cast<uint64_t>(xb) << 8U) | yb;
+                    }
+                };
+
+                std::vector<block_info> m_blocks;
+
+                std::vector<uint64_t> m_data;
+
+                // The block that is currently being written to and its
+                // (uncompressed) locations.
+                std::vector<TValue> m_open_values;
+                uint64_t m_open_block = no_block;
+
+                static uint64_t block(const uint64_t id) noexcept {
+                    return id >> bits;
+                }
+
+                static uint64_t offset(const uint64_t id) noexcept {
+                    return id & (block_size - 1);
+                }
+
+                // Number of bits needed to store all values from 0 to
+                // max_value.
+                static unsigned int bits_needed(uint64_t max_value) noexcept {
+                    unsigned int n = 0;
+                    while (max_value != 0) {
+                        ++n;
+                        max_value >>= 1U;
+                    }
+                    return n;
+                }
+
+                // Packed values are stored as 1 + (value - minimum), the
+                // value 0 is used for the empty location. Values never
+                // straddle the end of the area for one coordinate, because
+                // that always ends on a word boundary.
+                static void put_packed(uint64_t* words, const uint64_t index, const unsigned int nbits, const uint64_t value) noexcept {
+                    const uint64_t bit_pos = index * nbits;
+                    const uint64_t word = bit_pos >> 6U;
+                    const unsigned int shift = bit_pos & 63U;
+                    words[word] |= value << shift;
+                    if (shift + nbits > 64) {
+                        words[word + 1] |= value >> (64 - shift);
+                    }
+                }
+
+                static uint64_t get_packed(const uint64_t* words, const uint64_t index, const unsigned int nbits) noexcept {
+                    if (nbits == 0) {
+                        return 0;
+                    }
+                    const uint64_t bit_pos = index * nbits;
+                    const uint64_t word = bit_pos >> 6U;
+                    const unsigned int shift = bit_pos & 63U;
+                    uint64_t value = words[word] >> shift;
+                    if (shift + nbits > 64) {
+                        value |= words[word + 1] << (64 - shift);
+                    }
+                    return value & ((1ULL << nbits) - 1);
+                }
+
+                TValue get_compressed(const uint64_t id) const noexcept {
+                    const auto num = block(id);
+                    if (num >= m_blocks.size()) {
+                        return osmium::index::empty_value<TValue>();
+                    }
+
+                    const block_info& info = m_blocks[num];
+                    const uint64_t* words = m_data.data() + info.pos();
+                    const auto x = get_packed(words, offset(id), info.x_bits());
+                    if (x == 0) {
+                        return osmium::index::empty_value<TValue>();
+                    }
+                    const auto y = get_packed(words + words_per_bit * info.x_bits(), offset(id), info.y_bits());
+
+                    return TValue{static_cast<int64_t>(info.min_x) + static_cast<int64_t>(x) - 1,
+                                  static_cast<int64_t>(info.min_y) + static_cast<int64_t>(y) - 1};
+                }
+
+                // Compress the open block and store it.
+                void flush() {
+                    if (m_open_block == no_block) {
+                        return;
+                    }
+
+                    int64_t min_x = std::numeric_limits<int64_t>::max();
+                    int64_t min_y = std::numeric_limits<int64_t>::max();
+                    int64_t max_x = std::numeric_limits<int64_t>::min();
+                    int64_t max_y = std::numeric_limits<int64_t>::min();
+                    for (const auto& location : m_open_values) {
+                        if (location != osmium::index::empty_value<TValue>()) {
+                            min_x = std::min(min_x, static_cast<int64_t>(location.x()));
+                            min_y = std::min(min_y, static_cast<int64_t>(location.y()));
+                            max_x = std::max(max_x, static_cast<int64_t>(location.x()));
+                            max_y = std::max(max_y, static_cast<int64_t>(location.y()));
+                        }
+                    }
+
+                    block_info& info = m_blocks[m_open_block];
+                    const auto old_num_words = info.num_words();
+
+                    unsigned int x_bits = 0;
+                    unsigned int y_bits = 0;
+                    if (min_x <= max_x) {
+                        x_bits = bits_needed(static_cast<uint64_t>(max_x - min_x) + 1);
+                        y_bits = bits_needed(static_cast<uint64_t>(max_y - min_y) + 1);
+                        info.min_x = static_cast<int32_t>(min_x);
+                        info.min_y = static_cast<int32_t>(min_y);
+                    }
+
+                    // Reuse the space of an earlier version of this block
+                    // if it is large enough.
+                    uint64_t pos = info.pos();
+                    const uint64_t num_words = words_per_bit * (x_bits + y_bits);
+                    if (num_words > old_num_words) {
+                        pos = m_data.size();
+                        m_data.resize(pos + num_words);
+                    }
+                    info.set(pos, x_bits, y_bits);
+
+                    uint64_t* words = m_data.data() + pos;
+                    std::fill_n(words, num_words, 0);
+                    uint64_t* y_words = words + words_per_bit * x_bits;
+                    for (uint64_t i = 0; i < block_size; ++i) {
+                        const auto& location = m_open_values[i];
+                        if (location != osmium::index::empty_value<TValue>()) {
+                            put_packed(words, i, x_bits, static_cast<uint64_t>(location.x() - min_x) + 1);
+                            put_packed(y_words, i, y_bits, static_cast<uint64_t>(location.y() - min_y) + 1);
+                        }
+                    }
+
+                    m_open_block = no_block;
+                }
+
+                // Make the block with the given number the open block,
+                // decompressing it if it was written before.
+                void open(const uint64_t num) {
+                    flush();
+
+                    if (num >= m_blocks.size()) {
+                        m_blocks.resize(num + 1);
+                    }
+
+                    m_open_values.resize(block_size);
+                    const uint64_t first_id = num << bits;
+                    for (uint64_t i = 0; i < block_size; ++i) {
+                        m_open_values[i] = get_compressed(first_id + i);
+                    }
+                    m_open_block = num;
+                }
+
+            public:
+
+                CompressedMem() = default;
+
+                std::size_t size() const noexcept final {
+                    return m_blocks.size() * block_size;
+                }
+
+                std::size_t used_memory() const noexcept final {
+                    return sizeof(CompressedMem) +
+                           m_blocks.size() * sizeof(block_info) +
+                           m_data.size() * sizeof(uint64_t) +
+                           m_open_values.size() * sizeof(TValue);
+                }
+
+                void set(const TId id, const TValue value) final {
+                    if (block(id) != m_open_block) {
+                        open(block(id));
+                    }
+                    m_open_values[offset(id)] = value;
+                }
+
+                TValue get_noexcept(const TId id) const noexcept final {
+                    if (block(id) == m_open_block) {
+                        return m_open_values[offset(id)];
+                    }
+                    return get_compressed(id);
+                }
+
+                /**
+                 * Retrieve values for several ids at once. The block
+                 * information for ids further ahead and the packed data for
+                 * ids a bit closer ahead are prefetched, so several lookups
+                 * are in flight at the same time.
+                 */
+                void get_many(const TId* ids, TValue* values, const std::size_t count) const noexcept final {
+                    for (std::size_t i = 0; i < count; ++i) {
+                        if (i + prefetch_distance < count) {
+                            const auto num = block(ids[i + prefetch_distance]);
+                            if (num < m_blocks.size()) {
+                                OSMIUM_PREFETCH(&m_blocks[num]);
+                            }
+                        }
+                        if (i + prefetch_distance / 2 < count) {
+                            const auto id = ids[i + prefetch_distance / 2];
+                            const auto num = block(id);
+                            if (num < m_blocks.size() && m_blocks[num].x_bits() > 0) {
+                                const auto& info = m_blocks[num];
+                                const uint64_t* words = m_data.data() + info.pos();
+                                OSMIUM_PREFETCH(words + ((offset(id) * info.x_bits()) >> 6U));
+                                OSMIUM_PREFETCH(words + words_per_bit * info.x_bits() + ((offset(id) * info.y_bits()) >> 6U));
+                            }
+                        }
+                        values[i] = get_noexcept(ids[i]);
+                    }
+                }
+
+                TValue get(const TId id) const final {
+                    const auto value = get_noexcept(id);
+                    if (value == osmium::index::empty_value<TValue>()) {
+                        throw osmium::not_found{id};
+                    }
+                    return value;
+                }
+
+                void clear() final {
+                    m_blocks.clear();
+                    m_blocks.shrink_to_fit();
+                    m_data.clear();
+                    m_data.shrink_to_fit();
+                    m_open_values.clear();
+                    m_open_values.shrink_to_fit();
+                    m_open_block = no_block;
+                }
+
+                /**
+                 * Compress the block that is currently written to. Not
+                 * necessary before reading, but call it after writing all
+                 * locations to free some memory.
+                 */
+                void sort() final {
+                    flush();
+                    m_open_values.clear();
+                    m_open_values.shrink_to_fit();
+                }
+
+            }; // class CompressedMem
+
+        } // namespace map
+
+    } // namespace index
+
+} // namespace osmium
+
+#ifdef OSMIUM_WANT_NODE_LOCATION_MAPS
+    REGISTER_MAP(osmium::unsigned_object_id_type, osmium::Location, osmium::index::map::CompressedMem, compressed_mem)
+#endif
+
+#endif // OSMIUM_INDEX_MAP_COMPRESSED_MEM_HPP
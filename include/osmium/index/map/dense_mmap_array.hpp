@@ -35,9 +35,13 @@ DEALINGS IN THE SOFTWARE.
 
 #ifdef __linux__
 
+#include <osmium/index/detail/create_map_with_fd.hpp>
 #include <osmium/index/detail/mmap_vector_anon.hpp> // IWYU pragma: keep
 #include <osmium/index/detail/vector_map.hpp>
 
+#include <string>
+#include <vector>
+
 #define OSMIUM_HAS_INDEX_MAP_DENSE_MMAP_ARRAY
 
 namespace osmium {
@@ -49,6 +53,13 @@ namespace osmium {
             template <typename TId, typename TValue>
             using DenseMmapArray = VectorBasedDenseMap<osmium::detail::mmap_vector_anon<TValue>, TId, TValue>;
 
+            template <typename TId, typename TValue>
+            struct create_map<TId, TValue, DenseMmapArray> {
+                DenseMmapArray<TId, TValue>* operator()(const std::vector<std::string>& config) {
+                    return osmium::index::detail::create_map_with_flags<DenseMmapArray<TId, TValue>>(config);
+                }
+            };
+
         } // namespace map
 
     } // namespace index
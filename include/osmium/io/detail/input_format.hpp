@@ -38,17 +38,22 @@ DEALINGS IN THE SOFTWARE.
 #include <osmium/io/file.hpp>
 #include <osmium/io/file_format.hpp>
 #include <osmium/io/header.hpp>
+#include <osmium/io/location_prefilter.hpp>
+#include <osmium/io/tags_prefilter.hpp>
 #include <osmium/memory/buffer.hpp>
+#include <osmium/memory/buffer_pool.hpp>
 #include <osmium/osm/entity_bits.hpp>
 #include <osmium/thread/pool.hpp>
 
 #include <array>
+#include <cstddef>
 #include <exception>
 #include <functional>
 #include <future>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 namespace osmium {
 
@@ -67,6 +72,10 @@ namespace osmium {
                 osmium::io::read_meta read_metadata;
                 osmium::io::buffers_type buffers_kind;
                 bool want_buffered_pages_removed;
+                const osmium::io::File& file;
+                osmium::io::tags_prefilter tags_filter;
+                osmium::io::location_prefilter location_filter;
+                osmium::memory::BufferPool* buffer_pool;
             };
 
             class Parser {
@@ -77,6 +86,10 @@ namespace osmium {
                 queue_wrapper<std::string> m_input_queue;
                 osmium::osm_entity_bits::type m_read_which_entities;
                 osmium::io::read_meta m_read_metadata;
+                osmium::io::tags_prefilter m_tags_filter;
+                osmium::io::location_prefilter m_location_filter;
+                osmium::memory::BufferPool* m_buffer_pool;
+                std::vector<osmium::memory::Buffer>* m_collected_buffers = nullptr;
                 bool m_header_is_done = false;
 
             protected:
@@ -93,6 +106,18 @@ namespace osmium {
                     return m_read_metadata;
                 }
 
+                const osmium::io::tags_prefilter& tags_filter() const noexcept {
+                    return m_tags_filter;
+                }
+
+                const osmium::io::location_prefilter& location_filter() const noexcept {
+                    return m_location_filter;
+                }
+
+                osmium::memory::BufferPool* buffer_pool() const noexcept {
+                    return m_buffer_pool;
+                }
+
                 bool header_is_done() const noexcept {
                     return m_header_is_done;
                 }
@@ -115,10 +140,18 @@ namespace osmium {
                  * Wrap the buffer into a future and add it to the output queue.
                  */
                 void send_to_output_queue(osmium::memory::Buffer&& buffer) {
+                    if (m_collected_buffers) {
+                        m_collected_buffers->push_back(std::move(buffer));
+                        return;
+                    }
                     add_to_queue(m_output_queue, std::move(buffer));
                 }
 
                 void send_to_output_queue(std::future<osmium::memory::Buffer>&& future) {
+                    if (m_collected_buffers) {
+                        m_collected_buffers->push_back(future.get());
+                        return;
+                    }
                     m_output_queue.push(std::move(future));
                 }
 
@@ -130,7 +163,10 @@ namespace osmium {
                     m_header_promise(args.header_promise),
                     m_input_queue(args.input_queue),
                     m_read_which_entities(args.read_which_entities),
-                    m_read_metadata(args.read_metadata) {
+                    m_read_metadata(args.read_metadata),
+                    m_tags_filter(args.tags_filter),
+                    m_location_filter(args.location_filter),
+                    m_buffer_pool(args.buffer_pool) {
                 }
 
                 Parser(const Parser&) = delete;
@@ -143,6 +179,15 @@ namespace osmium {
 
                 virtual void run() = 0;
 
+                /**
+                 * Append all buffers to the given vector instead of sending
+                 * them to the output queue. Used by parse_chunk() where
+                 * nobody reads from the output queue while parsing.
+                 */
+                void collect_buffers(std::vector<osmium::memory::Buffer>* buffers) noexcept {
+                    m_collected_buffers = buffers;
+                }
+
                 std::string get_input() {
                     return m_input_queue.pop();
                 }
@@ -165,6 +210,17 @@ namespace osmium {
 
             }; // class Parser
 
+            /**
+             * The settings needed to parse a chunk of the input with its
+             * own parser in a pool thread. See parse_chunk().
+             */
+            struct chunk_parser_settings {
+                osmium::thread::Pool* pool;
+                osmium::osm_entity_bits::type read_which_entities;
+                osmium::io::read_meta read_metadata;
+                osmium::io::buffers_type buffers_kind;
+            }; // struct chunk_parser_settings
+
             class ParserWithBuffer : public Parser {
 
                 enum {
@@ -202,6 +258,10 @@ namespace osmium {
                     return m_buffer;
                 }
 
+                chunk_parser_settings get_chunk_parser_settings() {
+                    return chunk_parser_settings{&get_pool(), read_types(), read_metadata(), m_buffers_kind};
+                }
+
                 void flush_nested_buffer() {
                     if (m_buffer.has_nested_buffers()) {
                         std::unique_ptr<osmium::memory::Buffer> buffer_ptr{m_buffer.get_last_nested()};
@@ -231,6 +291,55 @@ namespace osmium {
 
             }; // class ParserWithBuffer
 
+            /**
+             * Parse a chunk of input data with a new parser of type
+             * TParser in the current thread. The parser gets the data
+             * through its input queue as usual, func(parser) must do the
+             * actual parsing. This is used by parsers that split their
+             * input and parse the chunks in parallel in the pool threads.
+             *
+             * The buffers are collected in a vector, not in the output
+             * queue, because nobody reads from the queue until the chunk
+             * is done and a bounded queue could fill up.
+             *
+             * @returns All buffers created by the parser in order.
+             * @throws Any exception thrown by the parser.
+             */
+            template <typename TParser, typename TFunction>
+            std::vector<osmium::memory::Buffer> parse_chunk(std::string&& data, const chunk_parser_settings& settings, TFunction&& func) {
+                static const osmium::io::File file{"", "osm"};
+
+                future_string_queue_type input_queue;
+                future_buffer_queue_type output_queue;
+                std::promise<osmium::io::Header> header_promise;
+
+                add_to_queue(input_queue, std::move(data));
+                add_end_of_data_to_queue(input_queue);
+
+                parser_arguments args{
+                    *settings.pool,
+                    -1,
+                    input_queue,
+                    output_queue,
+                    header_promise,
+                    nullptr,
+                    settings.read_which_entities,
+                    settings.read_metadata,
+                    settings.buffers_kind,
+                    false,
+                    file,
+                    osmium::io::tags_prefilter{},
+                    osmium::io::location_prefilter{},
+                    nullptr
+                };
+
+                std::vector<osmium::memory::Buffer> buffers;
+                TParser parser{args};
+                parser.collect_buffers(&buffers);
+                func(parser);
+                return buffers;
+            }
+
             /**
              * This factory class is used to create objects that decode OSM
              * data written in a specified format.
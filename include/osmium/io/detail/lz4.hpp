@@ -37,6 +37,7 @@ DEALINGS IN THE SOFTWARE.
 
 #include <cassert>
 #include <limits>
+#include <memory>
 #include <stdexcept>
 #include <string>
 
@@ -68,6 +69,16 @@ namespace osmium {
                 }
             }
 
+            /**
+             * Get the lz4 compression state for the current thread. Using
+             * this with LZ4_compress_fast_extState() saves setting up the
+             * state for every call.
+             */
+            inline void* lz4_thread_compression_state() {
+                static thread_local std::unique_ptr<char[]> state{new char[static_cast<std::size_t>(::LZ4_sizeofState())]};
+                return state.get();
+            }
+
             /**
              * Compress data using lz4.
              *
@@ -75,16 +86,18 @@ namespace osmium {
              * LZ4_MAX_INPUT_SIZE.
              *
              * @param input Data to compress.
+             * @param output Compressed data. The capacity of this string is
+             *               reused if possible.
              * @param compression_level Compression level.
-             * @returns Compressed data.
              */
-            inline std::string lz4_compress(const std::string& input, int compression_level = lz4_default_compression_level()) { // NOLINT(google-runtime-int)
+            inline void lz4_compress(const std::string& input, std::string& output, int compression_level = lz4_default_compression_level()) {
                 assert(input.size() < LZ4_MAX_INPUT_SIZE);
                 const int output_size = ::LZ4_compressBound(static_cast<int>(input.size())); // NOLINT(google-runtime-int)
 
-                std::string output(static_cast<std::size_t>(output_size), '\0');
+                output.resize(static_cast<std::size_t>(output_size));
 
-                const int result = ::LZ4_compress_fast( // NOLINT(google-runtime-int)
+                const int result = ::LZ4_compress_fast_extState( // NOLINT(google-runtime-int)
+                    lz4_thread_compression_state(),
                     input.data(),
                     &*output.begin(),
                     static_cast<int>(input.size()),
@@ -96,7 +109,21 @@ namespace osmium {
                 }
 
                 output.resize(result);
+            }
 
+            /**
+             * Compress data using lz4.
+             *
+             * Note that this function can not compress data larger than
+             * LZ4_MAX_INPUT_SIZE.
+             *
+             * @param input Data to compress.
+             * @param compression_level Compression level.
+             * @returns Compressed data.
+             */
+            inline std::string lz4_compress(const std::string& input, int compression_level = lz4_default_compression_level()) { // NOLINT(google-runtime-int)
+                std::string output;
+                lz4_compress(input, output, compression_level);
                 return output;
             }
 
@@ -313,37 +313,50 @@ namespace osmium {
                     return {static_cast<osmium::user_id_type>(uid), user};
                 }
 
-                void decode_tags(osmium::builder::Builder& parent, const char** dataptr, const char* const end) {
-                    osmium::builder::TagListBuilder builder{parent};
-
-                    while (*dataptr != end) {
-                        const bool update_pointer = (**dataptr == 0x00);
-                        const char* data = decode_string(dataptr, end);
-                        const char* start = data;
+                std::pair<const char*, const char*> decode_tag(const char** dataptr, const char* const end) {
+                    const bool update_pointer = (**dataptr == 0x00);
+                    const char* data = decode_string(dataptr, end);
+                    const char* start = data;
 
-                        while (*data++) {
-                            if (data == end) {
-                                throw o5m_error{"no null byte in tag key"};
-                            }
+                    while (*data++) {
+                        if (data == end) {
+                            throw o5m_error{"no null byte in tag key"};
                         }
+                    }
 
+                    if (data == end) {
+                        throw o5m_error{"no null byte in tag value"};
+                    }
+
+                    const char* value = data;
+                    while (*data++) {
                         if (data == end) {
                             throw o5m_error{"no null byte in tag value"};
                         }
+                    }
 
-                        const char* value = data;
-                        while (*data++) {
-                            if (data == end) {
-                                throw o5m_error{"no null byte in tag value"};
-                            }
-                        }
+                    if (update_pointer) {
+                        m_reference_table.add(start, data - start);
+                        *dataptr = data;
+                    }
 
-                        if (update_pointer) {
-                            m_reference_table.add(start, data - start);
-                            *dataptr = data;
-                        }
+                    return {start, value};
+                }
+
+                void decode_tags(osmium::builder::Builder& parent, const char** dataptr, const char* const end) {
+                    osmium::builder::TagListBuilder builder{parent};
 
-                        builder.add_tag(start, value);
+                    while (*dataptr != end) {
+                        const auto tag = decode_tag(dataptr, end);
+                        builder.add_tag(tag.first, tag.second);
+                    }
+                }
+
+                // Tags of objects we don't keep still have to be decoded,
+                // because they might add entries to the reference table.
+                void skip_tags(const char** dataptr, const char* const end) {
+                    while (*dataptr != end) {
+                        decode_tag(dataptr, end);
                     }
                 }
 
@@ -380,7 +393,9 @@ namespace osmium {
                     return user;
                 }
 
-                void decode_node(const char* data, const char* const end) {
+                // Returns false if the node is outside the location filter.
+                // In that case the caller has to roll back the buffer.
+                bool decode_node(const char* data, const char* const end) {
                     osmium::builder::NodeBuilder builder{buffer()};
 
                     builder.set_id(m_delta_id.update(zvarint(&data, end)));
@@ -394,12 +409,21 @@ namespace osmium {
                     } else {
                         const auto lon = m_delta_lon.update(zvarint(&data, end));
                         const auto lat = m_delta_lat.update(zvarint(&data, end));
-                        builder.set_location(osmium::Location{lon, lat});
+                        const osmium::Location location{lon, lat};
+
+                        if (!location_filter().empty() && !location_filter().contains(location)) {
+                            skip_tags(&data, end);
+                            return false;
+                        }
+
+                        builder.set_location(location);
 
                         if (data != end) {
                             decode_tags(builder, &data, end);
                         }
                     }
+
+                    return true;
                 }
 
                 void decode_way(const char* data, const char* const end) {
@@ -559,8 +583,11 @@ namespace osmium {
                                     mark_header_as_done();
                                     if (read_types() & osmium::osm_entity_bits::node) {
                                         maybe_new_buffer(osmium::item_type::node);
-                                        decode_node(m_data, m_data + length);
-                                        buffer().commit();
+                                        if (decode_node(m_data, m_data + length)) {
+                                            buffer().commit();
+                                        } else {
+                                            buffer().rollback();
+                                        }
                                     }
                                     break;
                                 case dataset_type::way:
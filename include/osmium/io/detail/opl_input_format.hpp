@@ -35,15 +35,18 @@ DEALINGS IN THE SOFTWARE.
 
 #include <osmium/io/detail/input_format.hpp>
 #include <osmium/io/detail/opl_parser_functions.hpp>
+#include <osmium/io/file.hpp>
 #include <osmium/io/file_format.hpp>
 #include <osmium/io/header.hpp>
 #include <osmium/memory/buffer.hpp>
+#include <osmium/thread/ordered_results.hpp>
 #include <osmium/thread/util.hpp>
 
 #include <cstdint>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 namespace osmium {
 
@@ -98,14 +101,103 @@ namespace osmium {
                 }
             }
 
+            /**
+             * Count lines in the data the way line_by_line() does: Lines
+             * can end in \n or \r, empty lines are not counted.
+             */
+            inline uint64_t count_opl_lines(const std::string& data) noexcept {
+                uint64_t count = 0;
+                bool in_line = false;
+                for (const char c : data) {
+                    const bool is_end_of_line = (c == '\n' || c == '\r');
+                    if (!is_end_of_line && !in_line) {
+                        ++count;
+                    }
+                    in_line = !is_end_of_line;
+                }
+                return count;
+            }
+
             class OPLParser final : public ParserWithBuffer {
 
+                enum {
+                    // Minimum size of chunks for parallel parsing.
+                    parallel_chunk_size = 4UL * 1024UL * 1024UL
+                };
+
                 uint64_t m_line_count = 0;
+                bool m_parallel;
+
+                /**
+                 * Parses a chunk of complete lines of an OPL file in a pool
+                 * thread.
+                 */
+                class OPLChunkDecoder {
+
+                    std::string m_data;
+                    uint64_t m_first_line;
+                    chunk_parser_settings m_settings;
+
+                public:
+
+                    OPLChunkDecoder(std::string&& data, uint64_t first_line, const chunk_parser_settings& settings) :
+                        m_data(std::move(data)),
+                        m_first_line(first_line),
+                        m_settings(settings) {
+                    }
+
+                    std::vector<osmium::memory::Buffer> operator()() {
+                        const uint64_t first_line = m_first_line;
+                        return parse_chunk<OPLParser>(std::move(m_data), m_settings, [first_line](OPLParser& parser) {
+                            parser.m_line_count = first_line;
+                            line_by_line(parser);
+                            parser.flush_final_buffer();
+                        });
+                    }
+
+                }; // class OPLChunkDecoder
+
+                // Cut the input into chunks at line ends and parse them in
+                // parallel in the pool threads.
+                void parse_input_parallel() {
+                    osmium::thread::OrderedResults<std::vector<osmium::memory::Buffer>> chunks{get_pool()};
+                    const auto settings = get_chunk_parser_settings();
+                    const auto output = [this](std::vector<osmium::memory::Buffer>&& buffers) {
+                        for (auto& buffer : buffers) {
+                            send_to_output_queue(std::move(buffer));
+                        }
+                    };
+
+                    std::string data;
+                    while (!input_done()) {
+                        data.append(get_input());
+                        if (data.size() < parallel_chunk_size) {
+                            continue;
+                        }
+                        const auto pos = data.find_last_of("\n\r");
+                        if (pos == std::string::npos) {
+                            continue;
+                        }
+                        std::string chunk{std::move(data)};
+                        data.assign(chunk, pos + 1, std::string::npos);
+                        chunk.resize(pos + 1);
+                        const auto num_lines = count_opl_lines(chunk);
+                        chunks.submit(OPLChunkDecoder{std::move(chunk), m_line_count, settings}, output);
+                        m_line_count += num_lines;
+                    }
+
+                    if (!data.empty()) {
+                        chunks.submit(OPLChunkDecoder{std::move(data), m_line_count, settings}, output);
+                    }
+
+                    chunks.output_all(output);
+                }
 
             public:
 
                 explicit OPLParser(parser_arguments& args) :
-                    ParserWithBuffer(args) {
+                    ParserWithBuffer(args),
+                    m_parallel(args.file.is_true("opl_parallel")) {
                     set_header_value(osmium::io::Header{});
                 }
 
@@ -142,6 +234,11 @@ namespace osmium {
                 void run() override {
                     osmium::thread::set_thread_name("_osmium_opl_in");
 
+                    if (m_parallel) {
+                        parse_input_parallel();
+                        return;
+                    }
+
                     line_by_line(*this);
 
                     flush_final_buffer();
@@ -0,0 +1,714 @@
+#ifndef OSMIUM_IO_DETAIL_PBF_BLOB_INDEX_HPP
+#define OSMIUM_IO_DETAIL_PBF_BLOB_INDEX_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2023 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <osmium/io/detail/pbf.hpp> // IWYU pragma: export
+#include <osmium/io/detail/pbf_decoder.hpp>
+#include <osmium/io/detail/protobuf_tags.hpp>
+#include <osmium/io/detail/read_write.hpp>
+#include <osmium/io/error.hpp>
+#include <osmium/io/location_prefilter.hpp>
+#include <osmium/io/tags_prefilter.hpp>
+#include <osmium/memory/buffer.hpp>
+#include <osmium/memory/buffer_pool.hpp>
+#include <osmium/osm/entity_bits.hpp>
+#include <osmium/thread/pool.hpp>
+#include <osmium/util/file.hpp>
+
+#include <protozero/pbf_message.hpp>
+#include <protozero/types.hpp>
+
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace osmium {
+
+    namespace io {
+
+        namespace detail {
+
+            /**
+             * Decode a BlobHeader and return the blob type (for instance
+             * "OSMHeader" or "OSMData") and the size of the following Blob.
+             *
+             * @throws osmium::pbf_error If the BlobHeader is invalid.
+             */
+            inline std::pair<protozero::data_view, std::size_t> decode_blob_header_type_and_size(const protozero::data_view& data) {
+                protozero::pbf_message<FileFormat::BlobHeader> pbf_blob_header{data};
+                protozero::data_view blob_header_type;
+                std::size_t blob_header_datasize = 0;
+
+                while (pbf_blob_header.next()) {
+                    switch (pbf_blob_header.tag_and_type()) {
+                        case protozero::tag_and_type(FileFormat::BlobHeader::required_string_type, protozero::pbf_wire_type::length_delimited):
+                            blob_header_type = pbf_blob_header.get_view();
+                            break;
+                        case protozero::tag_and_type(FileFormat::BlobHeader::required_int32_datasize, protozero::pbf_wire_type::varint):
+                            blob_header_datasize = pbf_blob_header.get_int32();
+                            break;
+                        default:
+                            pbf_blob_header.skip();
+                    }
+                }
+
+                if (blob_header_datasize == 0) {
+                    throw osmium::pbf_error{"PBF format error: BlobHeader.datasize missing or zero."};
+                }
+
+                return {blob_header_type, blob_header_datasize};
+            }
+
+            /**
+             * Byte source reading from uncompressed data in memory. Used
+             * by scan_primitive_block().
+             */
+            class pbf_memory_source {
+
+                const char* m_data;
+                const char* m_end;
+
+            public:
+
+                explicit pbf_memory_source(const protozero::data_view& data) noexcept :
+                    m_data(data.data()),
+                    m_end(data.data() + data.size()) {
+                }
+
+                bool next_byte(char* c) noexcept {
+                    if (m_data == m_end) {
+                        return false;
+                    }
+                    *c = *m_data++;
+                    return true;
+                }
+
+                bool skip(std::size_t size) noexcept {
+                    if (static_cast<std::size_t>(m_end - m_data) < size) {
+                        return false;
+                    }
+                    m_data += size;
+                    return true;
+                }
+
+            }; // class pbf_memory_source
+
+            /**
+             * Byte source inflating zlib-compressed data read from a file
+             * on demand. Used by scan_primitive_block(). This keeps the
+             * memory use low, but skipping over data still means it has
+             * to be uncompressed, so unless the scan can stop early, the
+             * whole blob is read and uncompressed.
+             */
+            class pbf_zlib_file_source {
+
+                enum : std::size_t {
+                    chunk_size = 16UL * 1024UL
+                };
+
+                z_stream m_stream{};
+                std::array<char, chunk_size> m_input{};
+                std::array<char, chunk_size> m_output{};
+                int m_fd;
+                std::size_t m_offset;
+                std::size_t m_end;
+                std::size_t m_output_pos = 0;
+                std::size_t m_output_end = 0;
+                bool m_stream_end = false;
+
+                bool fill_output() {
+                    while (!m_stream_end) {
+                        if (m_stream.avail_in == 0 && m_offset < m_end) {
+                            const auto size = std::min(m_end - m_offset, static_cast<std::size_t>(chunk_size));
+                            if (!read_exactly_at(m_fd, m_input.data(), size, m_offset)) {
+                                throw osmium::pbf_error{"truncated data (EOF encountered)"};
+                            }
+                            m_offset += size;
+                            m_stream.next_in = reinterpret_cast<unsigned char*>(m_input.data());
+                            m_stream.avail_in = static_cast<unsigned int>(size);
+                        }
+
+                        m_stream.next_out = reinterpret_cast<unsigned char*>(m_output.data());
+                        m_stream.avail_out = static_cast<unsigned int>(m_output.size());
+                        const auto result = ::inflate(&m_stream, Z_NO_FLUSH);
+                        if (result == Z_STREAM_END) {
+                            m_stream_end = true;
+                        } else if (result != Z_OK) {
+                            throw io_error{std::string{"failed to uncompress data: "} + zError(result)};
+                        }
+
+                        m_output_pos = 0;
+                        m_output_end = m_output.size() - m_stream.avail_out;
+                        if (m_output_end > 0) {
+                            return true;
+                        }
+
+                        if (m_stream.avail_in == 0 && m_offset == m_end) {
+                            throw osmium::pbf_error{"truncated zlib data in blob"};
+                        }
+                    }
+                    return false;
+                }
+
+            public:
+
+                pbf_zlib_file_source(int fd, std::size_t offset, std::size_t size) :
+                    m_fd(fd),
+                    m_offset(offset),
+                    m_end(offset + size) {
+                    const auto result = ::inflateInit(&m_stream);
+                    if (result != Z_OK) {
+                        throw io_error{std::string{"inflateInit failed: "} + zError(result)};
+                    }
+                }
+
+                pbf_zlib_file_source(const pbf_zlib_file_source&) = delete;
+                pbf_zlib_file_source& operator=(const pbf_zlib_file_source&) = delete;
+
+                pbf_zlib_file_source(pbf_zlib_file_source&&) = delete;
+                pbf_zlib_file_source& operator=(pbf_zlib_file_source&&) = delete;
+
+                ~pbf_zlib_file_source() noexcept {
+                    ::inflateEnd(&m_stream);
+                }
+
+                bool next_byte(char* c) {
+                    if (m_output_pos == m_output_end && !fill_output()) {
+                        return false;
+                    }
+                    *c = m_output[m_output_pos++];
+                    return true;
+                }
+
+                bool skip(std::size_t size) {
+                    while (size > 0) {
+                        if (m_output_pos == m_output_end && !fill_output()) {
+                            return false;
+                        }
+                        const auto n = std::min(size, m_output_end - m_output_pos);
+                        m_output_pos += n;
+                        size -= n;
+                    }
+                    return true;
+                }
+
+            }; // class pbf_zlib_file_source
+
+            template <typename TSource>
+            bool pbf_source_read_varint(TSource& source, uint64_t* value) {
+                *value = 0;
+                for (unsigned int shift = 0; shift < 64; shift += 7) {
+                    char c = 0;
+                    if (!source.next_byte(&c)) {
+                        if (shift == 0) {
+                            return false;
+                        }
+                        throw osmium::pbf_error{"truncated varint"};
+                    }
+                    *value |= static_cast<uint64_t>(static_cast<unsigned char>(c) & 0x7fU) << shift;
+                    if ((static_cast<unsigned char>(c) & 0x80U) == 0) {
+                        return true;
+                    }
+                }
+                throw osmium::pbf_error{"illegal varint"};
+            }
+
+            template <typename TSource>
+            void pbf_source_skip(TSource& source, std::size_t size) {
+                if (!source.skip(size)) {
+                    throw osmium::pbf_error{"truncated data in PrimitiveBlock"};
+                }
+            }
+
+            /**
+             * Find out which kinds of OSM entities are in a PrimitiveBlock
+             * without decoding the entities. Only the keys of the top-level
+             * fields and the first key in each PrimitiveGroup are looked at,
+             * everything else is skipped.
+             *
+             * @param source The source to read the PrimitiveBlock from.
+             */
+            template <typename TSource>
+            osmium::osm_entity_bits::type scan_primitive_block(TSource& source) {
+                osmium::osm_entity_bits::type types = osmium::osm_entity_bits::nothing;
+
+                uint64_t key = 0;
+                while (pbf_source_read_varint(source, &key)) {
+                    uint64_t value = 0;
+                    switch (static_cast<protozero::pbf_wire_type>(key & 0x07U)) {
+                        case protozero::pbf_wire_type::varint:
+                            pbf_source_read_varint(source, &value);
+                            break;
+                        case protozero::pbf_wire_type::fixed64:
+                            pbf_source_skip(source, 8);
+                            break;
+                        case protozero::pbf_wire_type::fixed32:
+                            pbf_source_skip(source, 4);
+                            break;
+                        case protozero::pbf_wire_type::length_delimited:
+                            if (!pbf_source_read_varint(source, &value)) {
+                                throw osmium::pbf_error{"truncated data in PrimitiveBlock"};
+                            }
+                            if ((key >> 3U) == static_cast<uint64_t>(OSMFormat::PrimitiveBlock::repeated_PrimitiveGroup_primitivegroup) && value > 0) {
+                                // A PrimitiveGroup only contains entities
+                                // of one type, so the first key is enough.
+                                uint64_t group_key = 0;
+                                char c = 0;
+                                std::size_t group_key_size = 0;
+                                do {
+                                    if (!source.next_byte(&c)) {
+                                        throw osmium::pbf_error{"truncated data in PrimitiveBlock"};
+                                    }
+                                    group_key |= static_cast<uint64_t>(static_cast<unsigned char>(c) & 0x7fU) << (7U * group_key_size);
+                                    ++group_key_size;
+                                } while ((static_cast<unsigned char>(c) & 0x80U) && group_key_size < 10);
+                                if (group_key_size > value) {
+                                    throw osmium::pbf_error{"PBF format error"};
+                                }
+                                switch (static_cast<OSMFormat::PrimitiveGroup>(group_key >> 3U)) {
+                                    case OSMFormat::PrimitiveGroup::repeated_Node_nodes:
+                                    case OSMFormat::PrimitiveGroup::optional_DenseNodes_dense:
+                                        types |= osmium::osm_entity_bits::node;
+                                        break;
+                                    case OSMFormat::PrimitiveGroup::repeated_Way_ways:
+                                        types |= osmium::osm_entity_bits::way;
+                                        break;
+                                    case OSMFormat::PrimitiveGroup::repeated_Relation_relations:
+                                        types |= osmium::osm_entity_bits::relation;
+                                        break;
+                                    case OSMFormat::PrimitiveGroup::repeated_ChangeSet_changesets:
+                                        types |= osmium::osm_entity_bits::changeset;
+                                        break;
+                                    default:
+                                        break;
+                                }
+                                value -= group_key_size;
+                            }
+                            pbf_source_skip(source, value);
+                            break;
+                        default:
+                            throw osmium::pbf_error{"unknown wire type in PrimitiveBlock"};
+                    }
+                }
+
+                return types;
+            }
+
+            /**
+             * Information about one OSMData blob in a PBF file.
+             */
+            struct pbf_blob_info {
+
+                /// Offset of the Blob (after the BlobHeader) in the file.
+                std::size_t offset;
+
+                /// Size of the Blob in bytes.
+                std::size_t size;
+
+                /// The kinds of entities in this blob.
+                osmium::osm_entity_bits::type types;
+
+            }; // struct pbf_blob_info
+
+            /**
+             * Find out which kinds of OSM entities are in the blob at the
+             * given position in the file.
+             *
+             * zlib-compressed blobs are uncompressed in small chunks so
+             * the memory use stays low, but the whole blob has to be read
+             * and uncompressed to find all PrimitiveGroups.
+             */
+            inline osmium::osm_entity_bits::type scan_blob_entity_types(int fd, std::size_t offset, std::size_t size) {
+                // The Blob message starts with a few small fields, followed
+                // by the (large) data field. We read a bit of the start
+                // to find out where the data is.
+                std::array<char, 32> prefix{};
+                const auto prefix_size = std::min(size, prefix.size());
+                if (!read_exactly_at(fd, prefix.data(), prefix_size, offset)) {
+                    throw osmium::pbf_error{"truncated data (EOF encountered)"};
+                }
+
+                const char* data = prefix.data();
+                const char* const end = prefix.data() + prefix_size;
+                while (data != end) {
+                    const auto key = protozero::decode_varint(&data, end);
+                    const auto wire_type = static_cast<protozero::pbf_wire_type>(key & 0x07U);
+                    if (wire_type == protozero::pbf_wire_type::varint) {
+                        protozero::decode_varint(&data, end);
+                        continue;
+                    }
+                    if (wire_type != protozero::pbf_wire_type::length_delimited) {
+                        break;
+                    }
+                    const auto length = protozero::decode_varint(&data, end);
+                    if (static_cast<FileFormat::Blob>(key >> 3U) == FileFormat::Blob::optional_bytes_zlib_data) {
+                        const std::size_t data_offset = offset + static_cast<std::size_t>(data - prefix.data());
+                        if (data_offset + length > offset + size) {
+                            throw osmium::pbf_error{"PBF format error: invalid blob"};
+                        }
+                        pbf_zlib_file_source source{fd, data_offset, static_cast<std::size_t>(length)};
+                        return scan_primitive_block(source);
+                    }
+                    break;
+                }
+
+                // Not zlib-compressed or unusual field order: Read and
+                // decode the whole blob.
+                std::string blob(size, '\0');
+                if (!read_exactly_at(fd, &*blob.begin(), size, offset)) {
+                    throw osmium::pbf_error{"truncated data (EOF encountered)"};
+                }
+                std::string output;
+                pbf_memory_source source{decode_blob(blob, output)};
+                return scan_primitive_block(source);
+            }
+
+            /**
+             * Index of all OSMData blobs in a PBF file. Can be created by
+             * scanning a file (see create()) or read from a sidecar file
+             * (see load()).
+             */
+            class PBFBlobIndex {
+
+                std::vector<pbf_blob_info> m_blobs;
+                std::size_t m_file_size = 0;
+                int64_t m_file_mtime = 0;
+                uint32_t m_file_checksum = 0;
+
+                static const char* magic() noexcept {
+                    return "osmium-pbf-blob-index";
+                }
+
+                enum {
+                    index_format_version = 2
+                };
+
+                enum : std::size_t {
+                    checksum_size = 1024UL * 1024UL
+                };
+
+                static int64_t file_mtime(int fd) {
+#ifdef _MSC_VER
+                    struct _stat64 s; // NOLINT clang-tidy
+                    if (::_fstat64(fd, &s) != 0) {
+#else
+                    struct stat s; // NOLINT clang-tidy
+                    if (::fstat(fd, &s) != 0) {
+#endif
+                        throw std::system_error{errno, std::system_category(), "Could not get file modification time"};
+                    }
+                    return static_cast<int64_t>(s.st_mtime);
+                }
+
+                // CRC32 of the start of the file which contains the
+                // OSMHeader blob and the first OSMData blobs.
+                static uint32_t file_checksum(int fd, std::size_t file_size) {
+                    std::array<char, 64UL * 1024UL> buffer{};
+                    uLong crc = ::crc32(0L, Z_NULL, 0);
+                    const auto end = std::min(file_size, static_cast<std::size_t>(checksum_size));
+                    for (std::size_t offset = 0; offset < end;) {
+                        const auto size = std::min(end - offset, buffer.size());
+                        if (!read_exactly_at(fd, buffer.data(), size, offset)) {
+                            throw osmium::pbf_error{"truncated data (EOF encountered)"};
+                        }
+                        crc = ::crc32(crc, reinterpret_cast<const unsigned char*>(buffer.data()), static_cast<uInt>(size));
+                        offset += size;
+                    }
+                    return static_cast<uint32_t>(crc);
+                }
+
+            public:
+
+                PBFBlobIndex() = default;
+
+                /**
+                 * Create an index by scanning the PBF file with the given
+                 * file descriptor. The file offset of fd is not changed.
+                 *
+                 * Finding out which entity types are in a blob means
+                 * reading and uncompressing the whole blob, so this costs
+                 * about as much as decoding the file without the entities.
+                 * Use save() and load() (or the pbf_blob_index_file option)
+                 * to pay the cost of the scan only once.
+                 *
+                 * @throws osmium::pbf_error If the file is not a valid PBF file.
+                 * @throws std::system_error If the file could not be read.
+                 */
+                static PBFBlobIndex create(int fd, std::size_t file_size) {
+                    PBFBlobIndex index;
+                    index.m_file_size = file_size;
+                    index.m_file_mtime = file_mtime(fd);
+                    index.m_file_checksum = file_checksum(fd, file_size);
+
+                    std::string blob_header;
+                    std::size_t offset = 0;
+                    while (offset < file_size) {
+                        std::array<char, sizeof(uint32_t)> size_data{};
+                        if (!read_exactly_at(fd, size_data.data(), size_data.size(), offset)) {
+                            throw osmium::pbf_error{"truncated data (EOF encountered)"};
+                        }
+                        const auto* d = reinterpret_cast<const unsigned char*>(size_data.data());
+                        const uint32_t header_size = (static_cast<uint32_t>(d[0]) << 24U) |
+                                                     (static_cast<uint32_t>(d[1]) << 16U) |
+                                                     (static_cast<uint32_t>(d[2]) <<  8U) |
+                                                      static_cast<uint32_t>(d[3]);
+                        if (header_size == 0 || header_size > static_cast<uint32_t>(max_blob_header_size)) {
+                            throw osmium::pbf_error{"invalid BlobHeader size (> max_blob_header_size)"};
+                        }
+                        offset += size_data.size();
+
+                        blob_header.resize(header_size);
+                        if (!read_exactly_at(fd, &*blob_header.begin(), header_size, offset)) {
+                            throw osmium::pbf_error{"truncated data (EOF encountered)"};
+                        }
+                        offset += header_size;
+
+                        const auto type_and_size = decode_blob_header_type_and_size(protozero::data_view{blob_header.data(), blob_header.size()});
+                        if (type_and_size.second > max_uncompressed_blob_size) {
+                            throw osmium::pbf_error{std::string{"invalid blob size: "} +
+                                                    std::to_string(type_and_size.second)};
+                        }
+                        if (offset + type_and_size.second > file_size) {
+                            throw osmium::pbf_error{"truncated data (EOF encountered)"};
+                        }
+
+                        const auto& type = type_and_size.first;
+                        if (type.size() == std::strlen("OSMData") && !std::strncmp("OSMData", type.data(), type.size())) {
+                            index.m_blobs.push_back(pbf_blob_info{offset,
+                                                                  type_and_size.second,
+                                                                  scan_blob_entity_types(fd, offset, type_and_size.second)});
+                        }
+                        offset += type_and_size.second;
+                    }
+
+                    return index;
+                }
+
+                /**
+                 * Load an index from the sidecar file with the given name
+                 * for the PBF file with the given file descriptor.
+                 * Returns false if the file can not be opened or if it
+                 * doesn't fit the PBF file (detected by comparing the file
+                 * size, modification time, and a checksum of the start of
+                 * the file), the index is unchanged in that case.
+                 *
+                 * @throws osmium::pbf_error If the index file is corrupt.
+                 * @throws std::system_error If the PBF file could not be read.
+                 */
+                bool load(const std::string& filename, int fd) {
+                    std::ifstream file{filename};
+                    if (!file) {
+                        return false;
+                    }
+
+                    std::string magic_string;
+                    int version = 0;
+                    file >> magic_string >> version;
+                    if (!file || magic_string != magic()) {
+                        throw osmium::pbf_error{"invalid blob index file '" + filename + "'"};
+                    }
+
+                    // Index files written by other versions are outdated,
+                    // they will be recreated.
+                    if (version != index_format_version) {
+                        return false;
+                    }
+
+                    std::size_t indexed_file_size = 0;
+                    int64_t indexed_file_mtime = 0;
+                    uint32_t indexed_file_checksum = 0;
+                    file >> indexed_file_size >> indexed_file_mtime >> indexed_file_checksum;
+                    if (!file) {
+                        throw osmium::pbf_error{"invalid blob index file '" + filename + "'"};
+                    }
+
+                    const auto file_size = osmium::util::file_size(fd);
+                    if (indexed_file_size != file_size ||
+                        indexed_file_mtime != file_mtime(fd) ||
+                        indexed_file_checksum != file_checksum(fd, file_size)) {
+                        return false;
+                    }
+
+                    std::vector<pbf_blob_info> blobs;
+                    std::size_t offset = 0;
+                    std::size_t size = 0;
+                    unsigned int types = 0;
+                    while (file >> offset >> size >> types) {
+                        if (offset + size > file_size || size > max_uncompressed_blob_size || types > osmium::osm_entity_bits::all) {
+                            throw osmium::pbf_error{"invalid blob index file '" + filename + "'"};
+                        }
+                        blobs.push_back(pbf_blob_info{offset, size, static_cast<osmium::osm_entity_bits::type>(types)});
+                    }
+                    if (!file.eof()) {
+                        throw osmium::pbf_error{"invalid blob index file '" + filename + "'"};
+                    }
+
+                    m_blobs = std::move(blobs);
+                    m_file_size = file_size;
+                    m_file_mtime = indexed_file_mtime;
+                    m_file_checksum = indexed_file_checksum;
+                    return true;
+                }
+
+                /**
+                 * Save index into a sidecar file with the given name.
+                 *
+                 * @throws osmium::io_error If the file could not be written.
+                 */
+                void save(const std::string& filename) const {
+                    std::ofstream file{filename};
+                    file << magic() << ' ' << static_cast<int>(index_format_version) << ' ' << m_file_size << ' ' << m_file_mtime << ' ' << m_file_checksum << '\n';
+                    for (const auto& blob : m_blobs) {
+                        file << blob.offset << ' ' << blob.size << ' ' << static_cast<unsigned int>(blob.types) << '\n';
+                    }
+                    file.close();
+                    if (!file) {
+                        throw osmium::io_error{"could not write blob index file '" + filename + "'"};
+                    }
+                }
+
+                std::size_t size() const noexcept {
+                    return m_blobs.size();
+                }
+
+                bool empty() const noexcept {
+                    return m_blobs.empty();
+                }
+
+                std::vector<pbf_blob_info>::const_iterator begin() const noexcept {
+                    return m_blobs.cbegin();
+                }
+
+                std::vector<pbf_blob_info>::const_iterator end() const noexcept {
+                    return m_blobs.cend();
+                }
+
+            }; // class PBFBlobIndex
+
+            /**
+             * Owns a file descriptor shared between the parser and the pool
+             * threads reading from it. The file is closed when the last
+             * user is done with it.
+             */
+            class pbf_shared_fd {
+
+                int m_fd;
+
+            public:
+
+                explicit pbf_shared_fd(int fd) noexcept :
+                    m_fd(fd) {
+                }
+
+                pbf_shared_fd(const pbf_shared_fd&) = delete;
+                pbf_shared_fd& operator=(const pbf_shared_fd&) = delete;
+
+                pbf_shared_fd(pbf_shared_fd&&) = delete;
+                pbf_shared_fd& operator=(pbf_shared_fd&&) = delete;
+
+                ~pbf_shared_fd() noexcept {
+                    try {
+                        reliable_close(m_fd);
+                    } catch (...) {
+                        // Ignore any exceptions because destructor must not throw.
+                    }
+                }
+
+                int fd() const noexcept {
+                    return m_fd;
+                }
+
+            }; // class pbf_shared_fd
+
+            /**
+             * Reads an OSMData blob from the given place in the file and
+             * decodes it. Used instead of PBFDataBlobDecoder when reading
+             * with a blob index so that the reading is done in the pool
+             * threads.
+             */
+            class PBFIndexedBlobDecoder {
+
+                std::shared_ptr<pbf_shared_fd> m_fd;
+                pbf_blob_info m_blob;
+                osmium::osm_entity_bits::type m_read_types;
+                osmium::io::read_meta m_read_metadata;
+                osmium::io::tags_prefilter m_tags_filter;
+                osmium::io::location_prefilter m_location_filter;
+                osmium::thread::Pool* m_pool;
+                osmium::memory::BufferPool* m_buffer_pool;
+
+            public:
+
+                PBFIndexedBlobDecoder(std::shared_ptr<pbf_shared_fd> fd, const pbf_blob_info& blob, const osmium::osm_entity_bits::type read_types, const osmium::io::read_meta read_metadata, const osmium::io::tags_prefilter& tags_filter = osmium::io::tags_prefilter{}, const osmium::io::location_prefilter& location_filter = osmium::io::location_prefilter{}, osmium::thread::Pool* pool = nullptr, osmium::memory::BufferPool* buffer_pool = nullptr) :
+                    m_fd(std::move(fd)),
+                    m_blob(blob),
+                    m_read_types(read_types),
+                    m_read_metadata(read_metadata),
+                    m_tags_filter(tags_filter),
+                    m_location_filter(location_filter),
+                    m_pool(pool),
+                    m_buffer_pool(buffer_pool) {
+                }
+
+                osmium::memory::Buffer operator()() {
+                    std::string input_buffer(m_blob.size, '\0');
+                    if (!read_exactly_at(m_fd->fd(), &*input_buffer.begin(), m_blob.size, m_blob.offset)) {
+                        throw osmium::pbf_error{"unexpected EOF"};
+                    }
+
+                    PBFDataBlobDecoder decoder{std::move(input_buffer), m_read_types, m_read_metadata, m_tags_filter, m_location_filter, m_pool, m_buffer_pool};
+                    return decoder();
+                }
+
+            }; // class PBFIndexedBlobDecoder
+
+        } // namespace detail
+
+    } // namespace io
+
+} // namespace osmium
+
+#endif // OSMIUM_IO_DETAIL_PBF_BLOB_INDEX_HPP
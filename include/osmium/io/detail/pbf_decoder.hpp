@@ -33,22 +33,29 @@ DEALINGS IN THE SOFTWARE.
 
 */
 
+#include <algorithm>
 #include <cstdint>
 #include <cstring>
+#include <future>
 #include <limits>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include <osmium/builder/osm_object_builder.hpp>
 #include <osmium/io/detail/pbf.hpp> // IWYU pragma: export
+#include <osmium/io/detail/pbf_varint.hpp>
 #include <osmium/io/detail/protobuf_tags.hpp>
 #include <osmium/io/detail/zlib.hpp>
 #include <osmium/io/file_format.hpp>
 #include <osmium/io/header.hpp>
+#include <osmium/io/location_prefilter.hpp>
+#include <osmium/io/tags_prefilter.hpp>
 #include <osmium/memory/buffer.hpp>
+#include <osmium/memory/buffer_pool.hpp>
 #include <osmium/osm/box.hpp>
 #include <osmium/osm/entity_bits.hpp>
 #include <osmium/osm/item_type.hpp>
@@ -59,12 +66,18 @@ DEALINGS IN THE SOFTWARE.
 #include <osmium/osm/timestamp.hpp>
 #include <osmium/osm/types.hpp>
 #include <osmium/osm/way.hpp>
+#include <osmium/thread/pool.hpp>
 #include <osmium/util/delta.hpp>
+#include <osmium/util/memory_mapping.hpp>
 
 #ifdef OSMIUM_WITH_LZ4
 # include <osmium/io/detail/lz4.hpp>
 #endif
 
+#ifdef OSMIUM_WITH_ZSTD
+# include <osmium/io/detail/zstd.hpp>
+#endif
+
 #include <protozero/iterators.hpp>
 #include <protozero/pbf_message.hpp>
 #include <protozero/types.hpp>
@@ -136,14 +149,76 @@ namespace osmium {
 
             using osm_string_len_type = std::pair<const char*, osmium::string_size_type>;
 
+            // Scratch space for bulk decoding of packed fields. There is
+            // one per thread, reused for all blocks decoded in that thread
+            // to save on memory allocations.
+            struct pbf_decode_columns {
+                std::vector<int64_t> ids;
+                std::vector<int64_t> lats;
+                std::vector<int64_t> lons;
+                std::vector<int32_t> tags;
+
+                // DenseInfo of DenseNodes
+                std::vector<int32_t> versions;
+                std::vector<int64_t> timestamps;
+                std::vector<int64_t> changesets;
+                std::vector<int64_t> uids;
+                std::vector<int64_t> user_sids;
+                std::vector<int32_t> visibles;
+            };
+
+            inline pbf_decode_columns& thread_decode_columns() {
+                static thread_local pbf_decode_columns columns;
+                return columns;
+            }
+
+            // Get the visible flag from an Info message.
+            inline bool decode_info_visible(const data_view& data) {
+                bool visible = true;
+                protozero::pbf_message<OSMFormat::Info> pbf_info{data};
+                while (pbf_info.next(OSMFormat::Info::optional_bool_visible, protozero::pbf_wire_type::varint)) {
+                    visible = pbf_info.get_bool();
+                }
+                return visible;
+            }
+
             class PBFPrimitiveBlockDecoder {
 
                 enum {
                     initial_buffer_size = 64UL * 1024UL
                 };
 
+                // Buffers from a buffer pool are created large enough for
+                // all objects in the block: They need about five times as
+                // much memory as their PBF encoding, a bit more with
+                // metadata.
+                enum : std::size_t {
+                    buffer_size_factor = 6UL,
+                    max_initial_buffer_size = 64UL * 1024UL * 1024UL
+                };
+
+                // Groups with at least twice this many objects are split
+                // into parts decoded in the pool threads. This is the
+                // number of objects in a block written by libosmium, so
+                // usual files are not affected.
+                enum : std::size_t {
+                    min_objects_per_part = 8000UL
+                };
+
+                // Minimum number of bytes an object takes in a group (key
+                // and length of the object, key and value of the id).
+                enum : std::size_t {
+                    min_object_size = 4UL
+                };
+
                 data_view m_data;
-                std::vector<osm_string_len_type> m_stringtable;
+
+                // The string table is read by the decoder for the whole
+                // block. Decoders for parts of the block (see the private
+                // constructor) use the one from the parent decoder which
+                // waits for them to finish.
+                std::vector<osm_string_len_type> m_own_stringtable;
+                const std::vector<osm_string_len_type>& m_stringtable;
 
                 int64_t m_lon_offset = 0;
                 int64_t m_lat_offset = 0;
@@ -152,10 +227,36 @@ namespace osmium {
 
                 osmium::osm_entity_bits::type m_read_types;
 
-                osmium::memory::Buffer m_buffer{initial_buffer_size, osmium::memory::Buffer::auto_grow::internal};
+                osmium::memory::Buffer m_buffer;
 
                 osmium::io::read_meta m_read_metadata;
 
+                pbf_decode_columns* m_columns = nullptr;
+
+                osmium::io::tags_prefilter m_tags_filter;
+                osmium::io::location_prefilter m_location_filter;
+
+                // Pool used for decoding large groups in parts, nullptr if
+                // they should not be split.
+                osmium::thread::Pool* m_pool = nullptr;
+
+                // Pool for the memory of the buffers, nullptr if the
+                // buffers should be allocated as needed.
+                osmium::memory::BufferPool* m_buffer_pool = nullptr;
+
+                // The tags filter needs null-terminated strings, the
+                // strings in the string table are not. So if there is a
+                // filter, copies of all strings are kept here. Shared
+                // with the part decoders like the string table.
+                std::string m_own_filter_strings;
+                std::vector<std::size_t> m_own_filter_string_offsets;
+                const std::string& m_filter_strings;
+                const std::vector<std::size_t>& m_filter_string_offsets;
+
+                // Results of the tags filter for each combination of key
+                // and value (string table indexes) seen in this block.
+                std::unordered_map<uint64_t, bool> m_filter_results;
+
                 void decode_stringtable(const data_view& data) {
                     if (!m_stringtable.empty()) {
                         throw osmium::pbf_error{"more than one stringtable in pbf file"};
@@ -168,7 +269,153 @@ namespace osmium {
                             const std::string start_of_string(str_view.data(), 20);
                             throw osmium::pbf_error{"overlong string (" +  start_of_string + "...) in string table"};
                         }
-                        m_stringtable.emplace_back(str_view.data(), static_cast<osmium::string_size_type>(str_view.size()));
+                        m_own_stringtable.emplace_back(str_view.data(), static_cast<osmium::string_size_type>(str_view.size()));
+                        if (!m_tags_filter.empty()) {
+                            m_own_filter_string_offsets.push_back(m_own_filter_strings.size());
+                            m_own_filter_strings.append(str_view.data(), str_view.size());
+                            m_own_filter_strings += '\0';
+                        }
+                    }
+                }
+
+                bool tag_matches_filter(const uint32_t key, const uint32_t value) {
+                    const uint64_t key_value = (static_cast<uint64_t>(key) << 32U) | value;
+                    const auto it = m_filter_results.find(key_value);
+                    if (it != m_filter_results.end()) {
+                        return it->second;
+                    }
+
+                    const bool result = m_tags_filter(m_filter_strings.data() + m_filter_string_offsets.at(key),
+                                                      m_filter_strings.data() + m_filter_string_offsets.at(value));
+                    m_filter_results.emplace(key_value, result);
+                    return result;
+                }
+
+                // Check the tags of a Node, Way, or Relation message against
+                // the tags filter before anything is built.
+                template <typename TMessage>
+                bool keep_object(const data_view& data, const osmium::osm_entity_bits::type type) {
+                    if (!(m_tags_filter.entities() & type)) {
+                        return true;
+                    }
+
+                    varint_range keys;
+                    varint_range vals;
+
+                    protozero::pbf_message<TMessage> pbf_object{data};
+                    while (pbf_object.next()) {
+                        switch (pbf_object.tag_and_type()) {
+                            case protozero::tag_and_type(TMessage::packed_uint32_keys, protozero::pbf_wire_type::length_delimited):
+                                keys = varint_range{pbf_object.get_view()};
+                                break;
+                            case protozero::tag_and_type(TMessage::packed_uint32_vals, protozero::pbf_wire_type::length_delimited):
+                                vals = varint_range{pbf_object.get_view()};
+                                break;
+                            default:
+                                pbf_object.skip();
+                        }
+                    }
+
+                    return tags_match_filter(keys, vals);
+                }
+
+                bool tags_match_filter(varint_range& keys, varint_range& vals) {
+                    while (!keys.empty() && !vals.empty()) {
+                        if (tag_matches_filter(keys.next_uint32(), vals.next_uint32())) {
+                            return true;
+                        }
+                    }
+                    return false;
+                }
+
+                // Check a Node message against the location and tags
+                // filters before anything is built.
+                bool keep_node(const data_view& data) {
+                    if (m_location_filter.empty()) {
+                        return keep_object<OSMFormat::Node>(data, osmium::osm_entity_bits::node);
+                    }
+
+                    varint_range keys;
+                    varint_range vals;
+                    bool visible = true;
+                    int64_t lon = std::numeric_limits<int64_t>::max();
+                    int64_t lat = std::numeric_limits<int64_t>::max();
+
+                    protozero::pbf_message<OSMFormat::Node> pbf_node{data};
+                    while (pbf_node.next()) {
+                        switch (pbf_node.tag_and_type()) {
+                            case protozero::tag_and_type(OSMFormat::Node::packed_uint32_keys, protozero::pbf_wire_type::length_delimited):
+                                keys = varint_range{pbf_node.get_view()};
+                                break;
+                            case protozero::tag_and_type(OSMFormat::Node::packed_uint32_vals, protozero::pbf_wire_type::length_delimited):
+                                vals = varint_range{pbf_node.get_view()};
+                                break;
+                            case protozero::tag_and_type(OSMFormat::Node::optional_Info_info, protozero::pbf_wire_type::length_delimited):
+                                visible = decode_info_visible(pbf_node.get_view());
+                                break;
+                            case protozero::tag_and_type(OSMFormat::Node::required_sint64_lat, protozero::pbf_wire_type::varint):
+                                lat = pbf_node.get_sint64();
+                                break;
+                            case protozero::tag_and_type(OSMFormat::Node::required_sint64_lon, protozero::pbf_wire_type::varint):
+                                lon = pbf_node.get_sint64();
+                                break;
+                            default:
+                                pbf_node.skip();
+                        }
+                    }
+
+                    // Nodes with missing coordinates are kept, decode_node()
+                    // will complain about them.
+                    if (visible &&
+                        lon != std::numeric_limits<int64_t>::max() &&
+                        lat != std::numeric_limits<int64_t>::max() &&
+                        !m_location_filter.contains(osmium::Location{convert_pbf_lon(lon), convert_pbf_lat(lat)})) {
+                        return false;
+                    }
+
+                    return !(m_tags_filter.entities() & osmium::osm_entity_bits::node) || tags_match_filter(keys, vals);
+                }
+
+                // Check if any of the tags of the dense node starting at
+                // tag_pos matches the tags filter.
+                bool dense_node_tags_match_filter(std::size_t tag_pos) {
+                    const auto& tags = m_columns->tags;
+                    while (tag_pos < tags.size() && tags[tag_pos] != 0) {
+                        if (tag_pos + 1 == tags.size()) {
+                            throw osmium::pbf_error{"PBF format error"}; // this is against the spec, keys/vals must come in pairs
+                        }
+                        if (tag_matches_filter(static_cast<uint32_t>(tags[tag_pos]), static_cast<uint32_t>(tags[tag_pos + 1]))) {
+                            return true;
+                        }
+                        tag_pos += 2;
+                    }
+                    return false;
+                }
+
+                // Check the dense node with index i against the location and
+                // tags filters. If the node is dropped, tag_pos is moved to
+                // the start of the tags of the next node.
+                bool keep_dense_node(std::size_t i, std::size_t& tag_pos, bool visible) {
+                    const bool keep = (!visible || m_location_filter.empty() ||
+                                       m_location_filter.contains(osmium::Location{convert_pbf_lon(m_columns->lons[i]), convert_pbf_lat(m_columns->lats[i])})) &&
+                                      (!(m_tags_filter.entities() & osmium::osm_entity_bits::node) || dense_node_tags_match_filter(tag_pos));
+                    if (!keep) {
+                        skip_dense_node_tags(tag_pos);
+                    }
+                    return keep;
+                }
+
+                // Move tag_pos to the start of the tags of the next dense
+                // node.
+                void skip_dense_node_tags(std::size_t& tag_pos) const noexcept {
+                    const auto& tags = m_columns->tags;
+                    while (tag_pos < tags.size()) {
+                        if (tags[tag_pos++] == 0) {
+                            return;
+                        }
+                        if (tag_pos < tags.size()) {
+                            ++tag_pos;
+                        }
                     }
                 }
 
@@ -197,53 +444,173 @@ namespace osmium {
                     }
                 }
 
+                void decode_object(const osmium::item_type type, const data_view& data) {
+                    switch (type) {
+                        case osmium::item_type::node:
+                            if (keep_node(data)) {
+                                decode_node(data);
+                                m_buffer.commit();
+                            }
+                            break;
+                        case osmium::item_type::way:
+                            if (keep_object<OSMFormat::Way>(data, osmium::osm_entity_bits::way)) {
+                                decode_way(data);
+                                m_buffer.commit();
+                            }
+                            break;
+                        default:
+                            if (keep_object<OSMFormat::Relation>(data, osmium::osm_entity_bits::relation)) {
+                                decode_relation(data);
+                                m_buffer.commit();
+                            }
+                    }
+                }
+
+                void decode_primitive_group(const data_view& data) {
+                    protozero::pbf_message<OSMFormat::PrimitiveGroup> pbf_primitive_group{data};
+                    while (pbf_primitive_group.next()) {
+                        switch (pbf_primitive_group.tag_and_type()) {
+                            case protozero::tag_and_type(OSMFormat::PrimitiveGroup::repeated_Node_nodes, protozero::pbf_wire_type::length_delimited):
+                                if (m_read_types & osmium::osm_entity_bits::node) {
+                                    decode_object(osmium::item_type::node, pbf_primitive_group.get_view());
+                                } else {
+                                    pbf_primitive_group.skip();
+                                }
+                                break;
+                            case protozero::tag_and_type(OSMFormat::PrimitiveGroup::optional_DenseNodes_dense, protozero::pbf_wire_type::length_delimited):
+                                if (m_read_types & osmium::osm_entity_bits::node) {
+                                    decode_dense_nodes(pbf_primitive_group.get_view());
+                                    m_buffer.commit();
+                                } else {
+                                    pbf_primitive_group.skip();
+                                }
+                                break;
+                            case protozero::tag_and_type(OSMFormat::PrimitiveGroup::repeated_Way_ways, protozero::pbf_wire_type::length_delimited):
+                                if (m_read_types & osmium::osm_entity_bits::way) {
+                                    decode_object(osmium::item_type::way, pbf_primitive_group.get_view());
+                                } else {
+                                    pbf_primitive_group.skip();
+                                }
+                                break;
+                            case protozero::tag_and_type(OSMFormat::PrimitiveGroup::repeated_Relation_relations, protozero::pbf_wire_type::length_delimited):
+                                if (m_read_types & osmium::osm_entity_bits::relation) {
+                                    decode_object(osmium::item_type::relation, pbf_primitive_group.get_view());
+                                } else {
+                                    pbf_primitive_group.skip();
+                                }
+                                break;
+                            default:
+                                pbf_primitive_group.skip();
+                        }
+                    }
+                }
+
                 void decode_primitive_block_data() {
                     protozero::pbf_message<OSMFormat::PrimitiveBlock> pbf_primitive_block{m_data};
                     while (pbf_primitive_block.next(OSMFormat::PrimitiveBlock::repeated_PrimitiveGroup_primitivegroup, protozero::pbf_wire_type::length_delimited)) {
-                        protozero::pbf_message<OSMFormat::PrimitiveGroup> pbf_primitive_group = pbf_primitive_block.get_message();
-                        while (pbf_primitive_group.next()) {
-                            switch (pbf_primitive_group.tag_and_type()) {
-                                case protozero::tag_and_type(OSMFormat::PrimitiveGroup::repeated_Node_nodes, protozero::pbf_wire_type::length_delimited):
-                                    if (m_read_types & osmium::osm_entity_bits::node) {
-                                        decode_node(pbf_primitive_group.get_view());
-                                        m_buffer.commit();
-                                    } else {
-                                        pbf_primitive_group.skip();
-                                    }
-                                    break;
-                                case protozero::tag_and_type(OSMFormat::PrimitiveGroup::optional_DenseNodes_dense, protozero::pbf_wire_type::length_delimited):
-                                    if (m_read_types & osmium::osm_entity_bits::node) {
-                                        if (m_read_metadata == osmium::io::read_meta::yes) {
-                                            decode_dense_nodes(pbf_primitive_group.get_view());
-                                        } else {
-                                            decode_dense_nodes_without_metadata(pbf_primitive_group.get_view());
-                                        }
-                                        m_buffer.commit();
-                                    } else {
-                                        pbf_primitive_group.skip();
-                                    }
-                                    break;
-                                case protozero::tag_and_type(OSMFormat::PrimitiveGroup::repeated_Way_ways, protozero::pbf_wire_type::length_delimited):
-                                    if (m_read_types & osmium::osm_entity_bits::way) {
-                                        decode_way(pbf_primitive_group.get_view());
-                                        m_buffer.commit();
-                                    } else {
-                                        pbf_primitive_group.skip();
-                                    }
-                                    break;
-                                case protozero::tag_and_type(OSMFormat::PrimitiveGroup::repeated_Relation_relations, protozero::pbf_wire_type::length_delimited):
-                                    if (m_read_types & osmium::osm_entity_bits::relation) {
-                                        decode_relation(pbf_primitive_group.get_view());
-                                        m_buffer.commit();
-                                    } else {
-                                        pbf_primitive_group.skip();
-                                    }
-                                    break;
-                                default:
-                                    pbf_primitive_group.skip();
-                            }
+                        const auto data = pbf_primitive_block.get_view();
+                        if (!decode_primitive_group_in_parallel(data)) {
+                            decode_primitive_group(data);
+                        }
+                    }
+                }
+
+                // Should a group with this many objects be split up and
+                // decoded in several pool threads? Returns the number of
+                // parts or 0 if it should not be split.
+                std::size_t number_of_parts(const std::size_t size) const noexcept {
+                    if (!m_pool || m_pool->num_threads() < 2 || size < 2 * min_objects_per_part) {
+                        return 0;
+                    }
+                    return std::min(size / min_objects_per_part, 2 * static_cast<std::size_t>(m_pool->num_threads()));
+                }
+
+                // Wait for the buffers decoded in the pool threads and
+                // append their contents in order to our buffer.
+                void append_parts(std::vector<std::future<osmium::memory::Buffer>>& futures) {
+                    for (const auto& future : futures) {
+                        m_pool->help_while_waiting(future, osmium::thread::task_priority::high);
+                    }
+                    for (auto& future : futures) {
+                        osmium::memory::Buffer buffer{future.get()};
+                        while (buffer.has_nested_buffers()) {
+                            const auto nested = buffer.get_last_nested();
+                            m_buffer.add_buffer(*nested);
+                            m_buffer.commit();
+                        }
+                        m_buffer.add_buffer(buffer);
+                        m_buffer.commit();
+                        if (m_buffer_pool) {
+                            m_buffer_pool->put(std::move(buffer));
+                        }
+                    }
+                }
+
+                // If the group contains many nodes (non-dense), ways, or
+                // relations, decode them in several parts in the pool
+                // threads. Groups which turn out to be too small after
+                // they have been scanned are decoded here from the scanned
+                // objects. Returns false if the group wasn't decoded
+                // because it can't be split (DenseNodes or too small to
+                // contain enough objects) or the pool isn't available.
+                bool decode_primitive_group_in_parallel(const data_view& data) {
+                    if (!m_pool || m_pool->num_threads() < 2 || data.size() < 2 * min_objects_per_part * min_object_size) {
+                        return false;
+                    }
+
+                    std::vector<data_view> objects;
+                    auto type = osmium::item_type::undefined;
+
+                    protozero::pbf_message<OSMFormat::PrimitiveGroup> pbf_primitive_group{data};
+                    while (pbf_primitive_group.next()) {
+                        switch (pbf_primitive_group.tag_and_type()) {
+                            case protozero::tag_and_type(OSMFormat::PrimitiveGroup::repeated_Node_nodes, protozero::pbf_wire_type::length_delimited):
+                                type = osmium::item_type::node;
+                                objects.push_back(pbf_primitive_group.get_view());
+                                break;
+                            case protozero::tag_and_type(OSMFormat::PrimitiveGroup::repeated_Way_ways, protozero::pbf_wire_type::length_delimited):
+                                type = osmium::item_type::way;
+                                objects.push_back(pbf_primitive_group.get_view());
+                                break;
+                            case protozero::tag_and_type(OSMFormat::PrimitiveGroup::repeated_Relation_relations, protozero::pbf_wire_type::length_delimited):
+                                type = osmium::item_type::relation;
+                                objects.push_back(pbf_primitive_group.get_view());
+                                break;
+                            default:
+                                // A group contains only one kind of
+                                // object, so this is a group with
+                                // DenseNodes (or something unknown).
+                                return false;
+                        }
+                    }
+
+                    if (!(m_read_types & osmium::osm_entity_bits::from_item_type(type))) {
+                        return true;
+                    }
+
+                    const std::size_t parts = number_of_parts(objects.size());
+                    if (parts == 0) {
+                        for (const auto& object : objects) {
+                            decode_object(type, object);
                         }
+                        return true;
                     }
+
+                    std::vector<std::future<osmium::memory::Buffer>> futures;
+                    const std::size_t part_size = (objects.size() + parts - 1) / parts;
+                    for (std::size_t first = 0; first < objects.size(); first += part_size) {
+                        const std::size_t last = std::min(first + part_size, objects.size());
+                        futures.push_back(m_pool->submit([this, &objects, type, first, last, parts]() {
+                            PBFPrimitiveBlockDecoder part{*this, &thread_decode_columns(), m_data.size() / parts};
+                            for (std::size_t i = first; i < last; ++i) {
+                                part.decode_object(type, objects[i]);
+                            }
+                            return std::move(part.m_buffer);
+                        }, osmium::thread::task_priority::high));
+                    }
+
+                    append_parts(futures);
+                    return true;
                 }
 
                 osm_string_len_type decode_info(const data_view& data, osmium::OSMObject& object) {
@@ -383,9 +750,9 @@ namespace osmium {
 
                     varint_range keys;
                     varint_range vals;
-                    varint_range refs;
-                    varint_range lats;
-                    varint_range lons;
+                    data_view refs;
+                    data_view lats;
+                    data_view lons;
 
                     osm_string_len_type user{"", 0};
 
@@ -409,13 +776,13 @@ namespace osmium {
                                 }
                                 break;
                             case protozero::tag_and_type(OSMFormat::Way::packed_sint64_refs, protozero::pbf_wire_type::length_delimited):
-                                refs = varint_range{pbf_way.get_view()};
+                                refs = pbf_way.get_view();
                                 break;
                             case protozero::tag_and_type(OSMFormat::Way::packed_sint64_lat, protozero::pbf_wire_type::length_delimited):
-                                lats = varint_range{pbf_way.get_view()};
+                                lats = pbf_way.get_view();
                                 break;
                             case protozero::tag_and_type(OSMFormat::Way::packed_sint64_lon, protozero::pbf_wire_type::length_delimited):
-                                lons = varint_range{pbf_way.get_view()};
+                                lons = pbf_way.get_view();
                                 break;
                             default:
                                 pbf_way.skip();
@@ -426,19 +793,20 @@ namespace osmium {
 
                     if (!refs.empty()) {
                         osmium::builder::WayNodeListBuilder wnl_builder{builder};
-                        osmium::DeltaDecode<int64_t> ref;
+                        decode_packed_sint64_delta(refs, m_columns->ids);
                         if (lats.empty()) {
-                            while (!refs.empty()) {
-                                wnl_builder.add_node_ref(ref.update(refs.next_sint64()));
+                            for (const auto ref : m_columns->ids) {
+                                wnl_builder.add_node_ref(ref);
                             }
                         } else {
-                            osmium::DeltaDecode<int64_t> lon;
-                            osmium::DeltaDecode<int64_t> lat;
-                            while (!refs.empty() && !lons.empty() && !lats.empty()) {
+                            decode_packed_sint64_delta(lats, m_columns->lats);
+                            decode_packed_sint64_delta(lons, m_columns->lons);
+                            const auto size = std::min(m_columns->ids.size(), std::min(m_columns->lats.size(), m_columns->lons.size()));
+                            for (std::size_t i = 0; i < size; ++i) {
                                 wnl_builder.add_node_ref(
-                                    ref.update(refs.next_sint64()),
-                                    osmium::Location{convert_pbf_lon(lon.update(lons.next_sint64())),
-                                                     convert_pbf_lat(lat.update(lats.next_sint64()))}
+                                    m_columns->ids[i],
+                                    osmium::Location{convert_pbf_lon(m_columns->lons[i]),
+                                                     convert_pbf_lat(m_columns->lats[i])}
                                 );
                             }
                         }
@@ -514,171 +882,151 @@ namespace osmium {
                     build_tag_list(builder, keys, vals);
                 }
 
-                void build_tag_list_from_dense_nodes(osmium::builder::NodeBuilder& builder, varint_range& tags) {
+                void build_tag_list_from_dense_nodes(osmium::builder::NodeBuilder& builder, std::size_t& tag_pos) {
                     osmium::builder::TagListBuilder tl_builder{builder};
-                    while (!tags.empty()) {
-                        const auto idx = tags.next_int32();
+                    while (tag_pos < m_columns->tags.size()) {
+                        const auto idx = m_columns->tags[tag_pos++];
                         if (idx == 0) {
                             return;
                         }
                         const auto& k = m_stringtable.at(idx);
-                        if (tags.empty()) {
+                        if (tag_pos == m_columns->tags.size()) {
                             throw osmium::pbf_error{"PBF format error"}; // this is against the spec, keys/vals must come in pairs
                         }
-                        const auto& v = m_stringtable.at(tags.next_int32());
+                        const auto& v = m_stringtable.at(m_columns->tags[tag_pos++]);
                         tl_builder.add_tag(k.first, k.second, v.first, v.second);
                     }
                 }
 
-                void decode_dense_nodes_without_metadata(const data_view& data) {
-                    varint_range ids;
-                    varint_range lats;
-                    varint_range lons;
-                    varint_range tags;
+                // Decode the packed ids, lats, lons, and tags of DenseNodes
+                // into the scratch vectors. Returns the number of nodes.
+                std::size_t decode_dense_nodes_columns(const data_view& ids, const data_view& lats, const data_view& lons, const data_view& tags) {
+                    decode_packed_sint64_delta(ids, m_columns->ids);
+                    decode_packed_sint64_delta(lats, m_columns->lats);
+                    decode_packed_sint64_delta(lons, m_columns->lons);
+                    if (m_columns->lats.size() < m_columns->ids.size() ||
+                        m_columns->lons.size() < m_columns->ids.size()) {
+                        // this is against the spec, must have same number of elements
+                        throw osmium::pbf_error{"PBF format error"};
+                    }
+                    decode_packed_varints(tags, m_columns->tags);
+                    return m_columns->ids.size();
+                }
 
-                    protozero::pbf_message<OSMFormat::DenseNodes> pbf_dense_nodes{data};
-                    while (pbf_dense_nodes.next()) {
-                        switch (pbf_dense_nodes.tag_and_type()) {
-                            case protozero::tag_and_type(OSMFormat::DenseNodes::packed_sint64_id, protozero::pbf_wire_type::length_delimited):
-                                ids = varint_range{pbf_dense_nodes.get_view()};
+                // Decode the packed fields of the DenseInfo into the scratch
+                // vectors. The uids and user_sids are sint32 fields, but
+                // decoding them as sint64 gives the same values.
+                void decode_dense_info_columns(const data_view& data) {
+                    data_view versions;
+                    data_view timestamps;
+                    data_view changesets;
+                    data_view uids;
+                    data_view user_sids;
+                    data_view visibles;
+
+                    protozero::pbf_message<OSMFormat::DenseInfo> pbf_dense_info{data};
+                    while (pbf_dense_info.next()) {
+                        switch (pbf_dense_info.tag_and_type()) {
+                            case protozero::tag_and_type(OSMFormat::DenseInfo::packed_int32_version, protozero::pbf_wire_type::length_delimited):
+                                versions = pbf_dense_info.get_view();
                                 break;
-                            case protozero::tag_and_type(OSMFormat::DenseNodes::packed_sint64_lat, protozero::pbf_wire_type::length_delimited):
-                                lats = varint_range{pbf_dense_nodes.get_view()};
+                            case protozero::tag_and_type(OSMFormat::DenseInfo::packed_sint64_timestamp, protozero::pbf_wire_type::length_delimited):
+                                timestamps = pbf_dense_info.get_view();
                                 break;
-                            case protozero::tag_and_type(OSMFormat::DenseNodes::packed_sint64_lon, protozero::pbf_wire_type::length_delimited):
-                                lons = varint_range{pbf_dense_nodes.get_view()};
+                            case protozero::tag_and_type(OSMFormat::DenseInfo::packed_sint64_changeset, protozero::pbf_wire_type::length_delimited):
+                                changesets = pbf_dense_info.get_view();
                                 break;
-                            case protozero::tag_and_type(OSMFormat::DenseNodes::packed_int32_keys_vals, protozero::pbf_wire_type::length_delimited):
-                                tags = varint_range{pbf_dense_nodes.get_view()};
+                            case protozero::tag_and_type(OSMFormat::DenseInfo::packed_sint32_uid, protozero::pbf_wire_type::length_delimited):
+                                uids = pbf_dense_info.get_view();
+                                break;
+                            case protozero::tag_and_type(OSMFormat::DenseInfo::packed_sint32_user_sid, protozero::pbf_wire_type::length_delimited):
+                                user_sids = pbf_dense_info.get_view();
+                                break;
+                            case protozero::tag_and_type(OSMFormat::DenseInfo::packed_bool_visible, protozero::pbf_wire_type::length_delimited):
+                                visibles = pbf_dense_info.get_view();
                                 break;
                             default:
-                                pbf_dense_nodes.skip();
+                                pbf_dense_info.skip();
                         }
                     }
 
-                    osmium::DeltaDecode<int64_t> dense_id;
-                    osmium::DeltaDecode<int64_t> dense_latitude;
-                    osmium::DeltaDecode<int64_t> dense_longitude;
-
-                    while (!ids.empty()) {
-                        if (lons.empty() ||
-                            lats.empty()) {
-                            // this is against the spec, must have same number of elements
-                            throw osmium::pbf_error{"PBF format error"};
-                        }
-
-                        {
-                            osmium::builder::NodeBuilder builder{m_buffer};
-                            osmium::Node& node = builder.object();
-
-                            node.set_id(dense_id.update(ids.next_sint64()));
-
-                            const auto lon = dense_longitude.update(lons.next_sint64());
-                            const auto lat = dense_latitude.update(lats.next_sint64());
-                            builder.object().set_location(osmium::Location{
-                                    convert_pbf_lon(lon),
-                                    convert_pbf_lat(lat)
-                            });
-
-                            if (!tags.empty()) {
-                                build_tag_list_from_dense_nodes(builder, tags);
-                            }
-                        }
-                        m_buffer.commit();
-                    }
-
+                    decode_packed_varints(versions, m_columns->versions);
+                    decode_packed_sint64_delta(timestamps, m_columns->timestamps);
+                    decode_packed_sint64_delta(changesets, m_columns->changesets);
+                    decode_packed_sint64_delta(uids, m_columns->uids);
+                    decode_packed_sint64_delta(user_sids, m_columns->user_sids);
+                    decode_packed_varints(visibles, m_columns->visibles);
                 }
 
                 void decode_dense_nodes(const data_view& data) {
                     bool has_info = false;
 
-                    varint_range ids;
-                    varint_range lats;
-                    varint_range lons;
-                    varint_range tags;
-                    varint_range versions;
-                    varint_range timestamps;
-                    varint_range changesets;
-                    varint_range uids;
-                    varint_range user_sids;
-                    varint_range visibles;
+                    data_view ids;
+                    data_view lats;
+                    data_view lons;
+                    data_view tags;
 
                     protozero::pbf_message<OSMFormat::DenseNodes> pbf_dense_nodes{data};
                     while (pbf_dense_nodes.next()) {
                         switch (pbf_dense_nodes.tag_and_type()) {
                             case protozero::tag_and_type(OSMFormat::DenseNodes::packed_sint64_id, protozero::pbf_wire_type::length_delimited):
-                                ids = varint_range{pbf_dense_nodes.get_view()};
+                                ids = pbf_dense_nodes.get_view();
                                 break;
                             case protozero::tag_and_type(OSMFormat::DenseNodes::optional_DenseInfo_denseinfo, protozero::pbf_wire_type::length_delimited):
-                                {
+                                if (m_read_metadata == osmium::io::read_meta::yes) {
                                     has_info = true;
-                                    protozero::pbf_message<OSMFormat::DenseInfo> pbf_dense_info{pbf_dense_nodes.get_message()};
-                                    while (pbf_dense_info.next()) {
-                                        switch (pbf_dense_info.tag_and_type()) {
-                                            case protozero::tag_and_type(OSMFormat::DenseInfo::packed_int32_version, protozero::pbf_wire_type::length_delimited):
-                                                versions = varint_range{pbf_dense_info.get_view()};
-                                                break;
-                                            case protozero::tag_and_type(OSMFormat::DenseInfo::packed_sint64_timestamp, protozero::pbf_wire_type::length_delimited):
-                                                timestamps = varint_range{pbf_dense_info.get_view()};
-                                                break;
-                                            case protozero::tag_and_type(OSMFormat::DenseInfo::packed_sint64_changeset, protozero::pbf_wire_type::length_delimited):
-                                                changesets = varint_range{pbf_dense_info.get_view()};
-                                                break;
-                                            case protozero::tag_and_type(OSMFormat::DenseInfo::packed_sint32_uid, protozero::pbf_wire_type::length_delimited):
-                                                uids = varint_range{pbf_dense_info.get_view()};
-                                                break;
-                                            case protozero::tag_and_type(OSMFormat::DenseInfo::packed_sint32_user_sid, protozero::pbf_wire_type::length_delimited):
-                                                user_sids = varint_range{pbf_dense_info.get_view()};
-                                                break;
-                                            case protozero::tag_and_type(OSMFormat::DenseInfo::packed_bool_visible, protozero::pbf_wire_type::length_delimited):
-                                                visibles = varint_range{pbf_dense_info.get_view()};
-                                                break;
-                                            default:
-                                                pbf_dense_info.skip();
-                                        }
-                                    }
+                                    decode_dense_info_columns(pbf_dense_nodes.get_view());
+                                } else {
+                                    pbf_dense_nodes.skip();
                                 }
                                 break;
                             case protozero::tag_and_type(OSMFormat::DenseNodes::packed_sint64_lat, protozero::pbf_wire_type::length_delimited):
-                                lats = varint_range{pbf_dense_nodes.get_view()};
+                                lats = pbf_dense_nodes.get_view();
                                 break;
                             case protozero::tag_and_type(OSMFormat::DenseNodes::packed_sint64_lon, protozero::pbf_wire_type::length_delimited):
-                                lons = varint_range{pbf_dense_nodes.get_view()};
+                                lons = pbf_dense_nodes.get_view();
                                 break;
                             case protozero::tag_and_type(OSMFormat::DenseNodes::packed_int32_keys_vals, protozero::pbf_wire_type::length_delimited):
-                                tags = varint_range{pbf_dense_nodes.get_view()};
+                                tags = pbf_dense_nodes.get_view();
                                 break;
                             default:
                                 pbf_dense_nodes.skip();
                         }
                     }
 
-                    osmium::DeltaDecode<int64_t> dense_id;
-                    osmium::DeltaDecode<int64_t> dense_latitude;
-                    osmium::DeltaDecode<int64_t> dense_longitude;
-                    osmium::DeltaDecode<int64_t> dense_uid;
-                    osmium::DeltaDecode<int64_t> dense_user_sid;
-                    osmium::DeltaDecode<int64_t> dense_changeset;
-                    osmium::DeltaDecode<int64_t> dense_timestamp;
+                    if (!has_info) {
+                        m_columns->visibles.clear();
+                    }
 
-                    while (!ids.empty()) {
-                        if (lons.empty() ||
-                            lats.empty()) {
-                            // this is against the spec, must have same number of elements
-                            throw osmium::pbf_error{"PBF format error"};
-                        }
+                    const std::size_t size = decode_dense_nodes_columns(ids, lats, lons, tags);
+                    const std::size_t parts = number_of_parts(size);
+                    if (parts == 0) {
+                        build_dense_nodes(0, size, 0, has_info);
+                    } else {
+                        build_dense_nodes_in_parallel(size, parts, has_info);
+                    }
+                }
 
-                        {
-                            bool visible = true;
+                // Build the dense nodes first to last (exclusive) from the
+                // decoded columns. The tags of node first start at tag_pos.
+                void build_dense_nodes(const std::size_t first, const std::size_t last, std::size_t tag_pos, const bool has_info) {
+                    const pbf_decode_columns& columns = *m_columns;
+                    const bool filter = !m_location_filter.empty() || (m_tags_filter.entities() & osmium::osm_entity_bits::node);
 
+                    for (std::size_t i = first; i < last; ++i) {
+                        const bool visible = i >= columns.visibles.size() || columns.visibles[i] != 0;
+                        if (filter && !keep_dense_node(i, tag_pos, visible)) {
+                            continue;
+                        }
+                        {
                             osmium::builder::NodeBuilder builder{m_buffer};
                             osmium::Node& node = builder.object();
 
-                            node.set_id(dense_id.update(ids.next_sint64()));
+                            node.set_id(columns.ids[i]);
 
                             if (has_info) {
-                                if (!versions.empty()) {
-                                    const auto version = versions.next_int32();
+                                if (i < columns.versions.size()) {
+                                    const auto version = columns.versions[i];
                                     if (version < -1) {
                                         throw osmium::pbf_error{"object version must not be negative"};
                                     }
@@ -690,8 +1038,8 @@ namespace osmium {
                                     }
                                 }
 
-                                if (!changesets.empty()) {
-                                    const auto changeset_id = dense_changeset.update(changesets.next_sint64());
+                                if (i < columns.changesets.size()) {
+                                    const auto changeset_id = columns.changesets[i];
                                     if (changeset_id < -1 || changeset_id >= std::numeric_limits<changeset_id_type>::max()) {
                                         throw osmium::pbf_error{"object changeset_id must be between 0 and 2^32-1"};
                                     }
@@ -703,50 +1051,119 @@ namespace osmium {
                                     }
                                 }
 
-                                if (!timestamps.empty()) {
-                                    node.set_timestamp(dense_timestamp.update(timestamps.next_sint64()) * m_date_factor / 1000);
+                                if (i < columns.timestamps.size()) {
+                                    node.set_timestamp(columns.timestamps[i] * m_date_factor / 1000);
                                 }
 
-                                if (!uids.empty()) {
-                                    node.set_uid_from_signed(static_cast<osmium::signed_user_id_type>(dense_uid.update(uids.next_sint32())));
+                                if (i < columns.uids.size()) {
+                                    node.set_uid_from_signed(static_cast<osmium::signed_user_id_type>(columns.uids[i]));
                                 }
 
-                                if (!visibles.empty()) {
-                                    visible = (visibles.next_int32() != 0);
-                                }
                                 node.set_visible(visible);
 
-                                if (!user_sids.empty()) {
-                                    const auto& u = m_stringtable.at(dense_user_sid.update(user_sids.next_sint32()));
+                                if (i < columns.user_sids.size()) {
+                                    const auto& u = m_stringtable.at(columns.user_sids[i]);
                                     builder.set_user(u.first, u.second);
                                 }
                             }
 
                             // even if the node isn't visible, there's still a record
                             // of its lat/lon in the dense arrays.
-                            const auto lon = dense_longitude.update(lons.next_sint64());
-                            const auto lat = dense_latitude.update(lats.next_sint64());
                             if (visible) {
                                 builder.object().set_location(osmium::Location{
-                                        convert_pbf_lon(lon),
-                                        convert_pbf_lat(lat)
+                                        convert_pbf_lon(columns.lons[i]),
+                                        convert_pbf_lat(columns.lats[i])
                                 });
                             }
 
-                            if (!tags.empty()) {
-                                build_tag_list_from_dense_nodes(builder, tags);
+                            if (tag_pos < columns.tags.size()) {
+                                build_tag_list_from_dense_nodes(builder, tag_pos);
                             }
                         }
                         m_buffer.commit();
                     }
                 }
 
+                // Build the dense nodes in several parts in the pool threads.
+                void build_dense_nodes_in_parallel(const std::size_t size, const std::size_t parts, const bool has_info) {
+                    // The decoded columns are moved out of the scratch space
+                    // of this thread, because this thread might decode other
+                    // blocks while it is waiting for the parts.
+                    pbf_decode_columns columns;
+                    pbf_decode_columns* const thread_columns = m_columns;
+                    using std::swap;
+                    swap(columns, *thread_columns);
+                    m_columns = &columns;
+
+                    std::vector<std::future<osmium::memory::Buffer>> futures;
+                    const std::size_t part_size = (size + parts - 1) / parts;
+                    std::size_t tag_pos = 0;
+                    for (std::size_t first = 0; first < size; first += part_size) {
+                        const std::size_t last = std::min(first + part_size, size);
+                        futures.push_back(m_pool->submit([this, first, last, tag_pos, has_info, parts]() {
+                            PBFPrimitiveBlockDecoder part{*this, m_columns, m_data.size() / parts};
+                            part.build_dense_nodes(first, last, tag_pos, has_info);
+                            return std::move(part.m_buffer);
+                        }, osmium::thread::task_priority::high));
+                        if (!columns.tags.empty()) {
+                            for (std::size_t i = first; i < last; ++i) {
+                                skip_dense_node_tags(tag_pos);
+                            }
+                        }
+                    }
+
+                    append_parts(futures);
+
+                    swap(columns, *thread_columns);
+                    m_columns = thread_columns;
+                }
+
+                // Create the buffer for the objects decoded from data_size
+                // bytes of the block.
+                static osmium::memory::Buffer create_buffer(osmium::memory::BufferPool* buffer_pool, const std::size_t data_size) {
+                    if (!buffer_pool) {
+                        return osmium::memory::Buffer{initial_buffer_size, osmium::memory::Buffer::auto_grow::internal};
+                    }
+                    const auto size = std::min(data_size * buffer_size_factor, static_cast<std::size_t>(max_initial_buffer_size));
+                    return buffer_pool->get(std::max(size, static_cast<std::size_t>(initial_buffer_size)), osmium::memory::Buffer::auto_grow::internal);
+                }
+
+                // Create a decoder for a part of the block decoded in a pool
+                // thread. It gets a copy of everything read from the block
+                // metadata, but not of the buffer. The string table is
+                // shared, so the other decoder must outlive this one.
+                PBFPrimitiveBlockDecoder(const PBFPrimitiveBlockDecoder& other, pbf_decode_columns* columns, const std::size_t data_size) :
+                    m_data(other.m_data),
+                    m_stringtable(other.m_stringtable),
+                    m_lon_offset(other.m_lon_offset),
+                    m_lat_offset(other.m_lat_offset),
+                    m_date_factor(other.m_date_factor),
+                    m_granularity(other.m_granularity),
+                    m_read_types(other.m_read_types),
+                    m_buffer(create_buffer(other.m_buffer_pool, data_size)),
+                    m_read_metadata(other.m_read_metadata),
+                    m_columns(columns),
+                    m_tags_filter(other.m_tags_filter),
+                    m_location_filter(other.m_location_filter),
+                    m_buffer_pool(other.m_buffer_pool),
+                    m_filter_strings(other.m_filter_strings),
+                    m_filter_string_offsets(other.m_filter_string_offsets) {
+                }
+
             public:
 
-                PBFPrimitiveBlockDecoder(const data_view& data, const osmium::osm_entity_bits::type read_types, const osmium::io::read_meta read_metadata) :
+                PBFPrimitiveBlockDecoder(const data_view& data, const osmium::osm_entity_bits::type read_types, const osmium::io::read_meta read_metadata, const osmium::io::tags_prefilter& tags_filter = osmium::io::tags_prefilter{}, const osmium::io::location_prefilter& location_filter = osmium::io::location_prefilter{}, osmium::thread::Pool* pool = nullptr, osmium::memory::BufferPool* buffer_pool = nullptr) :
                     m_data(data),
+                    m_stringtable(m_own_stringtable),
                     m_read_types(read_types),
-                    m_read_metadata(read_metadata) {
+                    m_buffer(create_buffer(buffer_pool, data.size())),
+                    m_read_metadata(read_metadata),
+                    m_tags_filter(tags_filter),
+                    m_location_filter(location_filter),
+                    m_pool(pool),
+                    m_buffer_pool(buffer_pool),
+                    m_filter_strings(m_own_filter_strings),
+                    m_filter_string_offsets(m_own_filter_string_offsets) {
                 }
 
                 PBFPrimitiveBlockDecoder(const PBFPrimitiveBlockDecoder&) = delete;
@@ -758,6 +1175,8 @@ namespace osmium {
                 ~PBFPrimitiveBlockDecoder() noexcept = default;
 
                 osmium::memory::Buffer operator()() {
+                    m_columns = &thread_decode_columns();
+
                     try {
                         decode_primitive_block_metadata();
                         decode_primitive_block_data();
@@ -770,7 +1189,200 @@ namespace osmium {
 
             }; // class PBFPrimitiveBlockDecoder
 
-            inline data_view decode_blob(const std::string& blob_data, std::string& output) {
+            /**
+             * Ids and locations of the nodes in one PrimitiveBlock as
+             * decoded by the PBFNodeLocationsDecoder.
+             */
+            struct pbf_node_locations {
+
+                std::vector<std::pair<osmium::object_id_type, osmium::Location>> locations;
+
+                /// Are there any ways, relations, or changesets in the block?
+                bool other_entities = false;
+
+            }; // struct pbf_node_locations
+
+            /**
+             * Decodes only the ids and locations of the nodes in a
+             * PrimitiveBlock without building any OSM objects. The string
+             * table, tags, and all metadata except the visible flag are
+             * skipped. Invisible (deleted) nodes get an undefined location
+             * just like when they are read through the normal decoder.
+             */
+            class PBFNodeLocationsDecoder {
+
+                data_view m_data;
+
+                int64_t m_lon_offset = 0;
+                int64_t m_lat_offset = 0;
+                int32_t m_granularity = 100;
+
+                pbf_node_locations m_result;
+
+                void decode_primitive_block_metadata() {
+                    protozero::pbf_message<OSMFormat::PrimitiveBlock> pbf_primitive_block{m_data};
+                    while (pbf_primitive_block.next()) {
+                        switch (pbf_primitive_block.tag_and_type()) {
+                            case protozero::tag_and_type(OSMFormat::PrimitiveBlock::optional_int32_granularity, protozero::pbf_wire_type::varint):
+                                m_granularity = pbf_primitive_block.get_int32();
+                                break;
+                            case protozero::tag_and_type(OSMFormat::PrimitiveBlock::optional_int64_lat_offset, protozero::pbf_wire_type::varint):
+                                m_lat_offset = pbf_primitive_block.get_int64();
+                                break;
+                            case protozero::tag_and_type(OSMFormat::PrimitiveBlock::optional_int64_lon_offset, protozero::pbf_wire_type::varint):
+                                m_lon_offset = pbf_primitive_block.get_int64();
+                                break;
+                            default:
+                                pbf_primitive_block.skip();
+                        }
+                    }
+                }
+
+                void decode_primitive_block_data() {
+                    protozero::pbf_message<OSMFormat::PrimitiveBlock> pbf_primitive_block{m_data};
+                    while (pbf_primitive_block.next(OSMFormat::PrimitiveBlock::repeated_PrimitiveGroup_primitivegroup, protozero::pbf_wire_type::length_delimited)) {
+                        protozero::pbf_message<OSMFormat::PrimitiveGroup> pbf_primitive_group = pbf_primitive_block.get_message();
+                        while (pbf_primitive_group.next()) {
+                            switch (pbf_primitive_group.tag_and_type()) {
+                                case protozero::tag_and_type(OSMFormat::PrimitiveGroup::repeated_Node_nodes, protozero::pbf_wire_type::length_delimited):
+                                    decode_node(pbf_primitive_group.get_view());
+                                    break;
+                                case protozero::tag_and_type(OSMFormat::PrimitiveGroup::optional_DenseNodes_dense, protozero::pbf_wire_type::length_delimited):
+                                    decode_dense_nodes(pbf_primitive_group.get_view());
+                                    break;
+                                case protozero::tag_and_type(OSMFormat::PrimitiveGroup::repeated_Way_ways, protozero::pbf_wire_type::length_delimited):
+                                case protozero::tag_and_type(OSMFormat::PrimitiveGroup::repeated_Relation_relations, protozero::pbf_wire_type::length_delimited):
+                                case protozero::tag_and_type(OSMFormat::PrimitiveGroup::repeated_ChangeSet_changesets, protozero::pbf_wire_type::length_delimited):
+                                    m_result.other_entities = true;
+                                    pbf_primitive_group.skip();
+                                    break;
+                                default:
+                                    pbf_primitive_group.skip();
+                            }
+                        }
+                    }
+                }
+
+                osmium::Location convert_pbf_location(const int64_t lon, const int64_t lat) const noexcept {
+                    return osmium::Location{
+                        static_cast<int32_t>((lon * m_granularity + m_lon_offset) / resolution_convert),
+                        static_cast<int32_t>((lat * m_granularity + m_lat_offset) / resolution_convert)
+                    };
+                }
+
+                void decode_node(const data_view& data) {
+                    osmium::object_id_type id = 0;
+                    bool visible = true;
+                    int64_t lon = std::numeric_limits<int64_t>::max();
+                    int64_t lat = std::numeric_limits<int64_t>::max();
+
+                    protozero::pbf_message<OSMFormat::Node> pbf_node{data};
+                    while (pbf_node.next()) {
+                        switch (pbf_node.tag_and_type()) {
+                            case protozero::tag_and_type(OSMFormat::Node::required_sint64_id, protozero::pbf_wire_type::varint):
+                                id = pbf_node.get_sint64();
+                                break;
+                            case protozero::tag_and_type(OSMFormat::Node::optional_Info_info, protozero::pbf_wire_type::length_delimited):
+                                visible = decode_info_visible(pbf_node.get_view());
+                                break;
+                            case protozero::tag_and_type(OSMFormat::Node::required_sint64_lat, protozero::pbf_wire_type::varint):
+                                lat = pbf_node.get_sint64();
+                                break;
+                            case protozero::tag_and_type(OSMFormat::Node::required_sint64_lon, protozero::pbf_wire_type::varint):
+                                lon = pbf_node.get_sint64();
+                                break;
+                            default:
+                                pbf_node.skip();
+                        }
+                    }
+
+                    if (!visible) {
+                        m_result.locations.emplace_back(id, osmium::Location{});
+                        return;
+                    }
+
+                    if (lon == std::numeric_limits<int64_t>::max() ||
+                        lat == std::numeric_limits<int64_t>::max()) {
+                        throw osmium::pbf_error{"illegal coordinate format"};
+                    }
+                    m_result.locations.emplace_back(id, convert_pbf_location(lon, lat));
+                }
+
+                void decode_dense_nodes(const data_view& data) {
+                    data_view ids;
+                    data_view lats;
+                    data_view lons;
+                    varint_range visibles;
+
+                    protozero::pbf_message<OSMFormat::DenseNodes> pbf_dense_nodes{data};
+                    while (pbf_dense_nodes.next()) {
+                        switch (pbf_dense_nodes.tag_and_type()) {
+                            case protozero::tag_and_type(OSMFormat::DenseNodes::packed_sint64_id, protozero::pbf_wire_type::length_delimited):
+                                ids = pbf_dense_nodes.get_view();
+                                break;
+                            case protozero::tag_and_type(OSMFormat::DenseNodes::optional_DenseInfo_denseinfo, protozero::pbf_wire_type::length_delimited):
+                                {
+                                    protozero::pbf_message<OSMFormat::DenseInfo> pbf_dense_info{pbf_dense_nodes.get_message()};
+                                    while (pbf_dense_info.next(OSMFormat::DenseInfo::packed_bool_visible, protozero::pbf_wire_type::length_delimited)) {
+                                        visibles = varint_range{pbf_dense_info.get_view()};
+                                    }
+                                }
+                                break;
+                            case protozero::tag_and_type(OSMFormat::DenseNodes::packed_sint64_lat, protozero::pbf_wire_type::length_delimited):
+                                lats = pbf_dense_nodes.get_view();
+                                break;
+                            case protozero::tag_and_type(OSMFormat::DenseNodes::packed_sint64_lon, protozero::pbf_wire_type::length_delimited):
+                                lons = pbf_dense_nodes.get_view();
+                                break;
+                            default:
+                                pbf_dense_nodes.skip();
+                        }
+                    }
+
+                    auto& columns = thread_decode_columns();
+                    decode_packed_sint64_delta(ids, columns.ids);
+                    decode_packed_sint64_delta(lats, columns.lats);
+                    decode_packed_sint64_delta(lons, columns.lons);
+                    if (columns.lats.size() < columns.ids.size() ||
+                        columns.lons.size() < columns.ids.size()) {
+                        // this is against the spec, must have same number of elements
+                        throw osmium::pbf_error{"PBF format error"};
+                    }
+
+                    const std::size_t size = columns.ids.size();
+                    m_result.locations.reserve(m_result.locations.size() + size);
+                    for (std::size_t i = 0; i < size; ++i) {
+                        if (!visibles.empty() && visibles.next_int32() == 0) {
+                            m_result.locations.emplace_back(columns.ids[i], osmium::Location{});
+                        } else {
+                            m_result.locations.emplace_back(columns.ids[i], convert_pbf_location(columns.lons[i], columns.lats[i]));
+                        }
+                    }
+                }
+
+            public:
+
+                explicit PBFNodeLocationsDecoder(const data_view& data) :
+                    m_data(data) {
+                }
+
+                PBFNodeLocationsDecoder(const PBFNodeLocationsDecoder&) = delete;
+                PBFNodeLocationsDecoder& operator=(const PBFNodeLocationsDecoder&) = delete;
+
+                PBFNodeLocationsDecoder(PBFNodeLocationsDecoder&&) = delete;
+                PBFNodeLocationsDecoder& operator=(PBFNodeLocationsDecoder&&) = delete;
+
+                ~PBFNodeLocationsDecoder() noexcept = default;
+
+                pbf_node_locations operator()() {
+                    decode_primitive_block_metadata();
+                    decode_primitive_block_data();
+                    return std::move(m_result);
+                }
+
+            }; // class PBFNodeLocationsDecoder
+
+            inline data_view decode_blob(const data_view& blob_data, std::string& output) {
                 int32_t raw_size = 0;
                 protozero::data_view compressed_data;
                 pbf_compression use_compression = pbf_compression::none;
@@ -807,7 +1419,13 @@ namespace osmium {
                             throw osmium::pbf_error{"lz4 blobs not supported"};
 #endif
                         case protozero::tag_and_type(FileFormat::Blob::optional_bytes_zstd_data, protozero::pbf_wire_type::length_delimited):
+#ifdef OSMIUM_WITH_ZSTD
+                            use_compression = pbf_compression::zstd;
+                            compressed_data = pbf_blob.get_view();
+                            break;
+#else
                             throw osmium::pbf_error{"zstd blobs not supported"};
+#endif
                         default:
                             pbf_blob.skip();
                     }
@@ -841,6 +1459,17 @@ namespace osmium {
                         );
 #else
                         break;
+#endif
+                    case pbf_compression::zstd:
+#ifdef OSMIUM_WITH_ZSTD
+                        return osmium::io::detail::zstd_uncompress_string(
+                            compressed_data.data(),
+                            static_cast<unsigned long>(compressed_data.size()), // NOLINT(google-runtime-int)
+                            static_cast<unsigned long>(raw_size), // NOLINT(google-runtime-int)
+                            output
+                        );
+#else
+                        break;
 #endif
                 }
                 std::abort(); // should never be here
@@ -960,25 +1589,84 @@ namespace osmium {
             class PBFDataBlobDecoder {
 
                 std::shared_ptr<std::string> m_input_buffer;
+                std::shared_ptr<osmium::util::MemoryMapping> m_mapping;
+                data_view m_data;
                 osmium::osm_entity_bits::type m_read_types;
                 osmium::io::read_meta m_read_metadata;
+                osmium::io::tags_prefilter m_tags_filter;
+                osmium::io::location_prefilter m_location_filter;
+                osmium::thread::Pool* m_pool;
+                osmium::memory::BufferPool* m_buffer_pool;
 
             public:
 
-                PBFDataBlobDecoder(std::string&& input_buffer, const osmium::osm_entity_bits::type read_types, const osmium::io::read_meta read_metadata) :
+                PBFDataBlobDecoder(std::string&& input_buffer, const osmium::osm_entity_bits::type read_types, const osmium::io::read_meta read_metadata, const osmium::io::tags_prefilter& tags_filter = osmium::io::tags_prefilter{}, const osmium::io::location_prefilter& location_filter = osmium::io::location_prefilter{}, osmium::thread::Pool* pool = nullptr, osmium::memory::BufferPool* buffer_pool = nullptr) :
                     m_input_buffer(std::make_shared<std::string>(std::move(input_buffer))),
+                    m_data(*m_input_buffer),
                     m_read_types(read_types),
-                    m_read_metadata(read_metadata) {
+                    m_read_metadata(read_metadata),
+                    m_tags_filter(tags_filter),
+                    m_location_filter(location_filter),
+                    m_pool(pool),
+                    m_buffer_pool(buffer_pool) {
+                }
+
+                /**
+                 * Decode a blob directly from a memory mapped file. The
+                 * mapping is kept alive as long as the decoder needs it.
+                 */
+                PBFDataBlobDecoder(std::shared_ptr<osmium::util::MemoryMapping> mapping, const data_view& data, const osmium::osm_entity_bits::type read_types, const osmium::io::read_meta read_metadata, const osmium::io::tags_prefilter& tags_filter = osmium::io::tags_prefilter{}, const osmium::io::location_prefilter& location_filter = osmium::io::location_prefilter{}, osmium::thread::Pool* pool = nullptr, osmium::memory::BufferPool* buffer_pool = nullptr) :
+                    m_mapping(std::move(mapping)),
+                    m_data(data),
+                    m_read_types(read_types),
+                    m_read_metadata(read_metadata),
+                    m_tags_filter(tags_filter),
+                    m_location_filter(location_filter),
+                    m_pool(pool),
+                    m_buffer_pool(buffer_pool) {
                 }
 
                 osmium::memory::Buffer operator()() {
+                    // The buffer for the uncompressed data is reused for
+                    // all blobs decoded in the same thread. This saves a
+                    // large memory allocation for each blob.
+                    // It is taken out of the thread_local variable while it
+                    // is in use, because this thread might decode other
+                    // blobs while waiting for parts of this one.
+                    static thread_local std::string thread_output;
                     std::string output;
-                    PBFPrimitiveBlockDecoder decoder{decode_blob(*m_input_buffer, output), m_read_types, m_read_metadata};
-                    return decoder();
+                    using std::swap;
+                    swap(output, thread_output);
+                    PBFPrimitiveBlockDecoder decoder{decode_blob(m_data, output), m_read_types, m_read_metadata, m_tags_filter, m_location_filter, m_pool, m_buffer_pool};
+                    osmium::memory::Buffer buffer{decoder()};
+                    swap(output, thread_output);
+                    return buffer;
                 }
 
             }; // class PBFDataBlobDecoder
 
+            /**
+             * Uncompresses an OSMData blob and decodes the node locations
+             * in it using the PBFNodeLocationsDecoder.
+             */
+            class PBFNodeLocationsBlobDecoder {
+
+                std::shared_ptr<std::string> m_input_buffer;
+
+            public:
+
+                explicit PBFNodeLocationsBlobDecoder(std::string&& input_buffer) :
+                    m_input_buffer(std::make_shared<std::string>(std::move(input_buffer))) {
+                }
+
+                pbf_node_locations operator()() {
+                    static thread_local std::string output;
+                    PBFNodeLocationsDecoder decoder{decode_blob(*m_input_buffer, output)};
+                    return decoder();
+                }
+
+            }; // class PBFNodeLocationsBlobDecoder
+
         } // namespace detail
 
     } // namespace io
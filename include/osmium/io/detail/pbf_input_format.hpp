@@ -35,6 +35,7 @@ DEALINGS IN THE SOFTWARE.
 
 #include <osmium/io/detail/input_format.hpp>
 #include <osmium/io/detail/pbf.hpp> // IWYU pragma: export
+#include <osmium/io/detail/pbf_blob_index.hpp>
 #include <osmium/io/detail/pbf_decoder.hpp>
 #include <osmium/io/detail/protobuf_tags.hpp>
 #include <osmium/io/detail/read_write.hpp>
@@ -44,6 +45,8 @@ DEALINGS IN THE SOFTWARE.
 #include <osmium/thread/pool.hpp>
 #include <osmium/thread/util.hpp>
 #include <osmium/util/config.hpp>
+#include <osmium/util/file.hpp>
+#include <osmium/util/memory_mapping.hpp>
 
 #include <protozero/pbf_message.hpp>
 #include <protozero/types.hpp>
@@ -66,9 +69,29 @@ namespace osmium {
             class PBFParser final : public Parser {
 
                 std::string m_input_buffer{};
+
+                // Start of the data in m_input_buffer not used yet.
+                std::size_t m_input_buffer_pos = 0;
+
+                std::shared_ptr<osmium::util::MemoryMapping> m_mapping{};
+
+                // Start of the data in m_mapping not used yet.
+                std::size_t m_mapping_pos = 0;
+
                 std::atomic<std::size_t>* m_offset_ptr;
                 int m_fd;
                 bool m_want_buffered_pages_removed;
+                bool m_use_mmap;
+                bool m_use_blob_index;
+                std::string m_blob_index_file;
+
+                std::size_t available_in_input_queue() const noexcept {
+                    return m_input_buffer.size() - m_input_buffer_pos;
+                }
+
+                const char* input_queue_data() const noexcept {
+                    return m_input_buffer.data() + m_input_buffer_pos;
+                }
 
                 /**
                  * Make sure the input data contains at least the specified
@@ -78,6 +101,17 @@ namespace osmium {
                  */
                 void ensure_available_in_input_queue(size_t size) {
                     assert(m_fd == -1);
+                    if (available_in_input_queue() >= size) {
+                        return;
+                    }
+
+                    // Remove data already used before appending new data.
+                    // This is done here and not in pop_from_input_queue()
+                    // so the rest of the buffer isn't moved around after
+                    // every blob.
+                    m_input_buffer.erase(0, m_input_buffer_pos);
+                    m_input_buffer_pos = 0;
+
                     if (m_input_buffer.size() < size) {
                         m_input_buffer.reserve(size);
                     }
@@ -97,7 +131,24 @@ namespace osmium {
                  */
                 void pop_from_input_queue(size_t size) {
                     assert(m_fd == -1);
-                    m_input_buffer.erase(0, size);
+                    assert(size <= available_in_input_queue());
+                    m_input_buffer_pos += size;
+                }
+
+                /**
+                 * Get the specified number of bytes from the memory mapped
+                 * file and mark them as used.
+                 *
+                 * @param size Number of bytes to get
+                 */
+                protozero::data_view read_from_mapping(size_t size) {
+                    assert(m_mapping);
+                    if (m_mapping->size() - m_mapping_pos < size) {
+                        throw osmium::pbf_error{"unexpected EOF"};
+                    }
+                    const protozero::data_view data{m_mapping->get_addr<char>() + m_mapping_pos, size};
+                    m_mapping_pos += size;
+                    return data;
                 }
 
                 static uint32_t get_size_in_network_byte_order(const char* d) noexcept {
@@ -119,6 +170,13 @@ namespace osmium {
                  * the length of the following BlobHeader.
                  */
                 uint32_t read_blob_header_size_from_file() {
+                    if (m_mapping) {
+                        if (m_mapping->size() - m_mapping_pos < sizeof(uint32_t)) {
+                            return 0; // EOF
+                        }
+                        return check_size(get_size_in_network_byte_order(read_from_mapping(sizeof(uint32_t)).data()));
+                    }
+
                     if (m_fd != -1) {
                         std::array<char, sizeof(uint32_t)> buffer{};
                         if (!osmium::io::detail::read_exactly(m_fd, buffer.data(), static_cast<unsigned int>(buffer.size()))) {
@@ -131,7 +189,7 @@ namespace osmium {
 
                     try {
                         ensure_available_in_input_queue(sizeof(size));
-                        size = get_size_in_network_byte_order(m_input_buffer.data());
+                        size = get_size_in_network_byte_order(input_queue_data());
                         pop_from_input_queue(sizeof(size));
                     } catch (const osmium::pbf_error&) {
                         return 0; // EOF
@@ -149,32 +207,14 @@ namespace osmium {
                  * type. Return the size of the following Blob.
                  */
                 static size_t decode_blob_header(const protozero::data_view& data, const char* expected_type) {
-                    protozero::pbf_message<FileFormat::BlobHeader> pbf_blob_header{data};
-                    protozero::data_view blob_header_type;
-                    size_t blob_header_datasize = 0;
-
-                    while (pbf_blob_header.next()) {
-                        switch (pbf_blob_header.tag_and_type()) {
-                            case protozero::tag_and_type(FileFormat::BlobHeader::required_string_type, protozero::pbf_wire_type::length_delimited):
-                                blob_header_type = pbf_blob_header.get_view();
-                                break;
-                            case protozero::tag_and_type(FileFormat::BlobHeader::required_int32_datasize, protozero::pbf_wire_type::varint):
-                                blob_header_datasize = pbf_blob_header.get_int32();
-                                break;
-                            default:
-                                pbf_blob_header.skip();
-                        }
-                    }
-
-                    if (blob_header_datasize == 0) {
-                        throw osmium::pbf_error{"PBF format error: BlobHeader.datasize missing or zero."};
-                    }
+                    const auto type_and_size = decode_blob_header_type_and_size(data);
+                    const auto& blob_header_type = type_and_size.first;
 
                     if (std::strncmp(expected_type, blob_header_type.data(), blob_header_type.size()) != 0) {
                         throw osmium::pbf_error{"blob does not have expected type (OSMHeader in first blob, OSMData in following blobs)"};
                     }
 
-                    return blob_header_datasize;
+                    return type_and_size.second;
                 }
 
                 size_t check_type_and_get_blob_size(const char* expected_type) {
@@ -185,6 +225,10 @@ namespace osmium {
                         return 0;
                     }
 
+                    if (m_mapping) {
+                        return decode_blob_header(read_from_mapping(size), expected_type);
+                    }
+
                     if (m_fd != -1) {
                         auto const buffer = read_from_input_queue_with_check(size);
                         const auto blob_size = decode_blob_header(protozero::data_view{buffer.data(), size}, expected_type);
@@ -192,19 +236,26 @@ namespace osmium {
                     }
 
                     ensure_available_in_input_queue(size);
-                    const auto blob_size = decode_blob_header(protozero::data_view{m_input_buffer.data(), size}, expected_type);
+                    const auto blob_size = decode_blob_header(protozero::data_view{input_queue_data(), size}, expected_type);
                     pop_from_input_queue(size);
                     return blob_size;
                 }
 
-                std::string read_from_input_queue_with_check(size_t size) {
+                static void check_blob_size(size_t size) {
                     if (size > max_uncompressed_blob_size) {
                         throw osmium::pbf_error{std::string{"invalid blob size: "} +
                                                 std::to_string(size)};
                     }
+                }
+
+                std::string read_from_input_queue_with_check(size_t size) {
+                    check_blob_size(size);
 
                     std::string buffer;
-                    if (m_fd != -1) {
+                    if (m_mapping) {
+                        const auto data = read_from_mapping(size);
+                        buffer.assign(data.data(), data.size());
+                    } else if (m_fd != -1) {
                         buffer.resize(size);
 
                         if (!osmium::io::detail::read_exactly(m_fd, &*buffer.begin(), static_cast<unsigned int>(size))) {
@@ -212,7 +263,7 @@ namespace osmium {
                         }
                     } else {
                         ensure_available_in_input_queue(size);
-                        buffer.append(m_input_buffer, 0, size);
+                        buffer.append(input_queue_data(), size);
                         pop_from_input_queue(size);
                     }
 
@@ -226,32 +277,135 @@ namespace osmium {
                     set_header_value(header);
                 }
 
+                // Pool given to the decoders for decoding large blocks in
+                // parts. Only used if the blobs are decoded in the pool.
+                osmium::thread::Pool* pool_for_decoder() {
+                    return osmium::config::use_pool_threads_for_pbf_parsing() ? &get_pool() : nullptr;
+                }
+
+                // Create decoder for the next blob. If the file is memory
+                // mapped, the decoder will read directly from the mapping,
+                // otherwise the data is copied into a string first.
+                PBFDataBlobDecoder get_data_blob_decoder(size_t size) {
+                    if (m_mapping) {
+                        check_blob_size(size);
+                        return PBFDataBlobDecoder{m_mapping, read_from_mapping(size), read_types(), read_metadata(), tags_filter(), location_filter(), pool_for_decoder(), buffer_pool()};
+                    }
+                    return PBFDataBlobDecoder{read_from_input_queue_with_check(size), read_types(), read_metadata(), tags_filter(), location_filter(), pool_for_decoder(), buffer_pool()};
+                }
+
                 void parse_data_blobs() {
                     const bool use_pool = osmium::config::use_pool_threads_for_pbf_parsing();
                     while (const auto size = check_type_and_get_blob_size("OSMData")) {
-                        std::string input_buffer{read_from_input_queue_with_check(size)};
-
-                        PBFDataBlobDecoder data_blob_parser{std::move(input_buffer), read_types(), read_metadata()};
+                        PBFDataBlobDecoder data_blob_parser{get_data_blob_decoder(size)};
 
                         if (use_pool) {
-                            send_to_output_queue(get_pool().submit(std::move(data_blob_parser)));
+                            // Decoding gets a higher priority than other
+                            // work in the pool (for instance compression in
+                            // a Writer), because the consumer of the Reader
+                            // is waiting for it.
+                            send_to_output_queue(get_pool().submit(std::move(data_blob_parser), osmium::thread::task_priority::high));
                         } else {
                             send_to_output_queue(data_blob_parser());
                         }
 
-                        if (m_want_buffered_pages_removed) {
+                        if (m_want_buffered_pages_removed && !m_mapping) {
                             osmium::io::detail::remove_buffered_pages(m_fd, *m_offset_ptr);
                         }
                     }
                 }
 
+                PBFBlobIndex get_blob_index(std::size_t file_size) {
+                    PBFBlobIndex index;
+                    if (!m_blob_index_file.empty() && index.load(m_blob_index_file, m_fd)) {
+                        return index;
+                    }
+
+                    index = PBFBlobIndex::create(m_fd, file_size);
+                    if (!m_blob_index_file.empty()) {
+                        index.save(m_blob_index_file);
+                    }
+                    return index;
+                }
+
+                template <typename TMakeDecoder>
+                void decode_blobs_using_index(const PBFBlobIndex& index, TMakeDecoder&& make_decoder) {
+                    const bool use_pool = osmium::config::use_pool_threads_for_pbf_parsing();
+                    for (const auto& blob : index) {
+                        if ((blob.types & read_types()) == osmium::osm_entity_bits::nothing) {
+                            continue;
+                        }
+
+                        auto data_blob_parser = make_decoder(blob);
+
+                        if (use_pool) {
+                            send_to_output_queue(get_pool().submit(std::move(data_blob_parser), osmium::thread::task_priority::high));
+                        } else {
+                            send_to_output_queue(data_blob_parser());
+                        }
+                    }
+                }
+
+                // Read data blobs using the blob index. Blobs not
+                // containing any of the entity types we are interested in
+                // are skipped, the others are read and decoded in the
+                // pool threads.
+                void parse_data_blobs_using_index(std::size_t file_size) {
+                    const auto index = get_blob_index(file_size);
+
+                    if (m_mapping) {
+                        decode_blobs_using_index(index, [this](const pbf_blob_info& blob) {
+                            return PBFDataBlobDecoder{m_mapping,
+                                                      protozero::data_view{m_mapping->get_addr<char>() + blob.offset, blob.size},
+                                                      read_types(),
+                                                      read_metadata(),
+                                                      tags_filter(),
+                                                      location_filter(),
+                                                      pool_for_decoder(),
+                                                      buffer_pool()};
+                        });
+                        return;
+                    }
+
+                    const std::shared_ptr<pbf_shared_fd> shared_fd{std::make_shared<pbf_shared_fd>(m_fd)};
+                    m_fd = -1;
+
+                    decode_blobs_using_index(index, [this, &shared_fd](const pbf_blob_info& blob) {
+                        return PBFIndexedBlobDecoder{shared_fd, blob, read_types(), read_metadata(), tags_filter(), location_filter(), pool_for_decoder(), buffer_pool()};
+                    });
+                }
+
+                // Map the whole file into memory if this was asked for and
+                // we are reading from a regular file without decompression.
+                void map_file() {
+                    if (!m_use_mmap || m_fd == -1) {
+                        return;
+                    }
+                    const auto file_size = osmium::util::file_size(m_fd);
+                    if (file_size > 0) {
+                        m_mapping = std::make_shared<osmium::util::MemoryMapping>(file_size, osmium::util::MemoryMapping::mapping_mode::readonly, m_fd);
+                    }
+                }
+
+                // The blob index can only be used if we are reading from
+                // a regular file without decompression.
+                std::size_t file_size_for_blob_index() const {
+                    if (!m_use_blob_index || m_fd == -1) {
+                        return 0;
+                    }
+                    return osmium::util::file_size(m_fd);
+                }
+
             public:
 
                 explicit PBFParser(parser_arguments& args) :
                     Parser(args),
                     m_offset_ptr(args.offset_ptr),
                     m_fd(args.fd),
-                    m_want_buffered_pages_removed(args.want_buffered_pages_removed) {
+                    m_want_buffered_pages_removed(args.want_buffered_pages_removed),
+                    m_use_mmap(args.file.is_true("pbf_mmap")),
+                    m_use_blob_index(args.file.is_true("pbf_blob_index") || !args.file.get("pbf_blob_index_file").empty()),
+                    m_blob_index_file(args.file.get("pbf_blob_index_file")) {
                 }
 
                 PBFParser(const PBFParser&) = delete;
@@ -265,10 +419,16 @@ namespace osmium {
                 void run() override {
                     osmium::thread::set_thread_name("_osmium_pbf_in");
 
+                    map_file();
                     parse_header_blob();
 
                     if (read_types() != osmium::osm_entity_bits::nothing) {
-                        parse_data_blobs();
+                        const auto file_size = file_size_for_blob_index();
+                        if (file_size > 0) {
+                            parse_data_blobs_using_index(file_size);
+                        } else {
+                            parse_data_blobs();
+                        }
                     }
 
                     osmium::io::detail::reliable_close(m_fd);
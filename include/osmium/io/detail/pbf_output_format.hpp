@@ -75,7 +75,12 @@ DEALINGS IN THE SOFTWARE.
 # include <osmium/io/detail/lz4.hpp>
 #endif
 
+#ifdef OSMIUM_WITH_ZSTD
+# include <osmium/io/detail/zstd.hpp>
+#endif
+
 #include <protozero/pbf_builder.hpp>
+#include <protozero/pbf_reader.hpp>
 #include <protozero/pbf_writer.hpp>
 #include <protozero/types.hpp>
 
@@ -111,6 +116,18 @@ namespace osmium {
                 /// Should node locations be added to ways?
                 bool locations_on_ways = false;
 
+                /**
+                 * Should PrimitiveBlocks be built in the thread pool? If
+                 * not, only compression happens in the pool.
+                 */
+                bool parallel_encoding = false;
+
+                /**
+                 * Should the string table of each block be sorted so that
+                 * the most often used strings get the smallest ids?
+                 */
+                bool sort_stringtable_by_frequency = false;
+
             }; // struct pbf_output_options
 
             /**
@@ -231,6 +248,21 @@ namespace osmium {
                     m_tags.push_back(0);
                 }
 
+                /**
+                 * Replace all string ids with new ids from the mapping.
+                 */
+                void remap_strings(const std::vector<int32_t>& mapping) {
+                    for (auto& id : m_tags) {
+                        id = mapping[static_cast<std::size_t>(id)];
+                    }
+
+                    osmium::DeltaDecode<int32_t, int32_t> old_sid;
+                    osmium::DeltaEncode<int32_t, int32_t> new_sid;
+                    for (auto& sid : m_user_sids) {
+                        sid = new_sid.update(mapping[static_cast<std::size_t>(old_sid.update(sid))]);
+                    }
+                }
+
                 std::string serialize() const {
                     std::string data;
                     protozero::pbf_builder<OSMFormat::DenseNodes> pbf_dense_nodes{data};
@@ -269,6 +301,110 @@ namespace osmium {
 
             }; // class DenseNodes
 
+            /**
+             * Copy the current field from the reader to the writer.
+             */
+            inline void copy_pbf_field(protozero::pbf_reader& reader, protozero::pbf_writer& writer) {
+                switch (reader.wire_type()) {
+                    case protozero::pbf_wire_type::varint:
+                        writer.add_uint64(reader.tag(), reader.get_uint64());
+                        break;
+                    case protozero::pbf_wire_type::length_delimited:
+                        writer.add_bytes(reader.tag(), reader.get_view());
+                        break;
+                    default:
+                        // The PBF writer never creates other wire types.
+                        throw osmium::pbf_error{"unexpected wire type"};
+                }
+            }
+
+            /**
+             * Copy an encoded Info message replacing the user string id
+             * using the mapping.
+             */
+            inline std::string remap_info_strings(const protozero::data_view& data, const std::vector<int32_t>& mapping) {
+                std::string output;
+                protozero::pbf_writer writer{output};
+
+                protozero::pbf_reader reader{data};
+                while (reader.next()) {
+                    if (reader.tag() == static_cast<protozero::pbf_tag_type>(OSMFormat::Info::optional_uint32_user_sid)) {
+                        writer.add_uint32(reader.tag(), static_cast<uint32_t>(mapping[reader.get_uint32()]));
+                    } else {
+                        copy_pbf_field(reader, writer);
+                    }
+                }
+
+                return output;
+            }
+
+            /**
+             * Copy an encoded Node, Way, or Relation message replacing all
+             * string ids using the mapping. The keys, vals, and info fields
+             * have the same numbers in all three messages.
+             */
+            inline std::string remap_object_strings(const protozero::data_view& data, const std::vector<int32_t>& mapping, bool is_relation) {
+                std::string output;
+                protozero::pbf_writer writer{output};
+
+                protozero::pbf_reader reader{data};
+                while (reader.next()) {
+                    switch (reader.tag()) {
+                        case static_cast<protozero::pbf_tag_type>(OSMFormat::Node::packed_uint32_keys):
+                        case static_cast<protozero::pbf_tag_type>(OSMFormat::Node::packed_uint32_vals): {
+                                protozero::packed_field_uint32 field{writer, reader.tag()};
+                                for (const auto id : reader.get_packed_uint32()) {
+                                    field.add_element(static_cast<uint32_t>(mapping[id]));
+                                }
+                            }
+                            break;
+                        case static_cast<protozero::pbf_tag_type>(OSMFormat::Node::optional_Info_info):
+                            writer.add_message(reader.tag(), remap_info_strings(reader.get_view(), mapping));
+                            break;
+                        case static_cast<protozero::pbf_tag_type>(OSMFormat::Relation::packed_int32_roles_sid):
+                            if (is_relation) {
+                                protozero::packed_field_int32 field{writer, reader.tag()};
+                                for (const auto id : reader.get_packed_int32()) {
+                                    field.add_element(mapping[static_cast<std::size_t>(id)]);
+                                }
+                                break;
+                            }
+                            copy_pbf_field(reader, writer);
+                            break;
+                        default:
+                            copy_pbf_field(reader, writer);
+                    }
+                }
+
+                return output;
+            }
+
+            /**
+             * Copy an encoded PrimitiveGroup (without DenseNodes) replacing
+             * all string ids using the mapping.
+             */
+            inline std::string remap_group_strings(const std::string& data, const std::vector<int32_t>& mapping) {
+                std::string output;
+                protozero::pbf_writer writer{output};
+
+                protozero::pbf_reader reader{data};
+                while (reader.next()) {
+                    switch (reader.tag()) {
+                        case static_cast<protozero::pbf_tag_type>(OSMFormat::PrimitiveGroup::repeated_Node_nodes):
+                        case static_cast<protozero::pbf_tag_type>(OSMFormat::PrimitiveGroup::repeated_Way_ways):
+                            writer.add_message(reader.tag(), remap_object_strings(reader.get_view(), mapping, false));
+                            break;
+                        case static_cast<protozero::pbf_tag_type>(OSMFormat::PrimitiveGroup::repeated_Relation_relations):
+                            writer.add_message(reader.tag(), remap_object_strings(reader.get_view(), mapping, true));
+                            break;
+                        default:
+                            copy_pbf_field(reader, writer);
+                    }
+                }
+
+                return output;
+            }
+
             class PrimitiveBlock {
 
                 std::string m_pbf_primitive_group_data;
@@ -276,9 +412,17 @@ namespace osmium {
                 StringTable m_stringtable;
                 pbf_output_options m_options;
                 std::unique_ptr<DenseNodes> m_dense_nodes{};
+                std::vector<int32_t> m_id_mapping;
                 OSMFormat::PrimitiveGroup m_type;
                 int m_count = 0;
 
+                const std::vector<int32_t>& id_mapping() {
+                    if (m_id_mapping.empty()) {
+                        m_id_mapping = m_stringtable.frequency_mapping();
+                    }
+                    return m_id_mapping;
+                }
+
             public:
 
                 explicit PrimitiveBlock(const pbf_output_options& options, OSMFormat::PrimitiveGroup type, size_t bucket_count) :
@@ -293,6 +437,13 @@ namespace osmium {
                 }
 
                 const std::string& group_data() {
+                    if (m_options.sort_stringtable_by_frequency) {
+                        if (m_dense_nodes) {
+                            m_dense_nodes->remap_strings(id_mapping());
+                        } else {
+                            m_pbf_primitive_group_data = remap_group_strings(m_pbf_primitive_group_data, id_mapping());
+                        }
+                    }
                     if (m_dense_nodes) {
                         m_pbf_primitive_group.add_message(OSMFormat::PrimitiveGroup::optional_DenseNodes_dense, m_dense_nodes->serialize());
                     }
@@ -300,6 +451,17 @@ namespace osmium {
                 }
 
                 void write_stringtable(protozero::pbf_builder<OSMFormat::StringTable>& pbf_string_table) {
+                    if (m_options.sort_stringtable_by_frequency) {
+                        const auto& mapping = id_mapping();
+                        std::vector<const char*> strings(mapping.size());
+                        for (std::size_t id = 0; id < mapping.size(); ++id) {
+                            strings[static_cast<std::size_t>(mapping[id])] = m_stringtable.get(static_cast<int32_t>(id));
+                        }
+                        for (const char* s : strings) {
+                            pbf_string_table.add_bytes(OSMFormat::StringTable::repeated_bytes_s, s);
+                        }
+                        return;
+                    }
                     for (const char* s : m_stringtable) {
                         pbf_string_table.add_bytes(OSMFormat::StringTable::repeated_bytes_s, s);
                     }
@@ -427,7 +589,12 @@ namespace osmium {
 
                     assert(m_msg.size() <= max_uncompressed_blob_size);
 
-                    std::string blob_data;
+                    // These buffers are reused for all blobs serialized in
+                    // the same thread to save on memory allocations.
+                    static thread_local std::string blob_data;
+                    static thread_local std::string compressed_data;
+                    blob_data.clear();
+
                     protozero::pbf_builder<FileFormat::Blob> pbf_blob{blob_data};
 
                     switch (m_use_compression) {
@@ -436,15 +603,26 @@ namespace osmium {
                             break;
                         case pbf_compression::zlib:
                             pbf_blob.add_int32(FileFormat::Blob::optional_int32_raw_size, static_cast<int32_t>(m_msg.size()));
-                            pbf_blob.add_bytes(FileFormat::Blob::optional_bytes_zlib_data, osmium::io::detail::zlib_compress(m_msg, m_compression_level));
+                            osmium::io::detail::zlib_compress(m_msg, compressed_data, m_compression_level);
+                            pbf_blob.add_bytes(FileFormat::Blob::optional_bytes_zlib_data, compressed_data);
                             break;
                         case pbf_compression::lz4:
 #ifdef OSMIUM_WITH_LZ4
                             pbf_blob.add_int32(FileFormat::Blob::optional_int32_raw_size, static_cast<int32_t>(m_msg.size()));
-                            pbf_blob.add_bytes(FileFormat::Blob::optional_bytes_lz4_data, osmium::io::detail::lz4_compress(m_msg, m_compression_level));
+                            osmium::io::detail::lz4_compress(m_msg, compressed_data, m_compression_level);
+                            pbf_blob.add_bytes(FileFormat::Blob::optional_bytes_lz4_data, compressed_data);
                             break;
 #else
                             throw osmium::pbf_error{"lz4 blobs not supported"};
+#endif
+                        case pbf_compression::zstd:
+#ifdef OSMIUM_WITH_ZSTD
+                            pbf_blob.add_int32(FileFormat::Blob::optional_int32_raw_size, static_cast<int32_t>(m_msg.size()));
+                            osmium::io::detail::zstd_compress(m_msg, compressed_data, m_compression_level);
+                            pbf_blob.add_bytes(FileFormat::Blob::optional_bytes_zstd_data, compressed_data);
+                            break;
+#else
+                            throw osmium::pbf_error{"zstd blobs not supported"};
 #endif
                     }
 
@@ -478,35 +656,20 @@ namespace osmium {
 
             }; // class SerializeBlob
 
-            class PBFOutputFormat : public osmium::io::detail::OutputFormat, public osmium::handler::Handler {
+            /**
+             * Handler that encodes OSM objects into PrimitiveBlocks. Full
+             * blocks are collected and can be taken out of the encoder with
+             * take_blocks().
+             */
+            class PBFEncoder : public osmium::handler::Handler {
 
-                pbf_output_options m_options;
+                const pbf_output_options* m_options;
 
                 std::shared_ptr<PrimitiveBlock> m_primitive_block{};
 
-                std::size_t m_bucket_count = StringTable::min_bucket_count;
-
-                void store_primitive_block() {
-                    if (!m_primitive_block || m_primitive_block->count() == 0) {
-                        return;
-                    }
+                std::vector<std::shared_ptr<PrimitiveBlock>> m_blocks;
 
-                    // Remember the bucket_count of the hash in the string
-                    // table. It will be used when initializing the string
-                    // table for the next block.
-                    //
-                    // Some versions of the std library will set the bucket
-                    // count always larger then what we set it to. We decrease
-                    // the bucket count by one, this way the bucket will not
-                    // grow too much.
-                    m_bucket_count = m_primitive_block->get_bucket_count() - 1;
-
-                    m_output_queue.push(m_pool.submit(
-                        SerializeBlob{std::move(m_primitive_block),
-                                      pbf_blob_type::data,
-                                      m_options.use_compression,
-                                      m_options.compression_level}));
-                }
+                std::size_t m_bucket_count = StringTable::min_bucket_count;
 
                 template <typename T>
                 void add_meta(const osmium::OSMObject& object, T& pbf_object) {
@@ -524,27 +687,27 @@ namespace osmium {
                         }
                     }
 
-                    if (m_options.add_metadata.any() || m_options.add_visible_flag) {
+                    if (m_options->add_metadata.any() || m_options->add_visible_flag) {
                         protozero::pbf_builder<OSMFormat::Info> pbf_info{pbf_object, T::enum_type::optional_Info_info};
 
-                        if (m_options.add_metadata.version()) {
+                        if (m_options->add_metadata.version()) {
                             assert(object.version() <= static_cast<std::size_t>(std::numeric_limits<int32_t>::max()));
                             pbf_info.add_int32(OSMFormat::Info::optional_int32_version, static_cast<int32_t>(object.version()));
                         }
-                        if (m_options.add_metadata.timestamp()) {
+                        if (m_options->add_metadata.timestamp()) {
                             pbf_info.add_int64(OSMFormat::Info::optional_int64_timestamp, static_cast<uint32_t>(object.timestamp()));
                         }
-                        if (m_options.add_metadata.changeset()) {
+                        if (m_options->add_metadata.changeset()) {
                             pbf_info.add_int64(OSMFormat::Info::optional_int64_changeset, object.changeset());
                         }
-                        if (m_options.add_metadata.uid()) {
+                        if (m_options->add_metadata.uid()) {
                             assert(object.uid() <= static_cast<std::size_t>(std::numeric_limits<int32_t>::max()));
                             pbf_info.add_int32(OSMFormat::Info::optional_int32_uid, static_cast<int32_t>(object.uid()));
                         }
-                        if (m_options.add_metadata.user()) {
+                        if (m_options->add_metadata.user()) {
                             pbf_info.add_uint32(OSMFormat::Info::optional_uint32_user_sid, m_primitive_block->store_in_stringtable_unsigned(object.user()));
                         }
-                        if (m_options.add_visible_flag) {
+                        if (m_options->add_visible_flag) {
                             pbf_info.add_bool(OSMFormat::Info::optional_bool_visible, object.visible());
                         }
                     }
@@ -552,8 +715,259 @@ namespace osmium {
 
                 void switch_primitive_block_type(OSMFormat::PrimitiveGroup type) {
                     if (!m_primitive_block || !m_primitive_block->can_add(type)) {
-                        store_primitive_block();
-                        m_primitive_block.reset(new PrimitiveBlock{m_options, type, m_bucket_count});
+                        store_block();
+                        m_primitive_block.reset(new PrimitiveBlock{*m_options, type, m_bucket_count});
+                    }
+                }
+
+            public:
+
+                explicit PBFEncoder(const pbf_output_options& options) :
+                    m_options(&options) {
+                }
+
+                /**
+                 * Finish the current block (if it is not empty) and add it
+                 * to the list of full blocks.
+                 */
+                void store_block() {
+                    if (!m_primitive_block || m_primitive_block->count() == 0) {
+                        return;
+                    }
+
+                    // Remember the number of slots in the hash of the
+                    // string table. The string table for the next block
+                    // starts out with the same size, so it usually doesn't
+                    // have to grow.
+                    m_bucket_count = m_primitive_block->get_bucket_count();
+
+                    m_blocks.push_back(std::move(m_primitive_block));
+                    m_primitive_block.reset();
+                }
+
+                /**
+                 * Return all full blocks in the order they were created and
+                 * forget about them.
+                 */
+                std::vector<std::shared_ptr<PrimitiveBlock>> take_blocks() {
+                    std::vector<std::shared_ptr<PrimitiveBlock>> blocks;
+                    using std::swap;
+                    swap(blocks, m_blocks);
+                    return blocks;
+                }
+
+                void node(const osmium::Node& node) {
+                    if (m_options->use_dense_nodes) {
+                        switch_primitive_block_type(OSMFormat::PrimitiveGroup::optional_DenseNodes_dense);
+                        m_primitive_block->add_dense_node(node);
+                        return;
+                    }
+
+                    switch_primitive_block_type(OSMFormat::PrimitiveGroup::repeated_Node_nodes);
+                    protozero::pbf_builder<OSMFormat::Node> pbf_node{m_primitive_block->group(), OSMFormat::PrimitiveGroup::repeated_Node_nodes};
+
+                    pbf_node.add_sint64(OSMFormat::Node::required_sint64_id, node.id());
+                    add_meta(node, pbf_node);
+
+                    pbf_node.add_sint64(OSMFormat::Node::required_sint64_lat, node.location().y());
+                    pbf_node.add_sint64(OSMFormat::Node::required_sint64_lon, node.location().x());
+                }
+
+                void way(const osmium::Way& way) {
+                    switch_primitive_block_type(OSMFormat::PrimitiveGroup::repeated_Way_ways);
+                    protozero::pbf_builder<OSMFormat::Way> pbf_way{m_primitive_block->group(), OSMFormat::PrimitiveGroup::repeated_Way_ways};
+
+                    pbf_way.add_int64(OSMFormat::Way::required_int64_id, way.id());
+                    add_meta(way, pbf_way);
+
+                    {
+                        osmium::DeltaEncode<object_id_type, int64_t> delta_id;
+                        protozero::packed_field_sint64 field{pbf_way, static_cast<protozero::pbf_tag_type>(OSMFormat::Way::packed_sint64_refs)};
+                        for (const auto& node_ref : way.nodes()) {
+                            field.add_element(delta_id.update(node_ref.ref()));
+                        }
+                    }
+
+                    if (m_options->locations_on_ways) {
+                        {
+                            osmium::DeltaEncode<int64_t, int64_t> delta;
+                            protozero::packed_field_sint64 field{pbf_way, static_cast<protozero::pbf_tag_type>(OSMFormat::Way::packed_sint64_lon)};
+                            for (const auto& node_ref : way.nodes()) {
+                                field.add_element(delta.update(node_ref.location().x()));
+                            }
+                        }
+                        {
+                            osmium::DeltaEncode<int64_t, int64_t> delta;
+                            protozero::packed_field_sint64 field{pbf_way, static_cast<protozero::pbf_tag_type>(OSMFormat::Way::packed_sint64_lat)};
+                            for (const auto& node_ref : way.nodes()) {
+                                field.add_element(delta.update(node_ref.location().y()));
+                            }
+                        }
+                    }
+                }
+
+                void relation(const osmium::Relation& relation) {
+                    switch_primitive_block_type(OSMFormat::PrimitiveGroup::repeated_Relation_relations);
+                    protozero::pbf_builder<OSMFormat::Relation> pbf_relation{m_primitive_block->group(), OSMFormat::PrimitiveGroup::repeated_Relation_relations};
+
+                    pbf_relation.add_int64(OSMFormat::Relation::required_int64_id, relation.id());
+                    add_meta(relation, pbf_relation);
+
+                    {
+                        protozero::packed_field_int32 field{pbf_relation, static_cast<protozero::pbf_tag_type>(OSMFormat::Relation::packed_int32_roles_sid)};
+                        for (const auto& member : relation.members()) {
+                            field.add_element(m_primitive_block->store_in_stringtable(member.role()));
+                        }
+                    }
+
+                    {
+                        osmium::DeltaEncode<object_id_type, int64_t> delta_id;
+                        protozero::packed_field_sint64 field{pbf_relation, static_cast<protozero::pbf_tag_type>(OSMFormat::Relation::packed_sint64_memids)};
+                        for (const auto& member : relation.members()) {
+                            field.add_element(delta_id.update(member.ref()));
+                        }
+                    }
+
+                    {
+                        protozero::packed_field_int32 field{pbf_relation, static_cast<protozero::pbf_tag_type>(OSMFormat::Relation::packed_MemberType_types)};
+                        for (const auto& member : relation.members()) {
+                            field.add_element(static_cast<int32_t>(osmium::item_type_to_nwr_index(member.type())));
+                        }
+                    }
+                }
+
+            }; // class PBFEncoder
+
+            /**
+             * A consecutive range of objects in a buffer. The buffer is
+             * shared between all ranges cut from it.
+             */
+            struct pbf_encode_segment {
+
+                std::shared_ptr<const osmium::memory::Buffer> buffer;
+                std::size_t begin;
+                std::size_t end;
+
+            }; // struct pbf_encode_segment
+
+            /**
+             * Encode a range of objects (possibly spanning several buffers)
+             * into PrimitiveBlocks and serialize them into Blobs. Used as
+             * task in the thread pool if parallel encoding is enabled.
+             */
+            class EncodePrimitiveBlocks {
+
+                std::vector<pbf_encode_segment> m_segments;
+
+                pbf_output_options m_options;
+
+            public:
+
+                EncodePrimitiveBlocks(std::vector<pbf_encode_segment>&& segments, const pbf_output_options& options) :
+                    m_segments(std::move(segments)),
+                    m_options(options) {
+                }
+
+                std::string operator()() {
+                    PBFEncoder encoder{m_options};
+                    for (const auto& segment : m_segments) {
+                        osmium::apply(segment.buffer->get_iterator(segment.begin),
+                                      segment.buffer->get_iterator(segment.end),
+                                      encoder);
+                    }
+                    encoder.store_block();
+
+                    std::string output;
+                    for (auto& block : encoder.take_blocks()) {
+                        output.append(SerializeBlob{std::move(block),
+                                                    pbf_blob_type::data,
+                                                    m_options.use_compression,
+                                                    m_options.compression_level}());
+                    }
+                    return output;
+                }
+
+            }; // class EncodePrimitiveBlocks
+
+            class PBFOutputFormat : public osmium::io::detail::OutputFormat {
+
+                pbf_output_options m_options;
+
+                PBFEncoder m_encoder{m_options};
+
+                // Objects collected for the next parallel encoding task.
+                std::vector<pbf_encode_segment> m_pending_segments;
+                OSMFormat::PrimitiveGroup m_pending_type = OSMFormat::PrimitiveGroup::optional_DenseNodes_dense;
+                std::size_t m_pending_count = 0;
+                std::size_t m_pending_size = 0;
+
+                void store_blocks() {
+                    for (auto& block : m_encoder.take_blocks()) {
+                        m_output_queue.push(m_pool.submit(
+                            SerializeBlob{std::move(block),
+                                          pbf_blob_type::data,
+                                          m_options.use_compression,
+                                          m_options.compression_level}));
+                    }
+                }
+
+                void submit_pending_range() {
+                    if (m_pending_count > 0) {
+                        m_output_queue.push(m_pool.submit(
+                            EncodePrimitiveBlocks{std::move(m_pending_segments), m_options}));
+                    }
+                    m_pending_segments.clear();
+                    m_pending_count = 0;
+                    m_pending_size = 0;
+                }
+
+                /**
+                 * Cut the buffer into ranges of objects which will fit into
+                 * a PrimitiveBlock and encode each range in its own task in
+                 * the thread pool. The size of the objects in the buffer is
+                 * used as an estimate for the size of the encoded objects,
+                 * if it is too small the task will create several blocks.
+                 */
+                void write_buffer_parallel(osmium::memory::Buffer&& buffer) {
+                    const std::shared_ptr<const osmium::memory::Buffer> shared_buffer{std::make_shared<osmium::memory::Buffer>(std::move(buffer))};
+
+                    std::size_t segment_begin = 0;
+                    for (auto it = shared_buffer->cbegin(); it != shared_buffer->cend(); ++it) {
+                        OSMFormat::PrimitiveGroup type; // NOLINT(cppcoreguidelines-init-variables)
+                        switch (it->type()) {
+                            case osmium::item_type::node:
+                                type = m_options.use_dense_nodes ? OSMFormat::PrimitiveGroup::optional_DenseNodes_dense
+                                                                 : OSMFormat::PrimitiveGroup::repeated_Node_nodes;
+                                break;
+                            case osmium::item_type::way:
+                                type = OSMFormat::PrimitiveGroup::repeated_Way_ways;
+                                break;
+                            case osmium::item_type::relation:
+                                type = OSMFormat::PrimitiveGroup::repeated_Relation_relations;
+                                break;
+                            default:
+                                continue;
+                        }
+
+                        if (m_pending_count > 0 &&
+                            (type != m_pending_type ||
+                             m_pending_count >= max_entities_per_block ||
+                             m_pending_size + it->byte_size() >= PrimitiveBlock::max_used_blob_size)) {
+                            const auto offset = static_cast<std::size_t>(it->data() - shared_buffer->data());
+                            if (offset > segment_begin) {
+                                m_pending_segments.push_back(pbf_encode_segment{shared_buffer, segment_begin, offset});
+                            }
+                            submit_pending_range();
+                            segment_begin = offset;
+                        }
+
+                        m_pending_type = type;
+                        ++m_pending_count;
+                        m_pending_size += it->byte_size();
+                    }
+
+                    if (shared_buffer->committed() > segment_begin) {
+                        m_pending_segments.push_back(pbf_encode_segment{shared_buffer, segment_begin, shared_buffer->committed()});
                     }
                 }
 
@@ -572,6 +986,14 @@ namespace osmium {
                     m_options.add_historical_information_flag = file.has_multiple_object_versions();
                     m_options.add_visible_flag = file.has_multiple_object_versions();
                     m_options.locations_on_ways = file.is_true("locations_on_ways");
+                    m_options.parallel_encoding = file.is_true("pbf_parallel_encoding");
+
+                    const auto sort = file.get("pbf_stringtable_sort");
+                    if (sort == "frequency") {
+                        m_options.sort_stringtable_by_frequency = true;
+                    } else if (!sort.empty() && sort != "none") {
+                        throw std::invalid_argument{"Unknown value for 'pbf_stringtable_sort' option."};
+                    }
 
                     const auto pbl = file.get("pbf_compression_level");
                     if (pbl.empty()) {
@@ -584,6 +1006,11 @@ namespace osmium {
                             case pbf_compression::lz4:
 #ifdef OSMIUM_WITH_LZ4
                                 m_options.compression_level = osmium::io::detail::lz4_default_compression_level();
+#endif
+                                break;
+                            case pbf_compression::zstd:
+#ifdef OSMIUM_WITH_ZSTD
+                                m_options.compression_level = osmium::io::detail::zstd_default_compression_level();
 #endif
                                 break;
                         }
@@ -602,6 +1029,11 @@ namespace osmium {
                             case pbf_compression::lz4:
 #ifdef OSMIUM_WITH_LZ4
                                 osmium::io::detail::lz4_check_compression_level(val);
+#endif
+                                break;
+                            case pbf_compression::zstd:
+#ifdef OSMIUM_WITH_ZSTD
+                                osmium::io::detail::zstd_check_compression_level(val);
 #endif
                                 break;
                         }
@@ -667,91 +1099,21 @@ namespace osmium {
                 }
 
                 void write_buffer(osmium::memory::Buffer&& buffer) final {
-                    osmium::apply(buffer.cbegin(), buffer.cend(), *this);
-                }
-
-                void write_end() final {
-                    store_primitive_block();
-                }
-
-                void node(const osmium::Node& node) {
-                    if (m_options.use_dense_nodes) {
-                        switch_primitive_block_type(OSMFormat::PrimitiveGroup::optional_DenseNodes_dense);
-                        m_primitive_block->add_dense_node(node);
+                    if (m_options.parallel_encoding) {
+                        write_buffer_parallel(std::move(buffer));
                         return;
                     }
-
-                    switch_primitive_block_type(OSMFormat::PrimitiveGroup::repeated_Node_nodes);
-                    protozero::pbf_builder<OSMFormat::Node> pbf_node{m_primitive_block->group(), OSMFormat::PrimitiveGroup::repeated_Node_nodes};
-
-                    pbf_node.add_sint64(OSMFormat::Node::required_sint64_id, node.id());
-                    add_meta(node, pbf_node);
-
-                    pbf_node.add_sint64(OSMFormat::Node::required_sint64_lat, node.location().y());
-                    pbf_node.add_sint64(OSMFormat::Node::required_sint64_lon, node.location().x());
+                    osmium::apply(buffer.cbegin(), buffer.cend(), m_encoder);
+                    store_blocks();
                 }
 
-                void way(const osmium::Way& way) {
-                    switch_primitive_block_type(OSMFormat::PrimitiveGroup::repeated_Way_ways);
-                    protozero::pbf_builder<OSMFormat::Way> pbf_way{m_primitive_block->group(), OSMFormat::PrimitiveGroup::repeated_Way_ways};
-
-                    pbf_way.add_int64(OSMFormat::Way::required_int64_id, way.id());
-                    add_meta(way, pbf_way);
-
-                    {
-                        osmium::DeltaEncode<object_id_type, int64_t> delta_id;
-                        protozero::packed_field_sint64 field{pbf_way, static_cast<protozero::pbf_tag_type>(OSMFormat::Way::packed_sint64_refs)};
-                        for (const auto& node_ref : way.nodes()) {
-                            field.add_element(delta_id.update(node_ref.ref()));
-                        }
-                    }
-
-                    if (m_options.locations_on_ways) {
-                        {
-                            osmium::DeltaEncode<int64_t, int64_t> delta;
-                            protozero::packed_field_sint64 field{pbf_way, static_cast<protozero::pbf_tag_type>(OSMFormat::Way::packed_sint64_lon)};
-                            for (const auto& node_ref : way.nodes()) {
-                                field.add_element(delta.update(node_ref.location().x()));
-                            }
-                        }
-                        {
-                            osmium::DeltaEncode<int64_t, int64_t> delta;
-                            protozero::packed_field_sint64 field{pbf_way, static_cast<protozero::pbf_tag_type>(OSMFormat::Way::packed_sint64_lat)};
-                            for (const auto& node_ref : way.nodes()) {
-                                field.add_element(delta.update(node_ref.location().y()));
-                            }
-                        }
-                    }
-                }
-
-                void relation(const osmium::Relation& relation) {
-                    switch_primitive_block_type(OSMFormat::PrimitiveGroup::repeated_Relation_relations);
-                    protozero::pbf_builder<OSMFormat::Relation> pbf_relation{m_primitive_block->group(), OSMFormat::PrimitiveGroup::repeated_Relation_relations};
-
-                    pbf_relation.add_int64(OSMFormat::Relation::required_int64_id, relation.id());
-                    add_meta(relation, pbf_relation);
-
-                    {
-                        protozero::packed_field_int32 field{pbf_relation, static_cast<protozero::pbf_tag_type>(OSMFormat::Relation::packed_int32_roles_sid)};
-                        for (const auto& member : relation.members()) {
-                            field.add_element(m_primitive_block->store_in_stringtable(member.role()));
-                        }
-                    }
-
-                    {
-                        osmium::DeltaEncode<object_id_type, int64_t> delta_id;
-                        protozero::packed_field_sint64 field{pbf_relation, static_cast<protozero::pbf_tag_type>(OSMFormat::Relation::packed_sint64_memids)};
-                        for (const auto& member : relation.members()) {
-                            field.add_element(delta_id.update(member.ref()));
-                        }
-                    }
-
-                    {
-                        protozero::packed_field_int32 field{pbf_relation, static_cast<protozero::pbf_tag_type>(OSMFormat::Relation::packed_MemberType_types)};
-                        for (const auto& member : relation.members()) {
-                            field.add_element(static_cast<int32_t>(osmium::item_type_to_nwr_index(member.type())));
-                        }
+                void write_end() final {
+                    if (m_options.parallel_encoding) {
+                        submit_pending_range();
+                        return;
                     }
+                    m_encoder.store_block();
+                    store_blocks();
                 }
 
             }; // class PBFOutputFormat
@@ -0,0 +1,210 @@
+#ifndef OSMIUM_IO_DETAIL_PBF_VARINT_HPP
+#define OSMIUM_IO_DETAIL_PBF_VARINT_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2023 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <protozero/data_view.hpp>
+#include <protozero/varint.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(__AVX2__) || defined(__BMI2__)
+# include <immintrin.h>
+#endif
+
+namespace osmium {
+
+    namespace io {
+
+        namespace detail {
+
+            /**
+             * Extract the value of a varint with the given length (1 to 8
+             * bytes) from a little-endian 64 bit word containing it in the
+             * lowest bytes.
+             */
+            inline uint64_t extract_varint(uint64_t word, unsigned int length) noexcept {
+                const uint64_t mask = length == 8 ? 0x7f7f7f7f7f7f7f7fULL
+                                                  : 0x7f7f7f7f7f7f7f7fULL & ((1ULL << (length * 8U)) - 1U);
+#ifdef __BMI2__
+                return _pext_u64(word, mask);
+#else
+                // Squeeze out the continuation bits in three steps.
+                uint64_t x = word & mask;
+                x = ((x & 0x7f007f007f007f00ULL) >> 1U) | (x & 0x007f007f007f007fULL);
+                x = ((x & 0x3fff00003fff0000ULL) >> 2U) | (x & 0x00003fff00003fffULL);
+                x = ((x & 0x0fffffff00000000ULL) >> 4U) | (x & 0x000000000fffffffULL);
+                return x;
+#endif
+            }
+
+            inline unsigned int count_trailing_zeros(uint64_t value) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+                return static_cast<unsigned int>(__builtin_ctzll(value));
+#else
+                unsigned int n = 0;
+                while ((value & 1U) == 0) {
+                    value >>= 1U;
+                    ++n;
+                }
+                return n;
+#endif
+            }
+
+            /**
+             * Decode all varints in the range [data, end) and call func
+             * with each value.
+             *
+             * With SSE2 the positions of the last bytes of all varints in
+             * the next 16 bytes are found with one instruction and each
+             * varint (up to 8 bytes long) is then extracted from a 64 bit
+             * word without looking at its bytes one by one. Runs of
+             * one-byte varints are handled 16 (or with AVX2 32) bytes at
+             * a time. Without SSE2 the 64 bit word trick is used on each
+             * varint. Close to the end of the data and for varints longer
+             * than 8 bytes this falls back to protozero::decode_varint(),
+             * so errors are reported in the same way, with the protozero
+             * exceptions.
+             */
+            template <typename TFunc>
+            inline void for_each_varint(const char* data, const char* end, TFunc&& func) {
+                // Working on 64 bit words needs a little-endian machine.
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+# ifdef __SSE2__
+                // We look at 16 bytes and might read 8 bytes starting at
+                // the last of them.
+                while (end - data >= 24) {
+#  ifdef __AVX2__
+                    if (end - data >= 32) {
+                        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+                        if (_mm256_movemask_epi8(chunk) == 0) {
+                            for (int i = 0; i < 32; ++i) {
+                                func(static_cast<uint64_t>(static_cast<unsigned char>(data[i])));
+                            }
+                            data += 32;
+                            continue;
+                        }
+                    }
+#  endif
+                    const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+                    const auto high_bits = static_cast<unsigned int>(_mm_movemask_epi8(chunk));
+                    if (high_bits == 0) {
+                        for (int i = 0; i < 16; ++i) {
+                            func(static_cast<uint64_t>(static_cast<unsigned char>(data[i])));
+                        }
+                        data += 16;
+                        continue;
+                    }
+
+                    // Each bit set here marks the last byte of a varint.
+                    unsigned int last_bytes = ~high_bits & 0xffffU;
+                    unsigned int pos = 0;
+                    while (last_bytes != 0) {
+                        const unsigned int last = count_trailing_zeros(last_bytes);
+                        const unsigned int length = last + 1 - pos;
+                        if (length > 8) {
+                            break;
+                        }
+                        uint64_t word; // NOLINT(cppcoreguidelines-init-variables)
+                        std::memcpy(&word, data + pos, sizeof(word));
+                        func(extract_varint(word, length));
+                        pos = last + 1;
+                        last_bytes &= last_bytes - 1;
+                    }
+
+                    if (pos == 0) {
+                        // varint is longer than 8 bytes
+                        func(protozero::decode_varint(&data, end));
+                    } else {
+                        data += pos;
+                    }
+                }
+# else
+                while (end - data >= 8) {
+                    uint64_t word; // NOLINT(cppcoreguidelines-init-variables)
+                    std::memcpy(&word, data, sizeof(word));
+                    const uint64_t stop_bits = ~word & 0x8080808080808080ULL;
+                    if (stop_bits == 0) {
+                        // varint is longer than 8 bytes
+                        func(protozero::decode_varint(&data, end));
+                        continue;
+                    }
+                    const unsigned int length = (count_trailing_zeros(stop_bits) >> 3U) + 1;
+                    func(extract_varint(word, length));
+                    data += length;
+                }
+# endif
+#endif
+                while (data != end) {
+                    func(protozero::decode_varint(&data, end));
+                }
+            }
+
+            /**
+             * Decode a packed field of int32 or uint32 varints into the
+             * output vector (replacing its contents).
+             */
+            template <typename T>
+            inline void decode_packed_varints(const protozero::data_view& data, std::vector<T>& output) {
+                output.clear();
+                output.reserve(data.size());
+                for_each_varint(data.data(), data.data() + data.size(), [&output](uint64_t value) {
+                    output.push_back(static_cast<T>(value));
+                });
+            }
+
+            /**
+             * Decode a packed field of delta encoded sint64 varints into
+             * the output vector (replacing its contents). The output
+             * contains the absolute values.
+             */
+            inline void decode_packed_sint64_delta(const protozero::data_view& data, std::vector<int64_t>& output) {
+                output.clear();
+                output.reserve(data.size());
+                int64_t value = 0;
+                for_each_varint(data.data(), data.data() + data.size(), [&output, &value](uint64_t delta) {
+                    value += protozero::decode_zigzag64(delta);
+                    output.push_back(value);
+                });
+            }
+
+        } // namespace detail
+
+    } // namespace io
+
+} // namespace osmium
+
+#endif // OSMIUM_IO_DETAIL_PBF_VARINT_HPP
@@ -34,7 +34,12 @@ DEALINGS IN THE SOFTWARE.
 */
 
 #include <osmium/memory/buffer.hpp>
-#include <osmium/thread/queue.hpp>
+
+#ifdef OSMIUM_USE_LOCK_FREE_QUEUE
+# include <osmium/thread/bounded_queue.hpp>
+#else
+# include <osmium/thread/queue.hpp>
+#endif
 
 #include <cassert>
 #include <exception>
@@ -48,8 +53,19 @@ namespace osmium {
 
         namespace detail {
 
+            /**
+             * The queues used between the threads reading and writing OSM
+             * data. Define OSMIUM_USE_LOCK_FREE_QUEUE before including any
+             * libosmium headers to use the lock-free BoundedQueue instead
+             * of the mutex-based Queue.
+             */
+#ifdef OSMIUM_USE_LOCK_FREE_QUEUE
+            template <typename T>
+            using future_queue_type = osmium::thread::BoundedQueue<std::future<T>>;
+#else
             template <typename T>
             using future_queue_type = osmium::thread::Queue<std::future<T>>;
+#endif
 
             /**
              * This type of queue contains buffers with OSM data in them.
@@ -43,6 +43,12 @@ DEALINGS IN THE SOFTWARE.
 #include <string>
 #include <system_error>
 
+#ifdef _WIN32
+# include <mutex>
+#else
+# include <unistd.h>
+#endif
+
 namespace osmium {
 
     namespace io {
@@ -225,6 +231,44 @@ namespace osmium {
                 return true;
             }
 
+            /**
+             * Read exactly size bytes from fd at the given offset into
+             * buffer. The file offset of fd is not changed (except on
+             * Windows), so this can be called from several threads at the
+             * same time on the same file descriptor.
+             *
+             * @pre buffer Buffer for data to be read. Must be at least size bytes long.
+             * @returns true if size bytes could be read
+             *          false if EOF was encountered
+             * @throws std::system_error On error.
+             */
+            inline bool read_exactly_at(int fd, char* buffer, std::size_t size, std::size_t offset) {
+#ifdef _WIN32
+                // There is no pread() on Windows, emulate it.
+                static std::mutex mutex;
+                const std::lock_guard<std::mutex> lock{mutex};
+                osmium::util::file_seek(fd, offset);
+                return read_exactly(fd, buffer, static_cast<unsigned int>(size));
+#else
+                while (size > 0) {
+                    const auto read_size = ::pread(fd, buffer, size, static_cast<off_t>(offset));
+                    if (read_size < 0) {
+                        if (errno == EINTR) {
+                            continue;
+                        }
+                        throw std::system_error{errno, std::system_category(), "Read failed"};
+                    }
+                    if (read_size == 0) { // EOF
+                        return false;
+                    }
+                    buffer += read_size;
+                    size -= static_cast<std::size_t>(read_size);
+                    offset += static_cast<std::size_t>(read_size);
+                }
+                return true;
+#endif
+            }
+
             inline void reliable_fsync(const int fd) {
 #ifdef _MSC_VER
                 osmium::detail::disable_invalid_parameter_handler diph;
@@ -35,6 +35,8 @@ DEALINGS IN THE SOFTWARE.
 
 #include <osmium/io/detail/pbf.hpp>
 
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
@@ -42,8 +44,8 @@ DEALINGS IN THE SOFTWARE.
 #include <iterator>
 #include <list>
 #include <string>
-#include <unordered_map>
 #include <utility>
+#include <vector>
 
 namespace osmium {
 
@@ -94,7 +96,17 @@ namespace osmium {
                  * allocated.
                  */
                 const char* add(const char* string) {
-                    const size_t len = std::strlen(string) + 1;
+                    return add(string, std::strlen(string));
+                }
+
+                /**
+                 * Add a string of the given length to the store. The
+                 * string must not contain a null byte.
+                 * Returns a pointer to the null terminated copy of the
+                 * string we have allocated.
+                 */
+                const char* add(const char* string, size_t length) {
+                    const size_t len = length + 1;
 
                     assert(len <= m_chunk_size);
 
@@ -104,7 +116,7 @@ namespace osmium {
                         chunk_len = 0;
                     }
 
-                    m_chunks.back().append(string);
+                    m_chunks.back().append(string, length);
                     m_chunks.back().append(1, '\0');
 
                     return m_chunks.back().c_str() + chunk_len;
@@ -201,29 +213,53 @@ namespace osmium {
 
             }; // class StringStore
 
-            struct str_equal {
-
-                bool operator()(const char* lhs, const char* rhs) const noexcept {
-                    return lhs == rhs || std::strcmp(lhs, rhs) == 0;
-                }
-
-            }; // struct str_equal
-
-            struct djb2_hash {
-
-                std::size_t operator()(const char* str) const noexcept {
-                    std::size_t hash = 5381;
-                    int c = 0;
+            /**
+             * Hash function for strings of known length. Works on eight
+             * bytes at a time instead of a byte at a time so the compiler
+             * can keep everything in registers.
+             */
+            inline uint64_t string_hash(const char* str, std::size_t length) noexcept {
+                uint64_t hash = 0x9e3779b97f4a7c15ULL ^ length;
+                uint64_t word = 0;
 
-                    while ((c = static_cast<signed char>(*str++))) { // NOLINT(bugprone-signed-char-misuse,cert-str34-c)
-                        hash = ((hash << 5U) + hash) + c; /* hash * 33 + c */
+                if (length < sizeof(uint64_t)) {
+                    for (std::size_t i = 0; i < length; ++i) {
+                        word |= static_cast<uint64_t>(static_cast<unsigned char>(str[i])) << (i * 8U);
                     }
-
-                    return hash;
+                } else {
+                    const char* const last = str + length - sizeof(uint64_t);
+                    while (str < last) {
+                        std::memcpy(&word, str, sizeof(uint64_t));
+                        hash = (hash ^ word) * 0xff51afd7ed558ccdULL;
+                        hash ^= hash >> 32U;
+                        str += sizeof(uint64_t);
+                    }
+                    // The last eight bytes, possibly overlapping with
+                    // bytes already hashed.
+                    std::memcpy(&word, last, sizeof(uint64_t));
                 }
 
-            }; // struct djb2_hash
+                hash = (hash ^ word) * 0xc4ceb9fe1a85ec53ULL;
+                hash ^= hash >> 29U;
 
+                return hash;
+            }
+
+            /**
+             * The string table for PBF primitive blocks. Every string added
+             * gets a consecutive id starting from 1, adding the same string
+             * again returns the same id. Id 0 is always the empty string
+             * (but it is not found by add(), this is how the PBF format
+             * works).
+             *
+             * Strings are kept in a StringStore, the index is a flat hash
+             * table with open addressing and linear probing that stores
+             * the hash and id of each string. The lengths of all strings
+             * are remembered so most comparisons are decided without
+             * looking at the string data. There is an additional small
+             * direct-mapped cache for short strings, which catches the
+             * few very common keys and values like "highway" or "name".
+             */
             class StringTable {
 
                 // This is the maximum number of entries in a string table.
@@ -235,10 +271,67 @@ namespace osmium {
                     max_entries = static_cast<int32_t>(max_uncompressed_blob_size)
                 };
 
+                // Only strings up to this length are stored in the cache.
+                enum {
+                    max_cached_length = 32
+                };
+
+                enum {
+                    cache_size = 64
+                };
+
+                struct slot {
+                    uint32_t hash;
+                    int32_t id; // 0 means the slot is empty
+                };
+
+                struct entry {
+                    const char* str;
+                    std::size_t length;
+                    uint32_t count;
+                };
+
                 StringStore m_strings;
-                std::unordered_map<const char*, int32_t, djb2_hash, str_equal> m_index;
+                std::vector<slot> m_slots;
+                std::vector<entry> m_entries;
+                std::array<int32_t, cache_size> m_cache{};
                 int32_t m_size = 0;
 
+                static std::size_t initial_slot_count(std::size_t bucket_count) noexcept {
+                    std::size_t count = 16;
+                    while (count < bucket_count) {
+                        count *= 2;
+                    }
+                    return count;
+                }
+
+                static std::size_t cache_index(const char* s, std::size_t length) noexcept {
+                    return (length * 7U +
+                            static_cast<unsigned char>(s[0]) +
+                            static_cast<unsigned char>(s[length - 1])) % cache_size;
+                }
+
+                bool matches(int32_t id, const char* s, std::size_t length) const noexcept {
+                    const auto& e = m_entries[static_cast<std::size_t>(id)];
+                    return e.length == length && std::memcmp(e.str, s, length) == 0;
+                }
+
+                void grow() {
+                    std::vector<slot> slots(m_slots.size() * 2);
+                    const std::size_t mask = slots.size() - 1;
+                    for (const auto& old_slot : m_slots) {
+                        if (old_slot.id != 0) {
+                            std::size_t pos = old_slot.hash & mask;
+                            while (slots[pos].id != 0) {
+                                pos = (pos + 1) & mask;
+                            }
+                            slots[pos] = old_slot;
+                        }
+                    }
+                    using std::swap;
+                    swap(m_slots, slots);
+                }
+
             public:
 
                 // There is one string table per PBF primitive block. Most of
@@ -257,10 +350,17 @@ namespace osmium {
                     min_bucket_count = 1
                 };
 
+                /**
+                 * Create a new string table.
+                 *
+                 * @param size Chunk size for the string storage.
+                 * @param bucket_count Initial number of slots in the hash
+                 *        table. Rounded up to a power of two.
+                 */
                 explicit StringTable(size_t size = default_stringtable_chunk_size, size_t bucket_count = min_bucket_count) :
                     m_strings(size),
-                    m_index(bucket_count) {
-                    m_strings.add("");
+                    m_slots(initial_slot_count(bucket_count)) {
+                    m_entries.push_back(entry{m_strings.add(""), 0, 0});
                 }
 
                 int32_t size() const noexcept {
@@ -268,25 +368,97 @@ namespace osmium {
                 }
 
                 std::size_t get_bucket_count() const noexcept {
-                    return m_index.bucket_count();
+                    return m_slots.size();
                 }
 
                 int32_t add(const char* s) {
-                    const auto f = m_index.find(s);
-                    if (f != m_index.end()) {
-                        return f->second;
+                    const std::size_t length = std::strlen(s);
+
+                    int32_t* cache_entry = nullptr;
+                    if (length > 0 && length <= max_cached_length) {
+                        cache_entry = &m_cache[cache_index(s, length)];
+                        if (*cache_entry != 0 && matches(*cache_entry, s, length)) {
+                            ++m_entries[static_cast<std::size_t>(*cache_entry)].count;
+                            return *cache_entry;
+                        }
                     }
 
-                    const char* cs = m_strings.add(s);
-                    m_index[cs] = ++m_size;
+                    const auto hash = static_cast<uint32_t>(string_hash(s, length));
+                    const std::size_t mask = m_slots.size() - 1;
+                    std::size_t pos = hash & mask;
+                    while (m_slots[pos].id != 0) {
+                        const int32_t id = m_slots[pos].id;
+                        if (m_slots[pos].hash == hash && matches(id, s, length)) {
+                            ++m_entries[static_cast<std::size_t>(id)].count;
+                            if (cache_entry) {
+                                *cache_entry = id;
+                            }
+                            return id;
+                        }
+                        pos = (pos + 1) & mask;
+                    }
 
-                    if (m_size > max_entries) {
+                    if (m_size >= max_entries) {
                         throw osmium::pbf_error{"string table has too many entries"};
                     }
 
+                    m_entries.push_back(entry{m_strings.add(s, length), length, 1});
+                    m_slots[pos] = slot{hash, ++m_size};
+
+                    // Keep the load factor below 0.5.
+                    if (static_cast<std::size_t>(m_size) * 2 > m_slots.size()) {
+                        grow();
+                    }
+
+                    if (cache_entry) {
+                        *cache_entry = m_size;
+                    }
+
                     return m_size;
                 }
 
+                /**
+                 * Get the string with the specified id.
+                 */
+                const char* get(int32_t id) const noexcept {
+                    assert(id >= 0 && id <= m_size);
+                    return m_entries[static_cast<std::size_t>(id)].str;
+                }
+
+                /**
+                 * How often was the string with the specified id added?
+                 */
+                uint32_t count(int32_t id) const noexcept {
+                    assert(id >= 0 && id <= m_size);
+                    return m_entries[static_cast<std::size_t>(id)].count;
+                }
+
+                /**
+                 * Compute new ids for all strings so that the most often
+                 * used strings get the smallest ids. Strings used equally
+                 * often stay in the order they were added. The empty
+                 * string at id 0 stays where it is.
+                 *
+                 * @returns Vector mapping each old id to its new id.
+                 */
+                std::vector<int32_t> frequency_mapping() const {
+                    std::vector<int32_t> order(static_cast<std::size_t>(m_size));
+                    for (std::size_t i = 0; i < order.size(); ++i) {
+                        order[i] = static_cast<int32_t>(i + 1);
+                    }
+
+                    std::stable_sort(order.begin(), order.end(), [this](int32_t a, int32_t b) {
+                        return count(a) > count(b);
+                    });
+
+                    std::vector<int32_t> mapping(order.size() + 1, 0);
+                    for (std::size_t i = 0; i < order.size(); ++i) {
+                        mapping[static_cast<std::size_t>(order[i])] = static_cast<int32_t>(i + 1);
+                    }
+
+                    return mapping;
+                }
+
                 StringStore::const_iterator begin() const {
                     return m_strings.begin();
                 }
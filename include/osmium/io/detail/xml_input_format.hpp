@@ -38,6 +38,7 @@ DEALINGS IN THE SOFTWARE.
 #include <osmium/io/detail/input_format.hpp>
 #include <osmium/io/detail/queue_util.hpp>
 #include <osmium/io/error.hpp>
+#include <osmium/io/file.hpp>
 #include <osmium/io/file_format.hpp>
 #include <osmium/io/header.hpp>
 #include <osmium/memory/buffer.hpp>
@@ -54,11 +55,14 @@ DEALINGS IN THE SOFTWARE.
 #include <osmium/osm/types.hpp>
 #include <osmium/osm/types_from_string.hpp>
 #include <osmium/osm/way.hpp>
+#include <osmium/thread/ordered_results.hpp>
+#include <osmium/thread/pool.hpp>
 #include <osmium/thread/util.hpp>
 
 #include <expat.h>
 
 #include <cassert>
+#include <cstddef>
 #include <cstring>
 #include <exception>
 #include <future>
@@ -66,6 +70,7 @@ DEALINGS IN THE SOFTWARE.
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 namespace osmium {
 
@@ -164,6 +169,8 @@ namespace osmium {
 
                 std::string m_comment_text;
 
+                bool m_parallel;
+
                 /**
                  * A C++ wrapper for the Expat parser that makes sure no memory
                  * is leaked.
@@ -746,10 +753,224 @@ namespace osmium {
                     }
                 }
 
+                // Parse all input in the current thread.
+                void parse_input() {
+                    ExpatXMLParser parser{this};
+                    m_expat_xml_parser = &parser;
+
+                    while (!input_done()) {
+                        const std::string data{get_input()};
+                        parser(data, input_done());
+                        if (read_types() == osmium::osm_entity_bits::nothing && header_is_done()) {
+                            break;
+                        }
+                    }
+
+                    mark_header_as_done();
+                    flush_final_buffer();
+                }
+
+                enum {
+                    // Minimum size of chunks for parallel parsing.
+                    parallel_chunk_size = 1024UL * 1024UL
+                };
+
+                static bool is_element_start(const char* str, const char* name) noexcept {
+                    const auto len = std::strlen(name);
+                    if (std::strncmp(str, name, len) != 0) {
+                        return false;
+                    }
+                    const char c = str[len];
+                    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '>' || c == '/';
+                }
+
+                // Find the start of the next <node>, <way>, <relation>, or
+                // <changeset> element at or after the given position.
+                static std::size_t find_data_element(const std::string& data, std::size_t pos) noexcept {
+                    while ((pos = data.find('<', pos)) != std::string::npos) {
+                        const char* str = data.c_str() + pos + 1;
+                        if (is_element_start(str, "node") ||
+                            is_element_start(str, "way") ||
+                            is_element_start(str, "relation") ||
+                            is_element_start(str, "changeset")) {
+                            return pos;
+                        }
+                        ++pos;
+                    }
+                    return std::string::npos;
+                }
+
+                // Find out in which create/modify/delete section of a
+                // change file we are at the end of the data given the
+                // section at the start.
+                static context section_at_end(const std::string& data, context section) noexcept {
+                    std::size_t pos = data.size();
+                    while (pos > 0 && (pos = data.rfind('<', pos - 1)) != std::string::npos) {
+                        const char* str = data.c_str() + pos + 1;
+                        const bool is_end_tag = (*str == '/');
+                        if (is_end_tag) {
+                            ++str;
+                        }
+                        if (is_element_start(str, "create")) {
+                            return is_end_tag ? context::osmChange : context::create_section;
+                        }
+                        if (is_element_start(str, "modify")) {
+                            return is_end_tag ? context::osmChange : context::modify_section;
+                        }
+                        if (is_element_start(str, "delete")) {
+                            return is_end_tag ? context::osmChange : context::delete_section;
+                        }
+                    }
+                    return section;
+                }
+
+                static const char* section_name(context section) noexcept {
+                    switch (section) {
+                        case context::create_section:
+                            return "create";
+                        case context::modify_section:
+                            return "modify";
+                        case context::delete_section:
+                            return "delete";
+                        default:
+                            break;
+                    }
+                    return nullptr;
+                }
+
+                /**
+                 * Parses a chunk of an XML file in a pool thread. The chunk
+                 * has been wrapped into the top-level element (and the
+                 * create/modify/delete section if needed), so that it is a
+                 * complete document.
+                 */
+                class XMLChunkDecoder {
+
+                    std::string m_data;
+                    chunk_parser_settings m_settings;
+
+                public:
+
+                    XMLChunkDecoder(std::string&& data, const chunk_parser_settings& settings) :
+                        m_data(std::move(data)),
+                        m_settings(settings) {
+                    }
+
+                    std::vector<osmium::memory::Buffer> operator()() {
+                        return parse_chunk<XMLParser>(std::move(m_data), m_settings, [](XMLParser& parser) {
+                            parser.parse_input();
+                        });
+                    }
+
+                }; // class XMLChunkDecoder
+
+                /**
+                 * Parse the input in chunks in the pool threads. Everything
+                 * up to the first OSM object is parsed in this thread to get
+                 * the header. The rest is split into chunks at the start of
+                 * <node>, <way>, <relation>, or <changeset> elements. The
+                 * chunks are parsed in parallel and the resulting buffers
+                 * sent on in order.
+                 *
+                 * The splitting does not understand XML comments or CDATA
+                 * sections. If they contain something looking like the start
+                 * of one of those elements, parsing will fail.
+                 */
+                void parse_input_parallel() {
+                    std::string data;
+
+                    // Parse the beginning of the file up to the first
+                    // object to get the header and find out which
+                    // top-level element and section we are in.
+                    std::size_t pos = std::string::npos;
+                    while (!input_done()) {
+                        data.append(get_input());
+                        pos = find_data_element(data, 0);
+                        if (pos != std::string::npos) {
+                            break;
+                        }
+                    }
+
+                    ExpatXMLParser parser{this};
+                    m_expat_xml_parser = &parser;
+
+                    if (pos == std::string::npos) {
+                        // No objects in the file.
+                        parser(data, true);
+                        mark_header_as_done();
+                        flush_final_buffer();
+                        return;
+                    }
+
+                    parser(data.substr(0, pos), false);
+                    mark_header_as_done();
+                    data.erase(0, pos);
+
+                    if (m_context_stack.empty()) {
+                        throw osmium::xml_error{"OSM object outside top-level element"};
+                    }
+                    const bool is_change_file = m_context_stack.front() == context::osmChange;
+                    const char* root = is_change_file ? "osmChange" : "osm";
+                    context section = m_context_stack.back();
+
+                    osmium::thread::OrderedResults<std::vector<osmium::memory::Buffer>> chunks{get_pool()};
+                    const auto settings = get_chunk_parser_settings();
+                    const auto output = [this](std::vector<osmium::memory::Buffer>&& buffers) {
+                        for (auto& buffer : buffers) {
+                            send_to_output_queue(std::move(buffer));
+                        }
+                    };
+
+                    const auto submit_chunk = [&](std::size_t size, bool last) {
+                        std::string chunk{"<"};
+                        chunk += root;
+                        chunk += " version=\"0.6\">";
+                        const char* name = section_name(section);
+                        if (name) {
+                            chunk += '<';
+                            chunk += name;
+                            chunk += '>';
+                        }
+                        chunk.append(data, 0, size);
+                        if (!last) {
+                            if (is_change_file) {
+                                section = section_at_end(chunk, section);
+                            }
+                            name = section_name(section);
+                            if (name) {
+                                chunk += "</";
+                                chunk += name;
+                                chunk += '>';
+                            }
+                            chunk += "</";
+                            chunk += root;
+                            chunk += '>';
+                        }
+                        data.erase(0, size);
+
+                        chunks.submit(XMLChunkDecoder{std::move(chunk), settings}, output);
+                    };
+
+                    while (!input_done()) {
+                        data.append(get_input());
+                        while (data.size() > parallel_chunk_size) {
+                            pos = find_data_element(data, parallel_chunk_size);
+                            if (pos == std::string::npos) {
+                                break;
+                            }
+                            submit_chunk(pos, false);
+                        }
+                    }
+                    submit_chunk(data.size(), true);
+
+                    chunks.output_all(output);
+                }
+
             public:
 
                 explicit XMLParser(parser_arguments& args) :
-                    ParserWithBuffer(args) {
+                    ParserWithBuffer(args),
+                    m_parallel(args.file.is_true("xml_parallel")) {
                 }
 
                 XMLParser(const XMLParser&) = delete;
@@ -763,19 +984,11 @@ namespace osmium {
                 void run() override {
                     osmium::thread::set_thread_name("_osmium_xml_in");
 
-                    ExpatXMLParser parser{this};
-                    m_expat_xml_parser = &parser;
-
-                    while (!input_done()) {
-                        const std::string data{get_input()};
-                        parser(data, input_done());
-                        if (read_types() == osmium::osm_entity_bits::nothing && header_is_done()) {
-                            break;
-                        }
+                    if (m_parallel && read_types() != osmium::osm_entity_bits::nothing) {
+                        parse_input_parallel();
+                    } else {
+                        parse_input();
                     }
-
-                    mark_header_as_done();
-                    flush_final_buffer();
                 }
 
             }; // class XMLParser
@@ -47,6 +47,7 @@ DEALINGS IN THE SOFTWARE.
 
 #include <cassert>
 #include <limits>
+#include <memory>
 #include <string>
 
 namespace osmium {
@@ -65,35 +66,154 @@ namespace osmium {
                 }
             }
 
+            /**
+             * A zlib stream for compressing data which is kept around and
+             * reused. Setting up a stream is expensive, resetting it is
+             * cheap.
+             */
+            class zlib_deflate_stream {
+
+                z_stream m_stream{};
+                int m_compression_level;
+
+            public:
+
+                explicit zlib_deflate_stream(int compression_level) :
+                    m_compression_level(compression_level) {
+                    const auto result = ::deflateInit(&m_stream, compression_level);
+                    if (result != Z_OK) {
+                        throw io_error{std::string{"failed to compress data: "} + zError(result)};
+                    }
+                }
+
+                zlib_deflate_stream(const zlib_deflate_stream&) = delete;
+                zlib_deflate_stream& operator=(const zlib_deflate_stream&) = delete;
+
+                zlib_deflate_stream(zlib_deflate_stream&&) = delete;
+                zlib_deflate_stream& operator=(zlib_deflate_stream&&) = delete;
+
+                ~zlib_deflate_stream() noexcept {
+                    ::deflateEnd(&m_stream);
+                }
+
+                int compression_level() const noexcept {
+                    return m_compression_level;
+                }
+
+                z_stream* get() noexcept {
+                    return &m_stream;
+                }
+
+            }; // class zlib_deflate_stream
+
+            /**
+             * A zlib stream for uncompressing data which is kept around and
+             * reused. Setting up a stream is expensive, resetting it is
+             * cheap.
+             */
+            class zlib_inflate_stream {
+
+                z_stream m_stream{};
+
+            public:
+
+                zlib_inflate_stream() {
+                    const auto result = ::inflateInit(&m_stream);
+                    if (result != Z_OK) {
+                        throw io_error{std::string{"failed to uncompress data: "} + zError(result)};
+                    }
+                }
+
+                zlib_inflate_stream(const zlib_inflate_stream&) = delete;
+                zlib_inflate_stream& operator=(const zlib_inflate_stream&) = delete;
+
+                zlib_inflate_stream(zlib_inflate_stream&&) = delete;
+                zlib_inflate_stream& operator=(zlib_inflate_stream&&) = delete;
+
+                ~zlib_inflate_stream() noexcept {
+                    ::inflateEnd(&m_stream);
+                }
+
+                z_stream* get() noexcept {
+                    return &m_stream;
+                }
+
+            }; // class zlib_inflate_stream
+
+            /**
+             * Get the zlib compression stream for the current thread set
+             * up for the specified compression level. The stream is reset
+             * and ready for use.
+             */
+            inline z_stream* zlib_thread_deflate_stream(int compression_level) {
+                static thread_local std::unique_ptr<zlib_deflate_stream> stream;
+                if (!stream || stream->compression_level() != compression_level) {
+                    stream.reset(); // free old stream before creating new one
+                    stream.reset(new zlib_deflate_stream{compression_level});
+                } else {
+                    ::deflateReset(stream->get());
+                }
+                return stream->get();
+            }
+
+            /**
+             * Get the zlib uncompression stream for the current thread. The
+             * stream is reset and ready for use.
+             */
+            inline z_stream* zlib_thread_inflate_stream() {
+                static thread_local std::unique_ptr<zlib_inflate_stream> stream;
+                if (!stream) {
+                    stream.reset(new zlib_inflate_stream{});
+                } else {
+                    ::inflateReset(stream->get());
+                }
+                return stream->get();
+            }
+
             /**
              * Compress data using zlib.
              *
              * Note that this function can not compress data larger than
-             * what fits in an unsigned long, on Windows this is usually 32bit.
+             * what fits in an unsigned int.
              *
              * @param input Data to compress.
+             * @param output Compressed data. The capacity of this string is
+             *               reused if possible.
              * @param compression_level Compression level.
-             * @returns Compressed data.
              */
-            inline std::string zlib_compress(const std::string& input, int compression_level = Z_DEFAULT_COMPRESSION) {
-                assert(input.size() < std::numeric_limits<unsigned long>::max());
-                unsigned long output_size = ::compressBound(static_cast<unsigned long>(input.size())); // NOLINT(google-runtime-int)
+            inline void zlib_compress(const std::string& input, std::string& output, int compression_level = Z_DEFAULT_COMPRESSION) {
+                assert(input.size() < std::numeric_limits<unsigned int>::max());
+                z_stream* stream = zlib_thread_deflate_stream(compression_level);
 
-                std::string output(output_size, '\0');
+                const auto output_size = ::deflateBound(stream, static_cast<unsigned long>(input.size())); // NOLINT(google-runtime-int)
+                output.resize(output_size);
 
-                const auto result = ::compress2(
-                    reinterpret_cast<unsigned char*>(&*output.begin()),
-                    &output_size,
-                    reinterpret_cast<const unsigned char*>(input.data()),
-                    static_cast<unsigned long>(input.size()), // NOLINT(google-runtime-int)
-                    compression_level);
+                stream->next_in = reinterpret_cast<unsigned char*>(const_cast<char*>(input.data()));
+                stream->avail_in = static_cast<unsigned int>(input.size());
+                stream->next_out = reinterpret_cast<unsigned char*>(&*output.begin());
+                stream->avail_out = static_cast<unsigned int>(output_size);
 
-                if (result != Z_OK) {
-                    throw io_error{std::string{"failed to compress data: "} + zError(result)};
+                const auto result = ::deflate(stream, Z_FINISH);
+                if (result != Z_STREAM_END) {
+                    throw io_error{std::string{"failed to compress data: "} + zError(result == Z_OK ? Z_BUF_ERROR : result)};
                 }
 
-                output.resize(output_size);
+                output.resize(stream->total_out);
+            }
 
+            /**
+             * Compress data using zlib.
+             *
+             * Note that this function can not compress data larger than
+             * what fits in an unsigned int.
+             *
+             * @param input Data to compress.
+             * @param compression_level Compression level.
+             * @returns Compressed data.
+             */
+            inline std::string zlib_compress(const std::string& input, int compression_level = Z_DEFAULT_COMPRESSION) {
+                std::string output;
+                zlib_compress(input, output, compression_level);
                 return output;
             }
 
@@ -101,7 +221,7 @@ namespace osmium {
              * Uncompress data using zlib.
              *
              * Note that this function can not uncompress data larger than
-             * what fits in an unsigned long, on Windows this is usually 32bit.
+             * what fits in an unsigned int.
              *
              * @param input Compressed input data.
              * @param raw_size Size of uncompressed data.
@@ -109,16 +229,23 @@ namespace osmium {
              * @returns Pointer and size to incompressed data.
              */
             inline protozero::data_view zlib_uncompress_string(const char* input, unsigned long input_size, unsigned long raw_size, std::string& output) { // NOLINT(google-runtime-int)
+                assert(input_size < std::numeric_limits<unsigned int>::max());
+                assert(raw_size < std::numeric_limits<unsigned int>::max());
                 output.resize(raw_size);
 
-                const auto result = ::uncompress(
-                    reinterpret_cast<unsigned char*>(&*output.begin()),
-                    &raw_size,
-                    reinterpret_cast<const unsigned char*>(input),
-                    input_size);
+                z_stream* stream = zlib_thread_inflate_stream();
+                stream->next_in = reinterpret_cast<unsigned char*>(const_cast<char*>(input));
+                stream->avail_in = static_cast<unsigned int>(input_size);
+                stream->next_out = reinterpret_cast<unsigned char*>(&*output.begin());
+                stream->avail_out = static_cast<unsigned int>(raw_size);
+
+                const auto result = ::inflate(stream, Z_FINISH);
+                if (result != Z_STREAM_END) {
+                    throw io_error{std::string{"failed to uncompress data: "} + zError(result == Z_OK || result == Z_NEED_DICT ? Z_DATA_ERROR : result)};
+                }
 
-                if (result != Z_OK) {
-                    throw io_error{std::string{"failed to uncompress data: "} + zError(result)};
+                if (stream->total_out != raw_size) {
+                    throw io_error{"failed to uncompress data: data size does not match"};
                 }
 
                 return protozero::data_view{output.data(), output.size()};
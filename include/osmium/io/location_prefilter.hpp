@@ -0,0 +1,186 @@
+#ifndef OSMIUM_IO_LOCATION_PREFILTER_HPP
+#define OSMIUM_IO_LOCATION_PREFILTER_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2023 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+#include <osmium/osm/box.hpp>
+#include <osmium/osm/location.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace osmium {
+
+    namespace io {
+
+        /**
+         * A filter on the locations of nodes. Give it to the Reader
+         * constructor to let the parser drop nodes outside a bounding box
+         * or polygon before they are built.
+         *
+         * Nodes are kept if they are inside or on the boundary of the box
+         * or polygon. Deleted nodes (in history files) have no location,
+         * they are always kept. Ways and relations are not filtered.
+         *
+         * The filter is only an optimization: Currently only the PBF and
+         * O5M parsers support it, all other parsers ignore it and return
+         * all nodes. So you still have to check the nodes you get.
+         *
+         * @code
+         * osmium::io::location_prefilter filter{osmium::Box{5.8, 47.2, 15.1, 55.1}};
+         * osmium::io::Reader reader{"input.osm.pbf", filter};
+         * @endcode
+         *
+         * Copies of a location_prefilter are cheap, they share the polygon.
+         */
+        class location_prefilter {
+
+            osmium::Box m_box{};
+            std::shared_ptr<const std::vector<osmium::Location>> m_polygon{};
+
+            // Point in polygon test counting crossings of a ray from the
+            // location to the east with the polygon edges. Points on the
+            // boundary are treated as inside.
+            bool polygon_contains(const osmium::Location& location) const noexcept {
+                const auto& ring = *m_polygon;
+                const int64_t x = location.x();
+                const int64_t y = location.y();
+
+                bool inside = false;
+                for (std::size_t i = 0, j = ring.size() - 1; i < ring.size(); j = i++) {
+                    const int64_t ax = ring[j].x();
+                    const int64_t ay = ring[j].y();
+                    const int64_t bx = ring[i].x();
+                    const int64_t by = ring[i].y();
+
+                    const int64_t cross = (bx - ax) * (y - ay) - (by - ay) * (x - ax);
+                    if (cross == 0 &&
+                        x >= std::min(ax, bx) && x <= std::max(ax, bx) &&
+                        y >= std::min(ay, by) && y <= std::max(ay, by)) {
+                        return true; // on the boundary
+                    }
+
+                    if ((ay > y) != (by > y)) {
+                        // The edge crosses the horizontal line through the
+                        // location. It crosses the ray if the location is
+                        // on the left side of the upward-oriented edge.
+                        if ((by > ay) == (cross > 0)) {
+                            inside = !inside;
+                        }
+                    }
+                }
+                return inside;
+            }
+
+        public:
+
+            /**
+             * Create an empty filter that doesn't drop any nodes.
+             */
+            location_prefilter() = default;
+
+            /**
+             * Create a filter keeping only nodes inside the box.
+             *
+             * @throws std::invalid_argument If the box is not valid.
+             */
+            explicit location_prefilter(const osmium::Box& box) :
+                m_box(box) {
+                if (!box.valid()) {
+                    throw std::invalid_argument{"invalid box for location_prefilter"};
+                }
+            }
+
+            /**
+             * Create a filter keeping only nodes inside the polygon. The
+             * polygon is a simple ring given as a list of locations, the
+             * last location may or may not be the same as the first.
+             *
+             * @throws std::invalid_argument If there are less than three
+             *         locations or if any of them is not valid.
+             */
+            explicit location_prefilter(std::vector<osmium::Location> polygon) {
+                if (polygon.size() > 1 && polygon.front() == polygon.back()) {
+                    polygon.pop_back();
+                }
+                if (polygon.size() < 3) {
+                    throw std::invalid_argument{"polygon for location_prefilter needs at least three locations"};
+                }
+                for (const auto& location : polygon) {
+                    if (!location.valid()) {
+                        throw std::invalid_argument{"invalid location in polygon for location_prefilter"};
+                    }
+                    m_box.extend(location);
+                }
+                m_polygon = std::make_shared<const std::vector<osmium::Location>>(std::move(polygon));
+            }
+
+            /// Is this an empty filter (which doesn't drop anything)?
+            bool empty() const noexcept {
+                return !m_box.valid();
+            }
+
+            /**
+             * The bounding box of the filter. If the filter has a
+             * polygon, this is the bounding box of the polygon.
+             */
+            const osmium::Box& box() const noexcept {
+                return m_box;
+            }
+
+            /**
+             * Should a node with this location be kept?
+             *
+             * @pre Filter must not be empty.
+             */
+            bool contains(const osmium::Location& location) const noexcept {
+                if (!location) {
+                    return true;
+                }
+                if (!m_box.contains(location)) {
+                    return false;
+                }
+                return !m_polygon || polygon_contains(location);
+            }
+
+        }; // class location_prefilter
+
+    } // namespace io
+
+} // namespace osmium
+
+#endif // OSMIUM_IO_LOCATION_PREFILTER_HPP
@@ -0,0 +1,260 @@
+#ifndef OSMIUM_IO_PBF_NODE_LOCATIONS_HPP
+#define OSMIUM_IO_PBF_NODE_LOCATIONS_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2023 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+/**
+ * @file
+ *
+ * Include this file if you want to fill a node location index directly
+ * from a PBF file.
+ *
+ * @attention If you include this file, you'll need to link with
+ *            `libz`, and enable multithreading.
+ */
+
+#include <osmium/index/map.hpp>
+#include <osmium/io/detail/pbf_blob_index.hpp>
+#include <osmium/io/detail/pbf_decoder.hpp>
+#include <osmium/io/detail/read_write.hpp>
+#include <osmium/io/error.hpp>
+#include <osmium/io/file.hpp>
+#include <osmium/io/file_compression.hpp>
+#include <osmium/io/file_format.hpp>
+#include <osmium/io/header.hpp>
+#include <osmium/osm/location.hpp>
+#include <osmium/osm/types.hpp>
+#include <osmium/thread/ordered_results.hpp>
+#include <osmium/thread/pool.hpp>
+#include <osmium/util/config.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace osmium {
+
+    namespace io {
+
+        namespace detail {
+
+            /**
+             * Read the next blob from the file. Returns false on EOF.
+             *
+             * @throws osmium::pbf_error If the file is not a valid PBF file.
+             */
+            inline bool read_pbf_blob(int fd, std::string& type, std::string& blob) {
+                std::array<char, sizeof(uint32_t)> size_data{};
+                if (!read_exactly(fd, size_data.data(), static_cast<unsigned int>(size_data.size()))) {
+                    return false;
+                }
+                const auto* d = reinterpret_cast<const unsigned char*>(size_data.data());
+                const uint32_t header_size = (static_cast<uint32_t>(d[0]) << 24U) |
+                                             (static_cast<uint32_t>(d[1]) << 16U) |
+                                             (static_cast<uint32_t>(d[2]) <<  8U) |
+                                              static_cast<uint32_t>(d[3]);
+                if (header_size == 0 || header_size > static_cast<uint32_t>(max_blob_header_size)) {
+                    throw osmium::pbf_error{"invalid BlobHeader size (> max_blob_header_size)"};
+                }
+
+                std::string blob_header(header_size, '\0');
+                if (!read_exactly(fd, &*blob_header.begin(), header_size)) {
+                    throw osmium::pbf_error{"unexpected EOF"};
+                }
+
+                const auto type_and_size = decode_blob_header_type_and_size(protozero::data_view{blob_header.data(), blob_header.size()});
+                if (type_and_size.second > max_uncompressed_blob_size) {
+                    throw osmium::pbf_error{std::string{"invalid blob size: "} +
+                                            std::to_string(type_and_size.second)};
+                }
+                type.assign(type_and_size.first.data(), type_and_size.first.size());
+
+                blob.resize(type_and_size.second);
+                if (!read_exactly(fd, &*blob.begin(), static_cast<unsigned int>(blob.size()))) {
+                    throw osmium::pbf_error{"unexpected EOF"};
+                }
+
+                return true;
+            }
+
+        } // namespace detail
+
+        /**
+         * Read the ids and locations of all nodes in a PBF file and call
+         * func(id, location) for each of them in the order they appear in
+         * the file. This is much faster than reading the file through an
+         * osmium::io::Reader, because no Node objects are created, tags
+         * and metadata are skipped, and, if the file is sorted, the blobs
+         * after the nodes are not even decompressed.
+         *
+         * The blobs are decoded in the threads of the thread pool, func
+         * is always called in the calling thread.
+         *
+         * @param file The input file. Must be a PBF file on disk (or
+         *             stdin), not a buffer and not compressed as a
+         *             whole (like .osm.pbf.gz).
+         * @param func Function called with an osmium::object_id_type and
+         *             an osmium::Location for each node.
+         * @param pool The thread pool to use.
+         * @throws std::invalid_argument If the file is not a PBF file.
+         * @throws osmium::pbf_error If the file is not a valid PBF file.
+         * @throws std::system_error If the file could not be read.
+         */
+        template <typename TFunction>
+        inline void for_each_pbf_node_location(const osmium::io::File& file, TFunction&& func, osmium::thread::Pool& pool = osmium::thread::Pool::default_instance()) {
+            if (file.buffer() || file.format() != osmium::io::file_format::pbf || file.compression() != osmium::io::file_compression::none) {
+                throw std::invalid_argument{"for_each_pbf_node_location() only works on PBF files on disk"};
+            }
+
+            const detail::pbf_shared_fd fd{detail::open_for_reading(file.filename())};
+
+            std::string type;
+            std::string blob;
+            if (!detail::read_pbf_blob(fd.fd(), type, blob) || type != "OSMHeader") {
+                throw osmium::pbf_error{"blob does not have expected type (OSMHeader in first blob, OSMData in following blobs)"};
+            }
+            const osmium::io::Header header{detail::decode_header(blob)};
+
+            // In a sorted file there are no more nodes after the first
+            // block with other entities in it.
+            const bool sorted = header.get("sorting") == "Type_then_ID";
+            bool done = false;
+
+            const bool use_pool = osmium::config::use_pool_threads_for_pbf_parsing();
+
+            const auto process = [&](detail::pbf_node_locations&& result) {
+                for (const auto& location : result.locations) {
+                    func(location.first, location.second);
+                }
+                if (sorted && result.other_entities) {
+                    done = true;
+                }
+            };
+
+            osmium::thread::OrderedResults<detail::pbf_node_locations> results{pool, osmium::thread::task_priority::high};
+            while (!done && detail::read_pbf_blob(fd.fd(), type, blob)) {
+                if (type != "OSMData") {
+                    throw osmium::pbf_error{"blob does not have expected type (OSMHeader in first blob, OSMData in following blobs)"};
+                }
+                detail::PBFNodeLocationsBlobDecoder decoder{std::move(blob)};
+                blob = std::string{};
+                if (use_pool) {
+                    results.submit(std::move(decoder), process);
+                } else {
+                    process(decoder());
+                }
+            }
+            results.output_all(process);
+        }
+
+        /**
+         * Read the locations of all nodes in a PBF file into node location
+         * indexes. The result is the same as when reading all nodes from
+         * the file and feeding them into the
+         * osmium::handler::NodeLocationsForWays handler, but it is much
+         * faster. See for_each_pbf_node_location() for details.
+         *
+         * If the nodes in the file are not ordered by id, sort() is
+         * called on the indexes at the end.
+         *
+         * @param file The input file. See for_each_pbf_node_location().
+         * @param storage_pos Index for nodes with positive ids.
+         * @param storage_neg Index for nodes with negative ids.
+         * @param pool The thread pool to use.
+         * @throws std::invalid_argument If the file is not a PBF file.
+         * @throws osmium::pbf_error If the file is not a valid PBF file.
+         * @throws std::system_error If the file could not be read.
+         */
+        inline void read_pbf_node_locations(const osmium::io::File& file,
+                                            osmium::index::map::Map<osmium::unsigned_object_id_type, osmium::Location>& storage_pos,
+                                            osmium::index::map::Map<osmium::unsigned_object_id_type, osmium::Location>& storage_neg,
+                                            osmium::thread::Pool& pool = osmium::thread::Pool::default_instance()) {
+            osmium::unsigned_object_id_type last_id = 0;
+            bool must_sort = false;
+
+            for_each_pbf_node_location(file, [&](const osmium::object_id_type id, const osmium::Location location) {
+                const auto positive_id = static_cast<osmium::unsigned_object_id_type>(id < 0 ? -id : id);
+                if (positive_id < last_id) {
+                    must_sort = true;
+                }
+                last_id = positive_id;
+
+                if (id >= 0) {
+                    storage_pos.set(positive_id, location);
+                } else {
+                    storage_neg.set(positive_id, location);
+                }
+            }, pool);
+
+            if (must_sort) {
+                storage_pos.sort();
+                storage_neg.sort();
+            }
+        }
+
+        /**
+         * Read the locations of all nodes with positive ids in a PBF file
+         * into a node location index. Nodes with negative ids are ignored.
+         * See the other overload of this function for details.
+         */
+        inline void read_pbf_node_locations(const osmium::io::File& file,
+                                            osmium::index::map::Map<osmium::unsigned_object_id_type, osmium::Location>& storage_pos,
+                                            osmium::thread::Pool& pool = osmium::thread::Pool::default_instance()) {
+            osmium::unsigned_object_id_type last_id = 0;
+            bool must_sort = false;
+
+            for_each_pbf_node_location(file, [&](const osmium::object_id_type id, const osmium::Location location) {
+                if (id < 0) {
+                    return;
+                }
+                const auto positive_id = static_cast<osmium::unsigned_object_id_type>(id);
+                if (positive_id < last_id) {
+                    must_sort = true;
+                }
+                last_id = positive_id;
+                storage_pos.set(positive_id, location);
+            }, pool);
+
+            if (must_sort) {
+                storage_pos.sort();
+            }
+        }
+
+    } // namespace io
+
+} // namespace osmium
+
+#endif // OSMIUM_IO_PBF_NODE_LOCATIONS_HPP
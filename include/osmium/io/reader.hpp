@@ -41,7 +41,10 @@ DEALINGS IN THE SOFTWARE.
 #include <osmium/io/error.hpp>
 #include <osmium/io/file.hpp>
 #include <osmium/io/header.hpp>
+#include <osmium/io/location_prefilter.hpp>
+#include <osmium/io/tags_prefilter.hpp>
 #include <osmium/memory/buffer.hpp>
+#include <osmium/memory/buffer_pool.hpp>
 #include <osmium/osm/entity_bits.hpp>
 #include <osmium/thread/pool.hpp>
 #include <osmium/thread/util.hpp>
@@ -50,6 +53,7 @@ DEALINGS IN THE SOFTWARE.
 #include <cerrno>
 #include <cstdlib>
 #include <fcntl.h>
+#include <functional>
 #include <future>
 #include <memory>
 #include <string>
@@ -132,6 +136,9 @@ namespace osmium {
             osmium::osm_entity_bits::type m_read_which_entities = osmium::osm_entity_bits::all;
             osmium::io::read_meta m_read_metadata = osmium::io::read_meta::yes;
             osmium::io::buffers_type m_buffers_kind = osmium::io::buffers_type::any;
+            osmium::io::tags_prefilter m_tags_filter{};
+            osmium::io::location_prefilter m_location_filter{};
+            osmium::memory::BufferPool* m_buffer_pool = nullptr;
 
             void set_option(osmium::thread::Pool& pool) noexcept {
                 m_pool = &pool;
@@ -154,6 +161,18 @@ namespace osmium {
                 m_buffers_kind = value;
             }
 
+            void set_option(const osmium::io::tags_prefilter& value) noexcept {
+                m_tags_filter = value;
+            }
+
+            void set_option(const osmium::io::location_prefilter& value) noexcept {
+                m_location_filter = value;
+            }
+
+            void set_option(osmium::memory::BufferPool& buffer_pool) noexcept {
+                m_buffer_pool = &buffer_pool;
+            }
+
             // This function will run in a separate thread.
             static void parser_thread(osmium::thread::Pool& pool,
                                       int fd,
@@ -165,7 +184,11 @@ namespace osmium {
                                       osmium::osm_entity_bits::type read_which_entities,
                                       osmium::io::read_meta read_metadata,
                                       osmium::io::buffers_type buffers_kind,
-                                      bool want_buffered_pages_removed) {
+                                      bool want_buffered_pages_removed,
+                                      const osmium::io::File& file,
+                                      const osmium::io::tags_prefilter& tags_filter,
+                                      const osmium::io::location_prefilter& location_filter,
+                                      osmium::memory::BufferPool* buffer_pool) {
                 std::promise<osmium::io::Header> promise{std::move(header_promise)};
                 osmium::io::detail::parser_arguments args = {
                     pool,
@@ -177,7 +200,11 @@ namespace osmium {
                     read_which_entities,
                     read_metadata,
                     buffers_kind,
-                    want_buffered_pages_removed};
+                    want_buffered_pages_removed,
+                    file,
+                    tags_filter,
+                    location_filter,
+                    buffer_pool};
                 creator(args)->parse();
             }
 
@@ -305,6 +332,24 @@ namespace osmium {
              *      use in "single" mode if the input file is not sorted by
              *      type, otherwise this will be rather inefficient.
              *
+             * * osmium::io::tags_prefilter: Drop objects without any tags
+             *      matching the filter before they are built. Only some
+             *      file formats (currently PBF) use this setting, so you
+             *      still have to check the objects you get.
+             *
+             * * osmium::io::location_prefilter: Drop nodes outside a box
+             *      or polygon before they are built. Only some file
+             *      formats (currently PBF and O5M) use this setting, so
+             *      you still have to check the nodes you get.
+             *
+             * * osmium::memory::BufferPool&: Reference to a pool of buffer
+             *      memory. The buffers returned by read() are created from
+             *      this pool and, if the file is large enough, pre-sized to
+             *      hold the decoded data. Give them back with
+             *      BufferPool::put() after use so their memory is recycled.
+             *      The pool must outlive the Reader. Only some file formats
+             *      (currently PBF) use this setting.
+             *
              * * osmium::thread::Pool&: Reference to a thread pool that should
              *      be used for reading instead of the default pool. Usually
              *      it is okay to use the statically initialized shared
@@ -346,7 +391,9 @@ namespace osmium {
                                                           std::ref(m_input_queue), std::ref(m_osmdata_queue),
                                                           std::move(header_promise), &m_offset, m_read_which_entities,
                                                           m_read_metadata, m_buffers_kind,
-                                                          m_decompressor->want_buffered_pages_removed()};
+                                                          m_decompressor->want_buffered_pages_removed(),
+                                                          std::cref(m_file), std::cref(m_tags_filter),
+                                                          std::cref(m_location_filter), m_buffer_pool};
             }
 
             template <typename... TArgs>
@@ -0,0 +1,125 @@
+#ifndef OSMIUM_IO_TAGS_PREFILTER_HPP
+#define OSMIUM_IO_TAGS_PREFILTER_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2023 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+#include <osmium/osm/entity_bits.hpp>
+
+#include <functional>
+#include <memory>
+#include <utility>
+
+namespace osmium {
+
+    namespace io {
+
+        /**
+         * A filter on the tags of OSM objects. Give it to the Reader
+         * constructor to let the parser drop objects that don't have any
+         * matching tags before they are built. This saves a lot of work
+         * and memory if you only need a small part of the objects.
+         *
+         * The filter is a predicate called with the key and value of a
+         * tag as C strings. An object is kept if the predicate returns
+         * true for at least one of its tags, objects without tags are
+         * dropped. Objects of entity types not in the entities given to
+         * the constructor are never dropped.
+         *
+         * The filter is only an optimization: Currently only the PBF
+         * parser supports it, all other parsers ignore it and return all
+         * objects. So you still have to check the objects you get.
+         *
+         * @code
+         * osmium::io::tags_prefilter filter{osmium::TagMatcher{"amenity"},
+         *                                   osmium::osm_entity_bits::node};
+         * osmium::io::Reader reader{"input.osm.pbf", filter};
+         * @endcode
+         *
+         * Copies of a tags_prefilter are cheap, they share the predicate.
+         */
+        class tags_prefilter {
+
+        public:
+
+            using predicate_type = std::function<bool(const char* key, const char* value)>;
+
+        private:
+
+            std::shared_ptr<const predicate_type> m_predicate{};
+            osmium::osm_entity_bits::type m_entities = osmium::osm_entity_bits::nothing;
+
+        public:
+
+            /**
+             * Create an empty filter that doesn't drop any objects.
+             */
+            tags_prefilter() = default;
+
+            /**
+             * Create a filter.
+             *
+             * @param predicate Function called with key and value of tags.
+             *                  Can be called from several threads at the
+             *                  same time.
+             * @param entities Only objects of these types are filtered.
+             */
+            explicit tags_prefilter(predicate_type predicate, osmium::osm_entity_bits::type entities = osmium::osm_entity_bits::nwr) :
+                m_predicate(std::make_shared<const predicate_type>(std::move(predicate))),
+                m_entities(entities) {
+            }
+
+            /// Is this an empty filter (which doesn't drop anything)?
+            bool empty() const noexcept {
+                return !m_predicate;
+            }
+
+            /// The entity types this filter is used for.
+            osmium::osm_entity_bits::type entities() const noexcept {
+                return m_predicate ? m_entities : osmium::osm_entity_bits::nothing;
+            }
+
+            /**
+             * Call the predicate.
+             *
+             * @pre Filter must not be empty.
+             */
+            bool operator()(const char* key, const char* value) const {
+                return (*m_predicate)(key, value);
+            }
+
+        }; // class tags_prefilter
+
+    } // namespace io
+
+} // namespace osmium
+
+#endif // OSMIUM_IO_TAGS_PREFILTER_HPP
@@ -68,6 +68,8 @@ namespace osmium {
      */
     namespace memory {
 
+        class BufferPool;
+
         /**
          * A memory area for storing OSM objects and other items. Each item stored
          * has a type and a length. See the Item class for details.
@@ -103,6 +105,8 @@ namespace osmium {
 
         private:
 
+            friend class BufferPool;
+
             std::unique_ptr<Buffer> m_next_buffer;
             std::unique_ptr<unsigned char[]> m_memory{};
             unsigned char* m_data = nullptr;
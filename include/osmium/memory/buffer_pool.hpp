@@ -0,0 +1,203 @@
+#ifndef OSMIUM_MEMORY_BUFFER_POOL_HPP
+#define OSMIUM_MEMORY_BUFFER_POOL_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2023 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <osmium/memory/buffer.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace osmium {
+
+    namespace memory {
+
+        /**
+         * A pool of memory for reuse in osmium::memory::Buffer objects.
+         *
+         * Programs reading large files create and destroy a lot of buffers,
+         * each of them often several MBytes large. Getting this memory from
+         * the system and giving it back over and over again is expensive.
+         * Buffers can be given back to the pool with put() once they are not
+         * needed any more and the memory will then be used for the next
+         * buffers created with get().
+         *
+         * All functions of this class are thread safe. The pool must outlive
+         * all uses of it, it does not have to outlive the buffers created
+         * from it.
+         *
+         * Example:
+         * @code
+         *     osmium::memory::BufferPool pool;
+         *     osmium::io::Reader reader{"input.osm.pbf", pool};
+         *     while (osmium::memory::Buffer buffer = reader.read()) {
+         *         ...handle buffer...
+         *         pool.put(std::move(buffer));
+         *     }
+         * @endcode
+         */
+        class BufferPool {
+
+            struct memory_block {
+                std::unique_ptr<unsigned char[]> memory;
+                std::size_t capacity;
+            }; // struct memory_block
+
+            enum {
+                default_max_blocks = 64
+            };
+
+            mutable std::mutex m_mutex;
+            std::vector<memory_block> m_blocks;
+            std::size_t m_max_blocks;
+
+            void add_block(std::unique_ptr<unsigned char[]>&& memory, std::size_t capacity) {
+                if (!memory || m_max_blocks == 0) {
+                    return;
+                }
+
+                // If the pool is full, the smallest block is released.
+                if (m_blocks.size() == m_max_blocks) {
+                    const auto smallest = std::min_element(m_blocks.begin(), m_blocks.end(), [](const memory_block& a, const memory_block& b) {
+                        return a.capacity < b.capacity;
+                    });
+                    if (smallest->capacity >= capacity) {
+                        return;
+                    }
+                    *smallest = memory_block{std::move(memory), capacity};
+                    return;
+                }
+
+                m_blocks.push_back(memory_block{std::move(memory), capacity});
+            }
+
+        public:
+
+            /**
+             * Create an empty pool.
+             *
+             * @param max_blocks The maximum number of memory blocks kept in
+             *                   the pool. If more buffers are given back,
+             *                   the smallest blocks are released.
+             */
+            explicit BufferPool(std::size_t max_blocks = default_max_blocks) :
+                m_max_blocks(max_blocks) {
+                m_blocks.reserve(max_blocks);
+            }
+
+            /**
+             * Get an empty buffer with internal memory management and at
+             * least the given capacity. If there is a block of memory in the
+             * pool which is large enough, it is used, otherwise new memory
+             * is allocated. If there are several blocks of memory that are
+             * large enough, the smallest of them is used.
+             *
+             * @param capacity The minimum capacity of the buffer.
+             * @param auto_grow Should this buffer automatically grow when it
+             *        becomes to small?
+             */
+            Buffer get(std::size_t capacity, Buffer::auto_grow auto_grow = Buffer::auto_grow::yes) {
+                capacity = Buffer::calculate_capacity(capacity);
+
+                memory_block block{nullptr, 0};
+                {
+                    const std::lock_guard<std::mutex> lock{m_mutex};
+                    auto best = m_blocks.end();
+                    for (auto it = m_blocks.begin(); it != m_blocks.end(); ++it) {
+                        if (it->capacity >= capacity && (best == m_blocks.end() || it->capacity < best->capacity)) {
+                            best = it;
+                        }
+                    }
+                    if (best != m_blocks.end()) {
+                        block = std::move(*best);
+                        *best = std::move(m_blocks.back());
+                        m_blocks.pop_back();
+                    }
+                }
+
+                if (!block.memory) {
+                    return Buffer{capacity, auto_grow};
+                }
+
+                Buffer buffer{std::move(block.memory), block.capacity, 0};
+                buffer.m_auto_grow = auto_grow;
+                return buffer;
+            }
+
+            /**
+             * Give the memory of a buffer back to the pool. This includes
+             * the memory of all nested buffers. Buffers with external memory
+             * management and invalid buffers are ignored.
+             *
+             * After this call the buffer is invalid.
+             */
+            void put(Buffer&& buffer) {
+                Buffer local{std::move(buffer)};
+
+                const std::lock_guard<std::mutex> lock{m_mutex};
+                std::unique_ptr<Buffer> next{std::move(local.m_next_buffer)};
+                add_block(std::move(local.m_memory), local.m_capacity);
+                while (next) {
+                    std::unique_ptr<Buffer> nested{std::move(next)};
+                    next = std::move(nested->m_next_buffer);
+                    add_block(std::move(nested->m_memory), nested->m_capacity);
+                }
+            }
+
+            /**
+             * The number of memory blocks currently in the pool.
+             */
+            std::size_t size() const {
+                const std::lock_guard<std::mutex> lock{m_mutex};
+                return m_blocks.size();
+            }
+
+            /**
+             * Release all memory in the pool.
+             */
+            void clear() {
+                const std::lock_guard<std::mutex> lock{m_mutex};
+                m_blocks.clear();
+            }
+
+        }; // class BufferPool
+
+    } // namespace memory
+
+} // namespace osmium
+
+#endif // OSMIUM_MEMORY_BUFFER_POOL_HPP
@@ -0,0 +1,208 @@
+#ifndef OSMIUM_PARALLEL_VISITOR_HPP
+#define OSMIUM_PARALLEL_VISITOR_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2023 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <osmium/memory/buffer.hpp>
+#include <osmium/thread/ordered_results.hpp>
+#include <osmium/thread/pool.hpp>
+#include <osmium/visitor.hpp>
+
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace osmium {
+
+    namespace detail {
+
+        /**
+         * Keeps the handler instances used by apply_parallel(). A task
+         * takes an unused instance (creating a new one if there is none)
+         * and gives it back when it is done. So there are never more
+         * instances than tasks running at the same time and each instance
+         * is only used by one thread at a time.
+         */
+        template <typename THandler>
+        class parallel_handler_instances {
+
+            std::mutex m_mutex;
+            std::vector<std::unique_ptr<THandler>> m_instances;
+            std::vector<THandler*> m_unused;
+
+        public:
+
+            template <typename THandlerFactory>
+            THandler* acquire(THandlerFactory& factory) {
+                const std::lock_guard<std::mutex> lock{m_mutex};
+                if (m_unused.empty()) {
+                    m_instances.emplace_back(new THandler(factory()));
+                    return m_instances.back().get();
+                }
+                THandler* handler = m_unused.back();
+                m_unused.pop_back();
+                return handler;
+            }
+
+            void release(THandler* handler) {
+                const std::lock_guard<std::mutex> lock{m_mutex};
+                m_unused.push_back(handler);
+            }
+
+            /// All instances in the order they were created in.
+            std::vector<std::unique_ptr<THandler>>& instances() noexcept {
+                return m_instances;
+            }
+
+        }; // class parallel_handler_instances
+
+        template <typename THandler, typename THandlerFactory>
+        class parallel_apply_task {
+
+            parallel_handler_instances<THandler>* m_instances;
+            THandlerFactory* m_factory;
+            osmium::memory::Buffer m_buffer;
+
+        public:
+
+            parallel_apply_task(parallel_handler_instances<THandler>& instances, THandlerFactory& factory, osmium::memory::Buffer&& buffer) :
+                m_instances(&instances),
+                m_factory(&factory),
+                m_buffer(std::move(buffer)) {
+            }
+
+            osmium::memory::Buffer operator()() {
+                THandler* handler = m_instances->acquire(*m_factory);
+                try {
+                    for (auto& item : m_buffer) {
+                        osmium::apply_item(item, *handler);
+                    }
+                } catch (...) {
+                    m_instances->release(handler);
+                    throw;
+                }
+                m_instances->release(handler);
+                return std::move(m_buffer);
+            }
+
+        }; // class parallel_apply_task
+
+        template <typename TSource, typename THandlerFactory, typename TMerge, typename TOutput>
+        inline void apply_parallel_impl(TSource& source, osmium::thread::Pool& pool, THandlerFactory&& factory, TMerge&& merge, TOutput&& output) {
+            using handler_type = typename std::decay<decltype(factory())>::type;
+            using task_type = parallel_apply_task<handler_type, typename std::remove_reference<THandlerFactory>::type>;
+
+            parallel_handler_instances<handler_type> instances;
+
+            {
+                // The tasks still running use the handler instances, so
+                // this must be destructed (which waits for them) before
+                // the instances, also if there is an exception.
+                osmium::thread::OrderedResults<osmium::memory::Buffer> results{pool};
+                while (osmium::memory::Buffer buffer = source.read()) {
+                    results.submit(task_type{instances, factory, std::move(buffer)}, output);
+                }
+                results.output_all(output);
+            }
+
+            for (auto& handler : instances.instances()) {
+                handler->flush();
+                merge(*handler);
+            }
+        }
+
+    } // namespace detail
+
+    /**
+     * Read all buffers from the source (usually an osmium::io::Reader)
+     * and apply a handler to them in the threads of the thread pool.
+     *
+     * Handlers are not shared between threads. Instead a new handler is
+     * created by calling factory() whenever a pool thread needs one and
+     * all unused handlers are busy in other threads. So you will get at
+     * most as many handlers as there are pool threads plus one (the
+     * calling thread can help out running tasks). Each handler will see
+     * some of the objects in no particular order.
+     *
+     * After all buffers are processed, flush() is called on all handlers
+     * and then, in the calling thread, merge(handler) is called for each
+     * of them in the order they were created. Use this to collect the
+     * results of the handlers.
+     *
+     * This only makes sense for handlers which can work on each object
+     * independently of other objects, like a tag filter or a geometry
+     * builder for nodes.
+     *
+     * @param source Source of buffers. Must have a read() function
+     *               returning an osmium::memory::Buffer which is invalid
+     *               at the end of the data.
+     * @param factory Function returning a new handler.
+     * @param merge Function called with each handler at the end.
+     * @param pool The thread pool to use.
+     * @throws Any exception thrown by the source, the handlers, or the
+     *         merge function.
+     */
+    template <typename TSource, typename THandlerFactory, typename TMerge>
+    inline void apply_parallel(TSource& source, THandlerFactory&& factory, TMerge&& merge, osmium::thread::Pool& pool = osmium::thread::Pool::default_instance()) {
+        detail::apply_parallel_impl(source, pool, std::forward<THandlerFactory>(factory), std::forward<TMerge>(merge), [](osmium::memory::Buffer&& /*buffer*/) {});
+    }
+
+    /**
+     * Like apply_parallel(), but additionally calls output(buffer) in the
+     * calling thread for each buffer after the handler was applied to it
+     * and in the same order the buffers were read from the source. Use
+     * this to write the (possibly changed) buffers to an
+     * osmium::io::Writer for instance. Handlers can mark objects they want
+     * to filter out as removed (with set_removed(true)) and the output
+     * function can then call purge_removed() on the buffer.
+     *
+     * @param source Source of buffers. Must have a read() function
+     *               returning an osmium::memory::Buffer which is invalid
+     *               at the end of the data.
+     * @param factory Function returning a new handler.
+     * @param merge Function called with each handler at the end.
+     * @param output Function called with each buffer in input order.
+     * @param pool The thread pool to use.
+     * @throws Any exception thrown by the source, the handlers, or the
+     *         merge or output functions.
+     */
+    template <typename TSource, typename THandlerFactory, typename TMerge, typename TOutput>
+    inline void apply_parallel_ordered(TSource& source, THandlerFactory&& factory, TMerge&& merge, TOutput&& output, osmium::thread::Pool& pool = osmium::thread::Pool::default_instance()) {
+        detail::apply_parallel_impl(source, pool, std::forward<THandlerFactory>(factory), std::forward<TMerge>(merge), std::forward<TOutput>(output));
+    }
+
+} // namespace osmium
+
+#endif // OSMIUM_PARALLEL_VISITOR_HPP
@@ -132,6 +132,24 @@ namespace osmium {
             return m_default_result;
         }
 
+        /**
+         * Matching function. Check the specified key and value against
+         * the rules.
+         *
+         * @param key The key of a tag.
+         * @param value The value of a tag.
+         * @returns The result of the matching rule, or, if none of the rules
+         *          matched, the default result.
+         */
+        TResult operator()(const char* key, const char* value) const noexcept {
+            for (const auto& rule : m_rules) {
+                if (rule.second(key, value)) {
+                    return rule.first;
+                }
+            }
+            return m_default_result;
+        }
+
         /**
          * Return the number of rules in this filter.
          *
@@ -0,0 +1,436 @@
+#ifndef OSMIUM_THREAD_BOUNDED_QUEUE_HPP
+#define OSMIUM_THREAD_BOUNDED_QUEUE_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2023 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+#ifdef OSMIUM_DEBUG_QUEUE_SIZE
+# include <iostream>
+#endif
+
+namespace osmium {
+
+    namespace thread {
+
+        /**
+         * A thread-safe bounded queue with the same interface as Queue.
+         *
+         * This is a ring buffer based multi-producer multi-consumer queue
+         * (after Dmitry Vyukov's design). Pushing and popping don't need
+         * a lock as long as the queue isn't full (for push) or empty (for
+         * pop). Only if a thread has to wait, it will spin for a while
+         * and then block on a condition variable. A waiting thread is
+         * woken up as soon as there is space or data available.
+         *
+         * The maximum size is rounded up to the next power of two. If no
+         * maximum size is given, the queue is unbounded like Queue: If the
+         * ring buffer is full, elements are appended to an overflow list
+         * protected by the mutex until the consumers have caught up.
+         */
+        template <typename T>
+        class BoundedQueue {
+
+            enum : std::size_t {
+                /// Size of the ring buffer if no maximum size is given.
+                default_ring_size = 1024,
+
+                /// Number of times a waiting thread spins before blocking.
+                spin_count = 64,
+
+                cache_line_size = 64
+            };
+
+            struct cell {
+                std::atomic<std::size_t> sequence;
+                T data;
+            };
+
+            static std::size_t round_up_to_power_of_two(std::size_t value) noexcept {
+                std::size_t capacity = 2;
+                while (capacity < value) {
+                    capacity <<= 1U;
+                }
+                return capacity;
+            }
+
+            /// Maximum size of this queue as given in the constructor.
+            const std::size_t m_max_size;
+
+            /// Name of this queue (for debugging only).
+            const std::string m_name;
+
+            const std::size_t m_mask;
+
+            std::unique_ptr<cell[]> m_buffer;
+
+            // The positions are on their own cache lines, so that
+            // producers and consumers don't get in each others way.
+            char m_pad0[cache_line_size]{};
+            std::atomic<std::size_t> m_enqueue_pos{0};
+            char m_pad1[cache_line_size - sizeof(std::atomic<std::size_t>)]{};
+            std::atomic<std::size_t> m_dequeue_pos{0};
+            char m_pad2[cache_line_size - sizeof(std::atomic<std::size_t>)]{};
+
+            // Used for blocking and for the overflow list.
+            std::mutex m_mutex;
+
+            /// Elements that didn't fit into the ring buffer of an
+            /// unbounded queue. Newer than all elements in the ring buffer.
+            std::deque<T> m_overflow;
+
+            /// Size of m_overflow, can be read without the mutex.
+            std::atomic<std::size_t> m_overflow_size{0};
+
+            /// Used to signal consumers when data is available in the queue.
+            std::condition_variable m_data_available;
+
+            /// Used to signal producers when queue is not full.
+            std::condition_variable m_space_available;
+
+            std::atomic<int> m_waiting_consumers{0};
+            std::atomic<int> m_waiting_producers{0};
+
+            std::atomic<bool> m_in_use{true};
+
+#ifdef OSMIUM_DEBUG_QUEUE_SIZE
+            /// The largest size the queue has been so far.
+            std::atomic<std::size_t> m_largest_size{0};
+
+            /// The number of times push() was called on the queue.
+            std::atomic<int> m_push_counter{0};
+
+            /// The number of times the queue was full and a thread pushing
+            /// to the queue was blocked.
+            std::atomic<int> m_full_counter{0};
+
+            /**
+             * The number of times wait_and_pop(with_timeout)() was called
+             * on the queue.
+             */
+            std::atomic<int> m_pop_counter{0};
+
+            /// The number of times the queue was full and a thread pushing
+            /// to the queue was blocked.
+            std::atomic<int> m_empty_counter{0};
+
+            void update_largest_size() noexcept {
+                const auto current_size = size();
+                auto largest_size = m_largest_size.load(std::memory_order_relaxed);
+                while (largest_size < current_size &&
+                       !m_largest_size.compare_exchange_weak(largest_size, current_size, std::memory_order_relaxed)) {
+                }
+            }
+#endif
+
+            bool try_push(T& value) {
+                std::size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+                cell* c = nullptr;
+                while (true) {
+                    c = &m_buffer[pos & m_mask];
+                    const std::size_t seq = c->sequence.load(std::memory_order_acquire);
+                    const auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+                    if (diff == 0) {
+                        if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                            break;
+                        }
+                    } else if (diff < 0) {
+                        return false; // full
+                    } else {
+                        pos = m_enqueue_pos.load(std::memory_order_relaxed);
+                    }
+                }
+                c->data = std::move(value);
+                c->sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+
+            bool try_pop_impl(T& value) {
+                std::size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+                cell* c = nullptr;
+                while (true) {
+                    c = &m_buffer[pos & m_mask];
+                    const std::size_t seq = c->sequence.load(std::memory_order_acquire);
+                    const auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos + 1);
+                    if (diff == 0) {
+                        if (m_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                            break;
+                        }
+                    } else if (diff < 0) {
+                        return false; // empty
+                    } else {
+                        pos = m_dequeue_pos.load(std::memory_order_relaxed);
+                    }
+                }
+                value = std::move(c->data);
+                c->data = T{}; // release resources held by the element now
+                c->sequence.store(pos + m_mask + 1, std::memory_order_release);
+                return true;
+            }
+
+            // Wake up a thread waiting on the condition variable. The
+            // fence pairs with the one in wait_for(). Either the waiting
+            // thread sees the change to the queue or we see the waiting
+            // thread.
+            static void wake_up(std::atomic<int>& waiting, std::mutex& mutex, std::condition_variable& cv) {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (waiting.load(std::memory_order_relaxed) > 0) {
+                    const std::lock_guard<std::mutex> lock{mutex};
+                    cv.notify_all();
+                }
+            }
+
+            template <typename TPredicate>
+            void wait_for(std::atomic<int>& waiting, std::condition_variable& cv, TPredicate&& ready) {
+                for (std::size_t i = 0; i < spin_count; ++i) {
+                    if (ready()) {
+                        return;
+                    }
+                    std::this_thread::yield();
+                }
+
+                std::unique_lock<std::mutex> lock{m_mutex};
+                waiting.fetch_add(1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                cv.wait(lock, ready);
+                waiting.fetch_sub(1, std::memory_order_relaxed);
+            }
+
+            // Push into an unbounded queue. Elements only go into the ring
+            // buffer if there is nothing in the overflow list, otherwise
+            // they would overtake older elements.
+            void push_unbounded(T& value) {
+                if (m_overflow_size.load(std::memory_order_acquire) == 0 && try_push(value)) {
+                    return;
+                }
+                const std::lock_guard<std::mutex> lock{m_mutex};
+                if (m_overflow.empty() && try_push(value)) {
+                    return;
+                }
+                m_overflow.push_back(std::move(value));
+                m_overflow_size.store(m_overflow.size(), std::memory_order_release);
+            }
+
+            // Pop from the ring buffer or, if that is empty, from the
+            // overflow list.
+            bool try_pop_any(T& value) {
+                if (try_pop_impl(value)) {
+                    return true;
+                }
+                if (m_overflow_size.load(std::memory_order_acquire) == 0) {
+                    return false;
+                }
+                const std::lock_guard<std::mutex> lock{m_mutex};
+                if (m_overflow.empty()) {
+                    return false;
+                }
+                value = std::move(m_overflow.front());
+                m_overflow.pop_front();
+                m_overflow_size.store(m_overflow.size(), std::memory_order_release);
+                return true;
+            }
+
+            std::size_t ring_size() const noexcept {
+                const std::size_t dequeue_pos = m_dequeue_pos.load(std::memory_order_relaxed);
+                const std::size_t enqueue_pos = m_enqueue_pos.load(std::memory_order_relaxed);
+                return enqueue_pos > dequeue_pos ? enqueue_pos - dequeue_pos : 0;
+            }
+
+            bool full() const noexcept {
+                return ring_size() > m_mask;
+            }
+
+        public:
+
+            /**
+             * Construct a multithreaded queue.
+             *
+             * @param max_size Maximum number of elements in the queue. Set to
+             *                 0 for an unlimited size.
+             * @param name Optional name for this queue. (Used for debugging.)
+             */
+            explicit BoundedQueue(std::size_t max_size = 0, std::string name = "") :
+                m_max_size(max_size),
+                m_name(std::move(name)),
+                m_mask(round_up_to_power_of_two(max_size == 0 ? static_cast<std::size_t>(default_ring_size) : max_size) - 1),
+                m_buffer(new cell[m_mask + 1]) {
+                for (std::size_t i = 0; i <= m_mask; ++i) {
+                    m_buffer[i].sequence.store(i, std::memory_order_relaxed);
+                }
+            }
+
+            BoundedQueue(const BoundedQueue&) = delete;
+            BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+            BoundedQueue(BoundedQueue&&) = delete;
+            BoundedQueue& operator=(BoundedQueue&&) = delete;
+
+#ifdef OSMIUM_DEBUG_QUEUE_SIZE
+            ~BoundedQueue() {
+                std::cerr << "queue '" << m_name
+                          << "' with max_size=" << m_max_size
+                          << " had largest size " << m_largest_size
+                          << " and was full " << m_full_counter
+                          << " times in " << m_push_counter
+                          << " push() calls and was empty " << m_empty_counter
+                          << " times in " << m_pop_counter
+                          << " pop() calls\n";
+            }
+#else
+            ~BoundedQueue() = default;
+#endif
+
+            /**
+             * Push an element onto the queue. If the queue is full, this
+             * call will block.
+             */
+            void push(T value) {
+#ifdef OSMIUM_DEBUG_QUEUE_SIZE
+                ++m_push_counter;
+#endif
+                if (m_max_size == 0) {
+                    if (m_in_use) {
+                        push_unbounded(value);
+#ifdef OSMIUM_DEBUG_QUEUE_SIZE
+                        update_largest_size();
+#endif
+                        wake_up(m_waiting_consumers, m_mutex, m_data_available);
+                    }
+                    return;
+                }
+                while (m_in_use) {
+                    if (try_push(value)) {
+#ifdef OSMIUM_DEBUG_QUEUE_SIZE
+                        update_largest_size();
+#endif
+                        wake_up(m_waiting_consumers, m_mutex, m_data_available);
+                        return;
+                    }
+#ifdef OSMIUM_DEBUG_QUEUE_SIZE
+                    ++m_full_counter;
+#endif
+                    wait_for(m_waiting_producers, m_space_available, [this] {
+                        return !m_in_use || !full();
+                    });
+                }
+            }
+
+            void wait_and_pop(T& value) {
+#ifdef OSMIUM_DEBUG_QUEUE_SIZE
+                ++m_pop_counter;
+                if (empty()) {
+                    ++m_empty_counter;
+                }
+#endif
+                while (!try_pop_any(value)) {
+                    if (!m_in_use) {
+                        return;
+                    }
+                    wait_for(m_waiting_consumers, m_data_available, [this] {
+                        return !m_in_use || !empty();
+                    });
+                }
+                wake_up(m_waiting_producers, m_mutex, m_space_available);
+            }
+
+            bool try_pop(T& value) {
+#ifdef OSMIUM_DEBUG_QUEUE_SIZE
+                ++m_pop_counter;
+#endif
+                if (!try_pop_any(value)) {
+#ifdef OSMIUM_DEBUG_QUEUE_SIZE
+                    ++m_empty_counter;
+#endif
+                    return false;
+                }
+                wake_up(m_waiting_producers, m_mutex, m_space_available);
+                return true;
+            }
+
+            /**
+             * Is the queue empty? If other threads are using the queue
+             * at the same time, this is only a snapshot.
+             */
+            bool empty() const noexcept {
+                return size() == 0;
+            }
+
+            /**
+             * The number of elements in the queue. If other threads are
+             * using the queue at the same time, this is only a snapshot.
+             */
+            std::size_t size() const noexcept {
+                return ring_size() + m_overflow_size.load(std::memory_order_relaxed);
+            }
+
+            /**
+             * The maximum number of elements in the queue (the maximum
+             * size given in the constructor rounded up to the next power
+             * of two) or 0 if the queue is unbounded.
+             */
+            std::size_t capacity() const noexcept {
+                return m_max_size == 0 ? 0 : m_mask + 1;
+            }
+
+            bool in_use() const noexcept {
+                return m_in_use;
+            }
+
+            void shutdown() {
+                m_in_use = false;
+                T value;
+                while (try_pop_impl(value)) {
+                }
+                const std::lock_guard<std::mutex> lock{m_mutex};
+                m_overflow.clear();
+                m_overflow_size.store(0, std::memory_order_release);
+                m_data_available.notify_all();
+                m_space_available.notify_all();
+            }
+
+        }; // class BoundedQueue
+
+    } // namespace thread
+
+} // namespace osmium
+
+#endif // OSMIUM_THREAD_BOUNDED_QUEUE_HPP
@@ -0,0 +1,123 @@
+#ifndef OSMIUM_THREAD_NUMA_HPP
+#define OSMIUM_THREAD_NUMA_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2023 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <osmium/thread/pool.hpp>
+#include <osmium/thread/util.hpp>
+
+#include <cstddef>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace osmium {
+
+    namespace thread {
+
+        /**
+         * A NUMA node with the CPUs belonging to it.
+         */
+        struct numa_node {
+            int id;
+            std::vector<int> cpus;
+        }; // struct numa_node
+
+        namespace detail {
+
+            inline std::string read_first_line(const std::string& filename) {
+                std::ifstream file{filename};
+                std::string line;
+                std::getline(file, line);
+                return line;
+            }
+
+            inline std::vector<numa_node> read_numa_nodes(const std::string& directory) {
+                std::vector<numa_node> nodes;
+
+                const auto ids = parse_cpu_list(read_first_line(directory + "/online").c_str());
+                for (const int id : ids) {
+                    auto cpus = parse_cpu_list(read_first_line(directory + "/node" + std::to_string(id) + "/cpulist").c_str());
+                    if (!cpus.empty()) {
+                        nodes.push_back(numa_node{id, std::move(cpus)});
+                    }
+                }
+
+                return nodes;
+            }
+
+        } // namespace detail
+
+        /**
+         * Get the NUMA nodes of this system and their CPUs. Nodes without
+         * CPUs are ignored. This currently only works on Linux, on other
+         * systems (or if the information isn't available) the result is
+         * empty.
+         */
+        inline std::vector<numa_node> get_numa_nodes() {
+            return detail::read_numa_nodes("/sys/devices/system/node");
+        }
+
+        /**
+         * Create one thread pool for each NUMA node with the threads
+         * restricted to the CPUs of that node. The num_threads and
+         * max_queue_size parameters are used for each pool like in the
+         * Pool constructor, a negative number of threads is relative to
+         * the number of CPUs on the node.
+         *
+         * Use each pool for a Reader (and the code processing its buffers)
+         * or Writer so that the data stays in memory local to the node.
+         *
+         * If there is no NUMA information, a single pool without CPU
+         * restriction is returned.
+         */
+        inline std::vector<std::unique_ptr<Pool>> create_numa_node_pools(int num_threads = Pool::default_num_threads, std::size_t max_queue_size = Pool::default_queue_size) {
+            std::vector<std::unique_ptr<Pool>> pools;
+
+            for (auto& node : get_numa_nodes()) {
+                pools.emplace_back(new Pool{num_threads, max_queue_size, std::move(node.cpus)});
+            }
+
+            if (pools.empty()) {
+                pools.emplace_back(new Pool{num_threads, max_queue_size});
+            }
+
+            return pools;
+        }
+
+    } // namespace thread
+
+} // namespace osmium
+
+#endif // OSMIUM_THREAD_NUMA_HPP
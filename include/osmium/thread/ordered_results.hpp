@@ -0,0 +1,159 @@
+#ifndef OSMIUM_THREAD_ORDERED_RESULTS_HPP
+#define OSMIUM_THREAD_ORDERED_RESULTS_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2023 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+#include <osmium/thread/pool.hpp>
+
+#include <cassert>
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <utility>
+
+namespace osmium {
+
+    namespace thread {
+
+        /**
+         * Submits tasks to a thread pool and hands on their results in
+         * the order the tasks were submitted.
+         *
+         * The number of tasks in flight is limited to twice the number of
+         * pool threads (plus one). That is enough to keep all pool threads
+         * busy, but not so many that too much memory is used for results
+         * nobody has looked at yet. While waiting for the oldest result,
+         * the calling thread helps with running tasks (see
+         * Pool::help_while_waiting()).
+         *
+         * The destructor waits for all tasks still running, so data used
+         * by the tasks must outlive this object. This makes sure no task
+         * is left running when an exception is thrown.
+         *
+         * @tparam T The type of the results of the tasks.
+         */
+        template <typename T>
+        class OrderedResults {
+
+            Pool& m_pool;
+            task_priority m_priority;
+            std::size_t m_max_tasks;
+            std::deque<std::future<T>> m_futures;
+
+        public:
+
+            /**
+             * Create with the pool to use and the priority the tasks are
+             * submitted with.
+             */
+            explicit OrderedResults(Pool& pool, task_priority priority = task_priority::normal) :
+                m_pool(pool),
+                m_priority(priority),
+                m_max_tasks(2 * static_cast<std::size_t>(pool.num_threads()) + 1) {
+            }
+
+            OrderedResults(const OrderedResults&) = delete;
+            OrderedResults& operator=(const OrderedResults&) = delete;
+
+            OrderedResults(OrderedResults&&) = delete;
+            OrderedResults& operator=(OrderedResults&&) = delete;
+
+            ~OrderedResults() noexcept {
+                wait_all();
+            }
+
+            bool empty() const noexcept {
+                return m_futures.empty();
+            }
+
+            std::size_t size() const noexcept {
+                return m_futures.size();
+            }
+
+            /**
+             * Call output(result) with the result of the oldest task.
+             * Rethrows any exception thrown by the task.
+             */
+            template <typename TOutput>
+            void output_oldest(TOutput&& output) {
+                assert(!m_futures.empty());
+                m_pool.help_while_waiting(m_futures.front(), m_priority);
+                T result = m_futures.front().get();
+                m_futures.pop_front();
+                output(std::move(result));
+            }
+
+            /**
+             * Submit a task (a function returning T) to the pool. If there
+             * are too many tasks in flight, output the result of the
+             * oldest first.
+             */
+            template <typename TFunction, typename TOutput>
+            void submit(TFunction&& func, TOutput&& output) {
+                if (m_futures.size() >= m_max_tasks) {
+                    output_oldest(output);
+                }
+                m_futures.push_back(m_pool.submit(std::forward<TFunction>(func), m_priority));
+            }
+
+            /**
+             * Output the results of all tasks in order.
+             */
+            template <typename TOutput>
+            void output_all(TOutput&& output) {
+                while (!m_futures.empty()) {
+                    output_oldest(output);
+                }
+            }
+
+            /**
+             * Wait for all tasks still in flight and drop their results
+             * (and exceptions).
+             */
+            void wait_all() noexcept {
+                for (const auto& future : m_futures) {
+                    if (future.valid()) {
+                        future.wait();
+                    }
+                }
+                m_futures.clear();
+            }
+
+        }; // class OrderedResults
+
+    } // namespace thread
+
+} // namespace osmium
+
+#endif // OSMIUM_THREAD_ORDERED_RESULTS_HPP
@@ -34,17 +34,27 @@ DEALINGS IN THE SOFTWARE.
 */
 
 #include <osmium/thread/function_wrapper.hpp>
-#include <osmium/thread/queue.hpp>
 #include <osmium/thread/util.hpp>
 #include <osmium/util/config.hpp>
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
+#include <deque>
 #include <future>
+#include <memory>
+#include <mutex>
 #include <thread>
 #include <type_traits>
 #include <utility>
 #include <vector>
 
+#ifdef OSMIUM_DEBUG_QUEUE_SIZE
+# include <iostream>
+#endif
+
 namespace osmium {
 
     /**
@@ -52,6 +62,18 @@ namespace osmium {
      */
     namespace thread {
 
+        /**
+         * Priority of a task submitted to the thread pool. Tasks with
+         * higher priority are always run before tasks with lower priority,
+         * tasks with the same priority are run in the order they were
+         * submitted (as far as possible with several worker threads).
+         */
+        enum class task_priority : int {
+            low    = 0,
+            normal = 1,
+            high   = 2
+        }; // enum class task_priority
+
         namespace detail {
 
             // Maximum number of allowed pool threads (just to keep the user
@@ -60,6 +82,10 @@ namespace osmium {
                 max_pool_threads = 32
             };
 
+            enum {
+                num_task_priorities = 3
+            };
+
             inline int get_pool_size(int num_threads, int user_setting, unsigned hardware_concurrency) {
                 if (num_threads == 0) {
                     num_threads = user_setting ? user_setting : -2;
@@ -85,7 +111,28 @@ namespace osmium {
         } // namespace detail
 
         /**
-         *  Thread pool.
+         * Work-stealing thread pool.
+         *
+         * Every worker thread has its own task queues (one for each
+         * task_priority). Tasks submitted from outside the pool are
+         * distributed round-robin over those queues, tasks submitted from
+         * a worker thread go into the queue of that worker. An idle worker
+         * takes the oldest task from its own queue or, if that is empty,
+         * steals the oldest task from one of the other workers. Tasks with
+         * a higher priority are always preferred.
+         *
+         * The number of queued tasks is limited. Threads outside the pool
+         * submitting tasks will block until there is space again. Pool
+         * threads never block in submit(), otherwise they could deadlock.
+         *
+         * The pool threads can be restricted to a set of CPUs (see the
+         * constructor). Memory is usually allocated by the operating system
+         * on the NUMA node of the thread that first writes to it ("first
+         * touch"). So if the pool threads are restricted to the CPUs of one
+         * NUMA node, the buffers they fill (for instance when decoding PBF
+         * blocks) will be on that node, too. Use get_numa_nodes() from
+         * osmium/thread/numa.hpp to find out which CPUs belong to which
+         * node and create one pool per node.
          */
         class Pool {
 
@@ -119,19 +166,237 @@ namespace osmium {
 
             }; // class thread_joiner
 
-            osmium::thread::Queue<function_wrapper> m_work_queue;
+            /**
+             * The task queues of one worker thread.
+             */
+            struct worker_queues {
+                std::mutex mutex;
+                std::array<std::deque<function_wrapper>, detail::num_task_priorities> tasks;
+            }; // struct worker_queues
+
+            /**
+             * Identifies the pool and worker index of the current thread.
+             */
+            struct worker_id {
+                const Pool* pool;
+                std::size_t index;
+            }; // struct worker_id
+
+            static worker_id& current_worker() noexcept {
+                static thread_local worker_id id{nullptr, 0};
+                return id;
+            }
+
+#ifdef OSMIUM_DEBUG_QUEUE_SIZE
+            /**
+             * Statistics about the work queue, printed when the pool is
+             * destructed (after all workers are joined) in the same way
+             * as for osmium::thread::Queue.
+             */
+            struct queue_stats {
+
+                std::size_t max_size;
+
+                /// The largest number of queued tasks so far.
+                std::atomic<std::size_t> largest_size{0};
+
+                /// The number of tasks submitted.
+                std::atomic<int> push_counter{0};
+
+                /// The number of times the queue was full when a thread
+                /// outside the pool submitted a task.
+                std::atomic<int> full_counter{0};
+
+                /// The number of times a worker looked for a task.
+                std::atomic<int> pop_counter{0};
+
+                /// The number of times a worker found no task.
+                std::atomic<int> empty_counter{0};
+
+                explicit queue_stats(std::size_t size) noexcept :
+                    max_size(size) {
+                }
+
+                queue_stats(const queue_stats&) = delete;
+                queue_stats& operator=(const queue_stats&) = delete;
+
+                queue_stats(queue_stats&&) = delete;
+                queue_stats& operator=(queue_stats&&) = delete;
+
+                ~queue_stats() {
+                    std::cerr << "queue 'work' with max_size=" << max_size
+                              << " had largest size " << largest_size
+                              << " and was full " << full_counter
+                              << " times in " << push_counter
+                              << " push() calls and was empty " << empty_counter
+                              << " times in " << pop_counter
+                              << " pop() calls\n";
+                }
+
+            }; // struct queue_stats
+#endif
+
+            std::vector<int> m_cpus;
+            int m_num_threads;
+            std::size_t m_max_queue_size;
+
+#ifdef OSMIUM_DEBUG_QUEUE_SIZE
+            // Declared before the thread joiner, so it is destructed after
+            // all workers have finished.
+            queue_stats m_stats{m_max_queue_size};
+#endif
+
+            std::vector<std::unique_ptr<worker_queues>> m_queues;
+
+            // Number of tasks queued for each priority.
+            std::array<std::atomic<std::size_t>, detail::num_task_priorities> m_num_queued;
+
+            std::atomic<std::size_t> m_next_queue{0};
+
+            std::mutex m_wait_mutex;
+            std::condition_variable m_work_available;
+            std::condition_variable m_space_available;
+            std::atomic<int> m_num_waiting_workers{0};
+            std::atomic<int> m_num_waiting_submitters{0};
+            std::atomic<bool> m_shutdown{false};
+
             std::vector<std::thread> m_threads{};
             thread_joiner m_joiner;
-            int m_num_threads;
 
-            void worker_thread() {
+            static std::size_t priority_index(task_priority priority) noexcept {
+                return static_cast<std::size_t>(priority);
+            }
+
+            std::size_t num_queued() const noexcept {
+                std::size_t sum = 0;
+                for (const auto& n : m_num_queued) {
+                    sum += n.load();
+                }
+                return sum;
+            }
+
+            // Returns the index of the worker if the current thread is a
+            // worker of this pool, otherwise the number of workers.
+            std::size_t current_worker_index() const noexcept {
+                const auto& id = current_worker();
+                return id.pool == this ? id.index : m_queues.size();
+            }
+
+            bool take_task(std::size_t queue_index, std::size_t prio, function_wrapper& task) {
+                {
+                    auto& queues = *m_queues[queue_index];
+                    const std::lock_guard<std::mutex> lock{queues.mutex};
+                    auto& tasks = queues.tasks[prio];
+                    if (tasks.empty()) {
+                        return false;
+                    }
+                    task = std::move(tasks.front());
+                    tasks.pop_front();
+                    --m_num_queued[prio];
+                }
+
+                // A submitter waiting in wait_for_space() has either seen
+                // the decremented count or is registered as waiting and
+                // gets this notification. Notifying under the mutex makes
+                // sure it can't be between its check and going to sleep.
+                if (m_max_queue_size > 0 && m_num_waiting_submitters.load() > 0 && num_queued() < m_max_queue_size) {
+                    const std::lock_guard<std::mutex> lock{m_wait_mutex};
+                    m_space_available.notify_one();
+                }
+                return true;
+            }
+
+            // Get the next task with at least the given priority to run,
+            // looking first at the own queue (starting at the queue with
+            // the given index), then stealing from other queues.
+            bool pop_task(std::size_t start, function_wrapper& task, task_priority min_priority = task_priority::low) {
+                const auto num_queues = m_queues.size();
+                for (std::size_t prio = detail::num_task_priorities; prio > priority_index(min_priority); --prio) {
+                    if (m_num_queued[prio - 1].load() == 0) {
+                        continue;
+                    }
+                    for (std::size_t i = 0; i < num_queues; ++i) {
+                        if (take_task((start + i) % num_queues, prio - 1, task)) {
+                            return true;
+                        }
+                    }
+                }
+                return false;
+            }
+
+            void push_task(function_wrapper&& task, task_priority priority) {
+                const auto prio = priority_index(priority);
+                auto index = current_worker_index();
+
+                if (index == m_queues.size()) {
+                    wait_for_space();
+                    index = m_next_queue++ % m_queues.size();
+                }
+
+                {
+                    auto& queues = *m_queues[index];
+                    const std::lock_guard<std::mutex> lock{queues.mutex};
+                    queues.tasks[prio].push_back(std::move(task));
+                    ++m_num_queued[prio];
+                }
+
+#ifdef OSMIUM_DEBUG_QUEUE_SIZE
+                ++m_stats.push_counter;
+                const auto size = num_queued();
+                auto largest = m_stats.largest_size.load();
+                while (largest < size && !m_stats.largest_size.compare_exchange_weak(largest, size)) {
+                }
+#endif
+
+                if (m_num_waiting_workers.load() > 0) {
+                    const std::lock_guard<std::mutex> lock{m_wait_mutex};
+                    m_work_available.notify_one();
+                }
+            }
+
+            void wait_for_space() {
+                if (m_max_queue_size == 0 || num_queued() < m_max_queue_size) {
+                    return;
+                }
+#ifdef OSMIUM_DEBUG_QUEUE_SIZE
+                ++m_stats.full_counter;
+#endif
+                std::unique_lock<std::mutex> lock{m_wait_mutex};
+                ++m_num_waiting_submitters;
+                m_space_available.wait(lock, [this] {
+                    return num_queued() < m_max_queue_size;
+                });
+                --m_num_waiting_submitters;
+            }
+
+            void worker_thread(std::size_t index) {
                 osmium::thread::set_thread_name("_osmium_worker");
+                if (!m_cpus.empty()) {
+                    osmium::thread::set_thread_affinity(m_cpus);
+                }
+                current_worker() = worker_id{this, index};
+
+                function_wrapper task;
                 while (true) {
-                    function_wrapper task;
-                    m_work_queue.wait_and_pop(task);
-                    if (task && task()) {
-                        // The called tasks returns true only when the
-                        // worker thread should shut down.
+#ifdef OSMIUM_DEBUG_QUEUE_SIZE
+                    ++m_stats.pop_counter;
+#endif
+                    if (pop_task(index, task)) {
+                        task();
+                        task = function_wrapper{};
+                        continue;
+                    }
+#ifdef OSMIUM_DEBUG_QUEUE_SIZE
+                    ++m_stats.empty_counter;
+#endif
+
+                    std::unique_lock<std::mutex> lock{m_wait_mutex};
+                    ++m_num_waiting_workers;
+                    m_work_available.wait(lock, [this] {
+                        return num_queued() > 0 || m_shutdown.load();
+                    });
+                    --m_num_waiting_workers;
+                    if (m_shutdown.load() && num_queued() == 0) {
                         return;
                     }
                 }
@@ -161,15 +426,35 @@ namespace osmium {
              *
              * If max_queue_size is 0, the queue size is read from
              * the environment variable OSMIUM_MAX_WORK_QUEUE_SIZE.
+             *
+             * If cpus is not empty, all pool threads will only run on the
+             * CPUs with those numbers. If it is empty, the list of CPUs is
+             * read from the environment variable OSMIUM_POOL_CPUS (see
+             * osmium::thread::parse_cpu_list() for the format). If that is
+             * not set either, the threads can run on any CPU. If a CPU list
+             * is used, the number of threads is calculated relative to the
+             * number of CPUs in the list instead of the number of cores on
+             * the system. Setting the CPUs currently only works on Linux.
              */
-            explicit Pool(int num_threads = default_num_threads, std::size_t max_queue_size = default_queue_size) :
-                m_work_queue(max_queue_size > 0 ? max_queue_size : detail::get_work_queue_size(), "work"),
-                m_joiner(m_threads),
-                m_num_threads(detail::get_pool_size(num_threads, osmium::config::get_pool_threads(), std::thread::hardware_concurrency())) {
+            explicit Pool(int num_threads = default_num_threads, std::size_t max_queue_size = default_queue_size, std::vector<int> cpus = {}) :
+                m_cpus(cpus.empty() ? parse_cpu_list(osmium::config::get_pool_cpus().c_str()) : std::move(cpus)),
+                m_num_threads(detail::get_pool_size(num_threads,
+                                                    osmium::config::get_pool_threads(),
+                                                    m_cpus.empty() ? std::thread::hardware_concurrency() : static_cast<unsigned>(m_cpus.size()))),
+                m_max_queue_size(max_queue_size > 0 ? max_queue_size : detail::get_work_queue_size()),
+                m_joiner(m_threads) {
+
+                for (auto& n : m_num_queued) {
+                    n = 0;
+                }
+
+                for (int i = 0; i < m_num_threads; ++i) {
+                    m_queues.emplace_back(new worker_queues{});
+                }
 
                 try {
-                    for (int i = 0; i < m_num_threads; ++i) {
-                        m_threads.emplace_back(&Pool::worker_thread, this);
+                    for (std::size_t i = 0; i < m_queues.size(); ++i) {
+                        m_threads.emplace_back(&Pool::worker_thread, this, i);
                     }
                 } catch (...) {
                     shutdown_all_workers();
@@ -188,11 +473,15 @@ namespace osmium {
                 return pool;
             }
 
+            /**
+             * Tell all workers to shut down. Tasks already queued will
+             * still be run. This function does not wait for the workers,
+             * they are joined in the destructor.
+             */
             void shutdown_all_workers() {
-                for (int i = 0; i < m_num_threads; ++i) {
-                    // The special function wrapper makes a worker shut down.
-                    m_work_queue.push(function_wrapper{0});
-                }
+                const std::lock_guard<std::mutex> lock{m_wait_mutex};
+                m_shutdown = true;
+                m_work_available.notify_all();
             }
 
             Pool(const Pool&) = delete;
@@ -209,12 +498,20 @@ namespace osmium {
                 return m_num_threads;
             }
 
+            /**
+             * The CPUs the pool threads are restricted to. Empty if they
+             * are not restricted.
+             */
+            const std::vector<int>& cpus() const noexcept {
+                return m_cpus;
+            }
+
             std::size_t queue_size() const {
-                return m_work_queue.size();
+                return num_queued();
             }
 
             bool queue_empty() const {
-                return m_work_queue.empty();
+                return num_queued() == 0;
             }
 
 #if defined(__cpp_lib_is_invocable) && __cpp_lib_is_invocable >= 201703
@@ -228,15 +525,68 @@ namespace osmium {
             using submit_func_result_type = typename std::result_of<TFunction()>::type;
 #endif
 
+            /**
+             * Submit a task to the pool.
+             *
+             * @param func The function to run.
+             * @param priority Priority of this task.
+             * @returns Future with the result of the function.
+             */
             template <typename TFunction>
-            std::future<submit_func_result_type<TFunction>> submit(TFunction&& func) {
+            std::future<submit_func_result_type<TFunction>> submit(TFunction&& func, task_priority priority = task_priority::normal) {
                 std::packaged_task<submit_func_result_type<TFunction>()> task{std::forward<TFunction>(func)};
                 std::future<submit_func_result_type<TFunction>> future_result{task.get_future()};
-                m_work_queue.push(std::move(task));
+                push_task(std::move(task), priority);
 
                 return future_result;
             }
 
+            /**
+             * Run one queued task with at least the given priority, if
+             * there is any, in the current thread.
+             *
+             * @param min_priority Only run tasks with this or a higher
+             *                     priority.
+             * @returns true if a task was run, false if there was no
+             *          such task.
+             */
+            bool run_pending_task(task_priority min_priority = task_priority::low) {
+                function_wrapper task;
+                const auto index = current_worker_index();
+                if (!pop_task(index == m_queues.size() ? 0 : index, task, min_priority)) {
+                    return false;
+                }
+                task();
+                return true;
+            }
+
+            /**
+             * Wait until the future is ready. While waiting, run queued
+             * tasks in the current thread instead of blocking. Use this
+             * from inside a pool task that waits for other tasks it has
+             * submitted to make sure this can not deadlock.
+             *
+             * In a pool thread any queued task is run. In other threads
+             * only tasks with at least the given priority (usually the
+             * priority the awaited task was submitted with) are run, so
+             * that the thread is not kept busy with unrelated work.
+             *
+             * @param future The future to wait for.
+             * @param priority Priority of the task we are waiting for.
+             */
+            template <typename T>
+            void help_while_waiting(const std::future<T>& future, task_priority priority = task_priority::normal) {
+                const auto min_priority = current_worker_index() == m_queues.size() ? priority : task_priority::low;
+                while (future.wait_for(std::chrono::seconds{0}) != std::future_status::ready) {
+                    if (!run_pending_task(min_priority)) {
+                        // Nothing (suitable) left in the queues, so the
+                        // task we are waiting for must be running already.
+                        future.wait();
+                        return;
+                    }
+                }
+            }
+
         }; // class Pool
 
     } // namespace thread
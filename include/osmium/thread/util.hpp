@@ -33,12 +33,18 @@ DEALINGS IN THE SOFTWARE.
 
 */
 
+#include <algorithm>
 #include <chrono>
+#include <cstdlib>
 #include <future>
+#include <string>
 #include <thread>
 #include <utility>
+#include <vector>
 
 #if defined(__linux__)
+# include <pthread.h>
+# include <sched.h>
 # include <sys/prctl.h>
 #elif defined(__FreeBSD__)
 # include <pthread.h>
@@ -88,6 +94,80 @@ namespace osmium {
         }
 #endif
 
+        /**
+         * Parse a list of CPU numbers in the format used by Linux in
+         * /sys (and by taskset(1)): A comma-separated list of numbers or
+         * ranges of numbers, for instance "0-3,8,10-11".
+         *
+         * @returns Sorted vector of CPU numbers. Empty if the list is
+         *          empty or not well-formed.
+         */
+        inline std::vector<int> parse_cpu_list(const char* list) {
+            std::vector<int> cpus;
+            if (!list) {
+                return cpus;
+            }
+
+            const char* str = list;
+            while (*str != '\0' && *str != '\n') {
+                char* end = nullptr;
+                const auto first = std::strtol(str, &end, 10);
+                if (end == str || first < 0 || first >= 64 * 1024) {
+                    return {};
+                }
+                auto last = first;
+                str = end;
+                if (*str == '-') {
+                    ++str;
+                    last = std::strtol(str, &end, 10);
+                    if (end == str || last < first || last >= 64 * 1024) {
+                        return {};
+                    }
+                    str = end;
+                }
+                for (auto cpu = first; cpu <= last; ++cpu) {
+                    cpus.push_back(static_cast<int>(cpu));
+                }
+                if (*str == ',') {
+                    ++str;
+                } else if (*str != '\0' && *str != '\n') {
+                    return {};
+                }
+            }
+
+            std::sort(cpus.begin(), cpus.end());
+            cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+
+            return cpus;
+        }
+
+        /**
+         * Restrict the current thread to run on the given CPUs only. This
+         * currently only works on Linux.
+         *
+         * @returns true if the affinity was set, false if this is not
+         *          supported or the call failed.
+         */
+#if defined(__linux__)
+        inline bool set_thread_affinity(const std::vector<int>& cpus) noexcept {
+            if (cpus.empty()) {
+                return false;
+            }
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            for (const int cpu : cpus) {
+                if (cpu >= 0 && cpu < CPU_SETSIZE) {
+                    CPU_SET(cpu, &set);
+                }
+            }
+            return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+        }
+#else
+        inline bool set_thread_affinity(const std::vector<int>& /*cpus*/) noexcept {
+            return false;
+        }
+#endif
+
         class thread_handler {
 
             std::thread m_thread;
@@ -42,6 +42,13 @@ DEALINGS IN THE SOFTWARE.
 # define OSMIUM_DEPRECATED
 #endif
 
+// Tell the CPU that the memory at addr will be read soon.
+#ifdef __GNUC__
+# define OSMIUM_PREFETCH(addr) __builtin_prefetch(addr)
+#else
+# define OSMIUM_PREFETCH(addr)
+#endif
+
 // Set OSMIUM_DEFINE_EXPORT before including any osmium headers to add
 // the special attributes to all exception classes.
 #ifdef OSMIUM_DEFINE_EXPORT
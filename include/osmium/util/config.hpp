@@ -67,6 +67,21 @@ namespace osmium {
             return 0;
         }
 
+        /**
+         * Get the list of CPUs the pool threads should run on from the
+         * environment variable OSMIUM_POOL_CPUS. The format is a
+         * comma-separated list of CPU numbers or ranges like "0-7,16-23".
+         *
+         * @returns The list or an empty string if the variable isn't set.
+         */
+        inline std::string get_pool_cpus() {
+            const char* env = osmium::detail::getenv_wrapper("OSMIUM_POOL_CPUS");
+            if (env) {
+                return env;
+            }
+            return "";
+        }
+
         inline bool use_pool_threads_for_pbf_parsing() noexcept {
             const char* env = osmium::detail::getenv_wrapper("OSMIUM_USE_POOL_THREADS_FOR_PBF_PARSING");
             if (env) {
@@ -35,15 +35,22 @@ DEALINGS IN THE SOFTWARE.
 
 #include <osmium/util/file.hpp>
 
+#include <algorithm>
 #include <cassert>
 #include <cerrno>
 #include <cstddef>
+#include <cstring>
 #include <stdexcept>
 #include <system_error>
+#include <utility>
 
 #ifndef _WIN32
 # include <sys/mman.h>
 # include <sys/statvfs.h>
+# ifdef __linux__
+#  include <fstream>
+#  include <string>
+# endif
 #else
 # include <fcntl.h>
 # include <io.h>
@@ -55,6 +62,61 @@ namespace osmium {
 
     inline namespace util {
 
+        /**
+         * @brief Bit field for tuning memory mappings.
+         */
+        namespace memory_mapping_flags {
+
+            /**
+             * Flags for tuning how the operating system handles the pages
+             * of a memory mapping. They can be combined with |.
+             *
+             * Apart from huge_tlb these are hints, they are ignored if
+             * the system doesn't support them. They are only implemented
+             * on Linux.
+             */
+            enum type : unsigned int {
+
+                none          = 0x00,
+
+                /// Use transparent huge pages (madvise MADV_HUGEPAGE).
+                huge_pages    = 0x01,
+
+                /**
+                 * Use explicitly reserved huge pages. Anonymous mappings
+                 * are created with MAP_HUGETLB and will fail if not enough
+                 * huge pages are reserved. For file-based mappings the file
+                 * has to be on a hugetlbfs file system. In both cases the
+                 * size of the mapping is rounded up to the huge page size.
+                 */
+                huge_tlb      = 0x02,
+
+                /// Read or allocate all pages when mapping (MAP_POPULATE).
+                populate      = 0x04,
+
+                /// Pages will be accessed in random order (MADV_RANDOM).
+                random_access = 0x08,
+
+                /// Pages will be needed soon (MADV_WILLNEED).
+                will_need     = 0x10
+
+            }; // enum type
+
+            inline constexpr type operator|(const type lhs, const type rhs) noexcept {
+                return static_cast<type>(static_cast<unsigned int>(lhs) | static_cast<unsigned int>(rhs));
+            }
+
+            inline constexpr type operator&(const type lhs, const type rhs) noexcept {
+                return static_cast<type>(static_cast<unsigned int>(lhs) & static_cast<unsigned int>(rhs));
+            }
+
+            inline type& operator|=(type& lhs, const type rhs) noexcept {
+                lhs = lhs | rhs;
+                return lhs;
+            }
+
+        } // namespace memory_mapping_flags
+
         /**
          * Class for wrapping memory mapping system calls.
          *
@@ -91,6 +153,11 @@ namespace osmium {
          *
          * On Windows the file will be set to binary mode before the memory
          * mapping.
+         *
+         * The memory_mapping_flags can be used to ask for huge pages, for
+         * populating the mapping up front, or to tell the system about the
+         * expected access pattern. They are kept when the mapping is
+         * resized.
          */
         class MemoryMapping {
 
@@ -110,6 +177,9 @@ namespace osmium {
             /// Offset into the file
             off_t m_offset;
 
+            /// Flags for tuning the mapping
+            memory_mapping_flags::type m_flags;
+
             /// File handle we got the mapping from
             int m_fd;
 
@@ -137,6 +207,8 @@ namespace osmium {
 
             flag_type get_flags() const noexcept;
 
+            void apply_advice() const noexcept;
+
             static std::size_t check_size(std::size_t size) {
                 if (size == 0) {
                     return osmium::get_pagesize();
@@ -144,6 +216,18 @@ namespace osmium {
                 return size;
             }
 
+            // The number of bytes actually mapped. This is the size
+            // rounded up to the huge page size if explicit huge pages are
+            // used, because they can only be mapped and unmapped as a
+            // whole.
+            std::size_t mapped_size() const noexcept {
+                if (m_flags & memory_mapping_flags::huge_tlb) {
+                    const std::size_t hps = huge_page_size();
+                    return (m_size + hps - 1) / hps * hps;
+                }
+                return m_size;
+            }
+
 #ifdef _WIN32
             HANDLE get_handle() const noexcept;
             HANDLE create_file_mapping() const noexcept;
@@ -173,19 +257,47 @@ namespace osmium {
 
                 // Make sure the file backing this mapping is large enough.
                 auto const current_file_size = osmium::file_size(fd);
-                if (current_file_size < m_size + m_offset) {
+                if (current_file_size < mapped_size() + m_offset) {
                     const auto available = available_space(fd);
-                    if (available > 0 && current_file_size + available <= m_size) {
+                    if (available > 0 && current_file_size + available <= mapped_size()) {
                         throw std::system_error{ENOSPC, std::system_category(), "Could not resize file: Not enough space on filesystem"};
                     }
 
-                    osmium::resize_file(fd, m_size + m_offset);
+                    osmium::resize_file(fd, mapped_size() + m_offset);
                 }
                 return fd;
             }
 
         public:
 
+            /**
+             * The size of huge pages on this system. Used for rounding the
+             * size of mappings with memory_mapping_flags::huge_tlb.
+             */
+            static std::size_t huge_page_size() noexcept {
+#ifdef __linux__
+                static const std::size_t size = []() noexcept {
+                    std::size_t value = 0;
+                    try {
+                        std::ifstream meminfo{"/proc/meminfo"};
+                        std::string line;
+                        while (std::getline(meminfo, line)) {
+                            if (line.compare(0, 13, "Hugepagesize:") == 0) {
+                                value = std::stoul(line.substr(13)) * 1024UL;
+                                break;
+                            }
+                        }
+                    } catch (...) {
+                        value = 0;
+                    }
+                    return value == 0 ? 2UL * 1024UL * 1024UL : value;
+                }();
+                return size;
+#else
+                return 2UL * 1024UL * 1024UL;
+#endif
+            }
+
             /**
              * Create memory mapping of given size.
              *
@@ -200,9 +312,10 @@ namespace osmium {
              * @param mode Mapping mode: readonly, or writable (shared or private)
              * @param fd Open file descriptor of a file we want to map
              * @param offset Offset into the file where the mapping should start
+             * @param flags Flags for tuning the mapping
              * @throws std::system_error if the mapping fails
              */
-            MemoryMapping(std::size_t size, mapping_mode mode, int fd = -1, off_t offset = 0);
+            MemoryMapping(std::size_t size, mapping_mode mode, int fd = -1, off_t offset = 0, memory_mapping_flags::type flags = memory_mapping_flags::none);
 
             /// You can not copy construct a MemoryMapping.
             MemoryMapping(const MemoryMapping&) = delete;
@@ -248,6 +361,12 @@ namespace osmium {
              * systems it will unmap and remap the memory. This can only be
              * done for file-based mappings, not anonymous mappings!
              *
+             * Anonymous mappings with the huge_tlb flag are copied into a
+             * new mapping, file-based mappings with the populate flag are
+             * populated again completely. In both cases the cost is
+             * proportional to the new size, so grow these mappings in
+             * large (for instance geometric) steps.
+             *
              * @param new_size Number of bytes to resize to (must be > 0).
              *
              * @throws std::system_error if the remapping fails.
@@ -287,6 +406,13 @@ namespace osmium {
                 return m_mapping_mode != mapping_mode::readonly;
             }
 
+            /**
+             * The flags this mapping was created with.
+             */
+            memory_mapping_flags::type flags() const noexcept {
+                return m_flags;
+            }
+
             /**
              * Get the address of the mapping as any pointer type you like.
              *
@@ -313,8 +439,8 @@ namespace osmium {
 
         public:
 
-            explicit AnonymousMemoryMapping(std::size_t size) :
-                MemoryMapping(size, mapping_mode::write_private) {
+            explicit AnonymousMemoryMapping(std::size_t size, memory_mapping_flags::type flags = memory_mapping_flags::none) :
+                MemoryMapping(size, mapping_mode::write_private, -1, 0, flags) {
             }
 
 #ifndef __linux__
@@ -347,10 +473,11 @@ namespace osmium {
              * Create anonymous typed memory mapping of given size.
              *
              * @param size Number of objects of type T to be mapped
+             * @param flags Flags for tuning the mapping
              * @throws std::system_error if the mapping fails
              */
-            explicit TypedMemoryMapping(std::size_t size) :
-                m_mapping(sizeof(T) * size, MemoryMapping::mapping_mode::write_private) {
+            explicit TypedMemoryMapping(std::size_t size, memory_mapping_flags::type flags = memory_mapping_flags::none) :
+                m_mapping(sizeof(T) * size, MemoryMapping::mapping_mode::write_private, -1, 0, flags) {
             }
 
             /**
@@ -361,10 +488,11 @@ namespace osmium {
              * @param mode Mapping mode: readonly, or writable (shared or private)
              * @param fd Open file descriptor of a file we want to map
              * @param offset Offset into the file where the mapping should start
+             * @param flags Flags for tuning the mapping
              * @throws std::system_error if the mapping fails
              */
-            TypedMemoryMapping(std::size_t size, MemoryMapping::mapping_mode mode, int fd, off_t offset = 0) :
-                m_mapping(sizeof(T) * size, mode, fd, sizeof(T) * offset) {
+            TypedMemoryMapping(std::size_t size, MemoryMapping::mapping_mode mode, int fd, off_t offset = 0, memory_mapping_flags::type flags = memory_mapping_flags::none) :
+                m_mapping(sizeof(T) * size, mode, fd, sizeof(T) * offset, flags) {
             }
 
             /// You can not copy construct a TypedMemoryMapping.
@@ -407,6 +535,12 @@ namespace osmium {
              * systems it will unmap and remap the memory. This can only be
              * done for file-based mappings, not anonymous mappings!
              *
+             * Anonymous mappings with the huge_tlb flag are copied into a
+             * new mapping, file-based mappings with the populate flag are
+             * populated again completely. In both cases the cost is
+             * proportional to the new size, so grow these mappings in
+             * large (for instance geometric) steps.
+             *
              * @param new_size Number of objects of type T to resize to
              * @throws std::system_error if the remapping fails
              */
@@ -448,6 +582,13 @@ namespace osmium {
                 return m_mapping.writable();
             }
 
+            /**
+             * The flags this mapping was created with.
+             */
+            memory_mapping_flags::type flags() const noexcept {
+                return m_mapping.flags();
+            }
+
             /**
              * Get the address of the beginning of the mapping.
              *
@@ -509,8 +650,8 @@ namespace osmium {
 
         public:
 
-            explicit AnonymousTypedMemoryMapping(std::size_t size) :
-                TypedMemoryMapping<T>(size) {
+            explicit AnonymousTypedMemoryMapping(std::size_t size, memory_mapping_flags::type flags = memory_mapping_flags::none) :
+                TypedMemoryMapping<T>(size, flags) {
             }
 
 #ifndef __linux__
@@ -558,30 +699,62 @@ inline int osmium::util::MemoryMapping::get_protection() const noexcept {
 }
 
 inline int osmium::util::MemoryMapping::get_flags() const noexcept {
+    int flags = 0;
     if (m_fd == -1) {
-        return MAP_PRIVATE | MAP_ANONYMOUS; // NOLINT(hicpp-signed-bitwise)
+        flags = MAP_PRIVATE | MAP_ANONYMOUS; // NOLINT(hicpp-signed-bitwise)
+#ifdef MAP_HUGETLB
+        if (m_flags & memory_mapping_flags::huge_tlb) {
+            flags |= MAP_HUGETLB; // NOLINT(hicpp-signed-bitwise)
+        }
+#endif
+    } else if (m_mapping_mode == mapping_mode::write_shared) {
+        flags = MAP_SHARED;
+    } else {
+        flags = MAP_PRIVATE;
+    }
+#ifdef MAP_POPULATE
+    if (m_flags & memory_mapping_flags::populate) {
+        flags |= MAP_POPULATE; // NOLINT(hicpp-signed-bitwise)
     }
-    if (m_mapping_mode == mapping_mode::write_shared) {
-        return MAP_SHARED;
+#endif
+    return flags;
+}
+
+inline void osmium::util::MemoryMapping::apply_advice() const noexcept {
+    // These are only hints, so errors are ignored.
+#ifdef __linux__
+# ifdef MADV_HUGEPAGE
+    if (m_flags & memory_mapping_flags::huge_pages) {
+        ::madvise(m_addr, mapped_size(), MADV_HUGEPAGE);
     }
-    return MAP_PRIVATE;
+# endif
+    if (m_flags & memory_mapping_flags::random_access) {
+        ::madvise(m_addr, mapped_size(), MADV_RANDOM);
+    }
+    if (m_flags & memory_mapping_flags::will_need) {
+        ::madvise(m_addr, mapped_size(), MADV_WILLNEED);
+    }
+#endif
 }
 
-inline osmium::util::MemoryMapping::MemoryMapping(std::size_t size, mapping_mode mode, int fd, off_t offset) :
+inline osmium::util::MemoryMapping::MemoryMapping(std::size_t size, mapping_mode mode, int fd, off_t offset, memory_mapping_flags::type flags) :
     m_size(check_size(size)),
     m_offset(offset),
+    m_flags(flags),
     m_fd(resize_fd(fd)),
     m_mapping_mode(mode),
-    m_addr(::mmap(nullptr, m_size, get_protection(), get_flags(), m_fd, m_offset)) {
+    m_addr(::mmap(nullptr, mapped_size(), get_protection(), get_flags(), m_fd, m_offset)) {
     assert(!(fd == -1 && mode == mapping_mode::readonly));
     if (!is_valid()) {
         throw std::system_error{errno, std::system_category(), "mmap failed"};
     }
+    apply_advice();
 }
 
 inline osmium::util::MemoryMapping::MemoryMapping(MemoryMapping&& other) noexcept :
     m_size(other.m_size),
     m_offset(other.m_offset),
+    m_flags(other.m_flags),
     m_fd(other.m_fd),
     m_mapping_mode(other.m_mapping_mode),
     m_addr(other.m_addr) {
@@ -597,6 +770,7 @@ inline osmium::util::MemoryMapping& osmium::util::MemoryMapping::operator=(osmiu
     }
     m_size         = other.m_size;
     m_offset       = other.m_offset;
+    m_flags        = other.m_flags;
     m_fd           = other.m_fd;
     m_mapping_mode = other.m_mapping_mode;
     m_addr         = other.m_addr;
@@ -606,7 +780,7 @@ inline osmium::util::MemoryMapping& osmium::util::MemoryMapping::operator=(osmiu
 
 inline void osmium::util::MemoryMapping::unmap() {
     if (is_valid()) {
-        if (::munmap(m_addr, m_size) != 0) {
+        if (::munmap(m_addr, mapped_size()) != 0) {
             throw std::system_error{errno, std::system_category(), "munmap failed"};
         }
         make_invalid();
@@ -615,13 +789,22 @@ inline void osmium::util::MemoryMapping::unmap() {
 
 inline void osmium::util::MemoryMapping::resize(std::size_t new_size) {
     assert(new_size > 0 && "can not resize to zero size");
-    if (m_fd == -1) { // anonymous mapping
+    if (m_fd == -1 && (m_flags & memory_mapping_flags::huge_tlb)) {
+        // Not all kernels can mremap() mappings with explicit huge pages,
+        // so a new mapping is created and the contents copied over.
+        MemoryMapping new_mapping{new_size, m_mapping_mode, -1, 0, m_flags};
+        std::memcpy(new_mapping.m_addr, m_addr, std::min(m_size, new_size));
+        using std::swap;
+        swap(m_addr, new_mapping.m_addr);
+        swap(m_size, new_mapping.m_size);
+    } else if (m_fd == -1) { // anonymous mapping
 #ifdef __linux__
         m_addr = ::mremap(m_addr, m_size, new_size, MREMAP_MAYMOVE);
         if (!is_valid()) {
             throw std::system_error{errno, std::system_category(), "mremap failed"};
         }
         m_size = new_size;
+        apply_advice();
 #else
         assert(false && "can't resize anonymous mappings on non-linux systems");
 #endif
@@ -629,10 +812,11 @@ inline void osmium::util::MemoryMapping::resize(std::size_t new_size) {
         unmap();
         m_size = new_size;
         resize_fd(m_fd);
-        m_addr = ::mmap(nullptr, new_size, get_protection(), get_flags(), m_fd, m_offset);
+        m_addr = ::mmap(nullptr, mapped_size(), get_protection(), get_flags(), m_fd, m_offset);
         if (!is_valid()) {
             throw std::system_error{errno, std::system_category(), "mmap (remap) failed"};
         }
+        apply_advice();
     }
 }
 
@@ -729,9 +913,10 @@ inline int last_error() noexcept {
     return static_cast<int>(GetLastError());
 }
 
-inline osmium::util::MemoryMapping::MemoryMapping(std::size_t size, MemoryMapping::mapping_mode mode, int fd, off_t offset) :
+inline osmium::util::MemoryMapping::MemoryMapping(std::size_t size, MemoryMapping::mapping_mode mode, int fd, off_t offset, memory_mapping_flags::type /*flags*/) :
     m_size(check_size(size)),
     m_offset(offset),
+    m_flags(memory_mapping_flags::none),
     m_fd(resize_fd(fd)),
     m_mapping_mode(mode),
     m_handle(create_file_mapping()),
@@ -750,6 +935,7 @@ inline osmium::util::MemoryMapping::MemoryMapping(std::size_t size, MemoryMappin
 inline osmium::util::MemoryMapping::MemoryMapping(MemoryMapping&& other) noexcept :
     m_size(other.m_size),
     m_offset(other.m_offset),
+    m_flags(other.m_flags),
     m_fd(other.m_fd),
     m_mapping_mode(other.m_mapping_mode),
     m_handle(std::move(other.m_handle)),
@@ -767,6 +953,7 @@ inline osmium::util::MemoryMapping& osmium::util::MemoryMapping::operator=(osmiu
     }
     m_size         = other.m_size;
     m_offset       = other.m_offset;
+    m_flags        = other.m_flags;
     m_fd           = other.m_fd;
     m_mapping_mode = other.m_mapping_mode;
     m_handle       = std::move(other.m_handle);
@@ -93,6 +93,8 @@ static header_buffer_type parse_xml(std::string input) {
 
     std::atomic<std::size_t> offset{0};
 
+    const osmium::io::File file{"", "xml"};
+
     osmium::io::detail::parser_arguments args = {
         pool,
         -1,
@@ -103,7 +105,11 @@ static header_buffer_type parse_xml(std::string input) {
         osmium::osm_entity_bits::all,
         osmium::io::read_meta::yes,
         osmium::io::buffers_type::any,
-        false
+        false,
+        file,
+        osmium::io::tags_prefilter{},
+        osmium::io::location_prefilter{},
+        nullptr
     };
     osmium::io::detail::XMLParser parser{args};
     parser.parse();
@@ -1,4 +1,5 @@
 
+#include <cstdio>
 #include <cstdlib>
 #include <string>
 
@@ -40,3 +41,38 @@ inline std::string with_data_dir(const char* filename) {
     return result;
 }
 
+
+// A file in the temporary directory which is removed when this object
+// goes out of scope. Used for tests that have to write big files.
+class temp_file {
+
+    std::string m_filename;
+
+public:
+
+    explicit temp_file(const char* name) {
+#ifndef _WIN32
+        const char* dir = getenv("TMPDIR");
+        m_filename = dir ? dir : "/tmp";
+        m_filename += '/';
+        m_filename += std::to_string(getpid());
+        m_filename += '-';
+#endif
+        m_filename += name;
+    }
+
+    temp_file(const temp_file&) = delete;
+    temp_file& operator=(const temp_file&) = delete;
+
+    temp_file(temp_file&&) = delete;
+    temp_file& operator=(temp_file&&) = delete;
+
+    ~temp_file() noexcept {
+        std::remove(m_filename.c_str());
+    }
+
+    const std::string& name() const noexcept {
+        return m_filename;
+    }
+
+}; // class temp_file
@@ -0,0 +1,177 @@
+#include "catch.hpp"
+
+#include "utils.hpp"
+
+#include <osmium/builder/attr.hpp>
+#include <osmium/handler.hpp>
+#include <osmium/io/xml_input.hpp>
+#include <osmium/memory/buffer.hpp>
+#include <osmium/osm/node.hpp>
+#include <osmium/parallel_visitor.hpp>
+#include <osmium/thread/pool.hpp>
+
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+    class CountHandler : public osmium::handler::Handler {
+
+    public:
+
+        int nodes = 0;
+        int ways = 0;
+        int relations = 0;
+        bool flushed = false;
+
+        void node(const osmium::Node& /*node*/) noexcept {
+            ++nodes;
+        }
+
+        void way(const osmium::Way& /*way*/) noexcept {
+            ++ways;
+        }
+
+        void relation(const osmium::Relation& /*relation*/) noexcept {
+            ++relations;
+        }
+
+        void flush() noexcept {
+            flushed = true;
+        }
+
+    }; // class CountHandler
+
+    // Removes all nodes with odd IDs.
+    class FilterHandler : public osmium::handler::Handler {
+
+    public:
+
+        void node(osmium::Node& node) noexcept {
+            if (node.id() % 2 == 1) {
+                node.set_removed(true);
+            }
+        }
+
+    }; // class FilterHandler
+
+    class ThrowHandler : public osmium::handler::Handler {
+
+    public:
+
+        void node(const osmium::Node& node) {
+            if (node.id() == 55) {
+                throw std::runtime_error{"test"};
+            }
+        }
+
+    }; // class ThrowHandler
+
+    // Source for apply_parallel() returning a number of buffers with
+    // ten nodes each.
+    class BufferSource {
+
+        int m_num_buffers;
+        int m_next = 0;
+
+    public:
+
+        explicit BufferSource(int num_buffers) :
+            m_num_buffers(num_buffers) {
+        }
+
+        osmium::memory::Buffer read() {
+            if (m_next == m_num_buffers) {
+                return osmium::memory::Buffer{};
+            }
+            osmium::memory::Buffer buffer{1024, osmium::memory::Buffer::auto_grow::yes};
+            for (int i = 0; i < 10; ++i) {
+                osmium::builder::add_node(buffer, osmium::builder::attr::_id(m_next * 10 + i));
+            }
+            ++m_next;
+            return buffer;
+        }
+
+    }; // class BufferSource
+
+} // anonymous namespace
+
+TEST_CASE("apply_parallel on reader") {
+    const osmium::io::File file{with_data_dir("t/relations/data.osm")};
+    osmium::io::Reader reader{file};
+
+    osmium::thread::Pool pool{2};
+    CountHandler total;
+    int num_handlers = 0;
+
+    osmium::apply_parallel(reader,
+        []() { return CountHandler{}; },
+        [&](const CountHandler& handler) {
+            REQUIRE(handler.flushed);
+            total.nodes += handler.nodes;
+            total.ways += handler.ways;
+            total.relations += handler.relations;
+            ++num_handlers;
+        },
+        pool);
+
+    REQUIRE(total.nodes == 5);
+    REQUIRE(total.ways == 2);
+    REQUIRE(total.relations == 3);
+    REQUIRE(num_handlers >= 1);
+}
+
+TEST_CASE("apply_parallel with many buffers") {
+    BufferSource source{100};
+
+    osmium::thread::Pool pool{4};
+    int nodes = 0;
+    int num_handlers = 0;
+
+    osmium::apply_parallel(source,
+        []() { return CountHandler{}; },
+        [&](const CountHandler& handler) {
+            nodes += handler.nodes;
+            ++num_handlers;
+        },
+        pool);
+
+    REQUIRE(nodes == 1000);
+    REQUIRE(num_handlers >= 1);
+    REQUIRE(num_handlers <= 5);
+}
+
+TEST_CASE("apply_parallel_ordered keeps order of buffers") {
+    BufferSource source{100};
+
+    osmium::thread::Pool pool{4};
+    std::vector<osmium::object_id_type> ids;
+
+    osmium::apply_parallel_ordered(source,
+        []() { return FilterHandler{}; },
+        [](const FilterHandler& /*handler*/) {},
+        [&](osmium::memory::Buffer&& buffer) {
+            buffer.purge_removed();
+            for (const auto& node : buffer.select<osmium::Node>()) {
+                ids.push_back(node.id());
+            }
+        },
+        pool);
+
+    REQUIRE(ids.size() == 500);
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        REQUIRE(ids[i] == static_cast<osmium::object_id_type>(i * 2));
+    }
+}
+
+TEST_CASE("apply_parallel with exception in handler") {
+    BufferSource source{20};
+
+    osmium::thread::Pool pool{2};
+
+    REQUIRE_THROWS_AS(osmium::apply_parallel(source,
+        []() { return ThrowHandler{}; },
+        [](const ThrowHandler& /*handler*/) {},
+        pool), std::runtime_error);
+}
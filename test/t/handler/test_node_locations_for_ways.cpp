@@ -0,0 +1,162 @@
+#include "catch.hpp"
+
+#include <osmium/builder/attr.hpp>
+#include <osmium/handler/node_locations_for_ways.hpp>
+#include <osmium/index/map/compressed_mem.hpp>
+#include <osmium/index/map/dense_mem_array.hpp>
+#include <osmium/index/map/flex_mem.hpp>
+#include <osmium/index/map/sparse_mem_array.hpp>
+#include <osmium/memory/buffer.hpp>
+#include <osmium/osm/way.hpp>
+#include <osmium/thread/pool.hpp>
+#include <osmium/visitor.hpp>
+
+using namespace osmium::builder::attr; // NOLINT(google-build-using-namespace)
+
+namespace {
+
+    osmium::memory::Buffer create_test_buffer() {
+        osmium::memory::Buffer buffer{10240};
+
+        osmium::builder::add_node(buffer, _id(-2), _location(-2.0, -2.0));
+        for (osmium::object_id_type id = 1; id <= 100; ++id) {
+            osmium::builder::add_node(buffer, _id(id), _location(static_cast<double>(id) / 10, 1.0));
+        }
+
+        osmium::builder::add_way(buffer, _id(1), _nodes({1, 2, 3, 99}));
+        osmium::builder::add_way(buffer, _id(2), _nodes({100, -2, 50, 17, 1}));
+
+        return buffer;
+    }
+
+} // anonymous namespace
+
+template <typename TIndex>
+void test_node_locations_for_ways() {
+    using dense_index_type = osmium::index::map::DenseMemArray<osmium::unsigned_object_id_type, osmium::Location>;
+
+    auto buffer = create_test_buffer();
+
+    TIndex index_pos;
+    dense_index_type index_neg;
+    osmium::handler::NodeLocationsForWays<TIndex, dense_index_type> handler{index_pos, index_neg};
+
+    osmium::apply(buffer, handler);
+
+    auto it = buffer.select<osmium::Way>().begin();
+    REQUIRE(it->nodes()[0].location() == osmium::Location(0.1, 1.0));
+    REQUIRE(it->nodes()[1].location() == osmium::Location(0.2, 1.0));
+    REQUIRE(it->nodes()[2].location() == osmium::Location(0.3, 1.0));
+    REQUIRE(it->nodes()[3].location() == osmium::Location(9.9, 1.0));
+
+    ++it;
+    REQUIRE(it->nodes()[0].location() == osmium::Location(10.0, 1.0));
+    REQUIRE(it->nodes()[1].location() == osmium::Location(-2.0, -2.0));
+    REQUIRE(it->nodes()[2].location() == osmium::Location(5.0, 1.0));
+    REQUIRE(it->nodes()[3].location() == osmium::Location(1.7, 1.0));
+    REQUIRE(it->nodes()[4].location() == osmium::Location(0.1, 1.0));
+}
+
+TEST_CASE("NodeLocationsForWays with dense index") {
+    test_node_locations_for_ways<osmium::index::map::DenseMemArray<osmium::unsigned_object_id_type, osmium::Location>>();
+}
+
+TEST_CASE("NodeLocationsForWays with flex mem index") {
+    test_node_locations_for_ways<osmium::index::map::FlexMem<osmium::unsigned_object_id_type, osmium::Location>>();
+}
+
+TEST_CASE("NodeLocationsForWays with compressed index") {
+    test_node_locations_for_ways<osmium::index::map::CompressedMem<osmium::unsigned_object_id_type, osmium::Location>>();
+}
+
+TEST_CASE("NodeLocationsForWays with missing node") {
+    using index_type = osmium::index::map::FlexMem<osmium::unsigned_object_id_type, osmium::Location>;
+
+    osmium::memory::Buffer buffer{10240};
+    osmium::builder::add_node(buffer, _id(1), _location(1.0, 1.0));
+    osmium::builder::add_way(buffer, _id(1), _nodes({1, 2}));
+
+    index_type index;
+    osmium::handler::NodeLocationsForWays<index_type> handler{index};
+
+    SECTION("throws") {
+        REQUIRE_THROWS_AS(osmium::apply(buffer, handler), osmium::not_found);
+    }
+
+    SECTION("ignore errors") {
+        handler.ignore_errors();
+        osmium::apply(buffer, handler);
+        const auto& way = *buffer.select<osmium::Way>().begin();
+        REQUIRE(way.nodes()[0].location() == osmium::Location(1.0, 1.0));
+        REQUIRE_FALSE(way.nodes()[1].location());
+    }
+}
+
+template <typename TIndex>
+void test_handle_buffer() {
+    using index_type = TIndex;
+
+    osmium::memory::Buffer buffer{1024 * 1024};
+    for (osmium::object_id_type id = 1; id <= 1000; ++id) {
+        osmium::builder::add_node(buffer, _id(id), _location(static_cast<double>(id) / 100, 1.0));
+    }
+    for (osmium::object_id_type id = 1; id <= 5000; ++id) {
+        osmium::builder::add_way(buffer, _id(id), _nodes({id % 1000 + 1, (id * 7) % 1000 + 1}));
+    }
+    // a node after the ways
+    osmium::builder::add_node(buffer, _id(1001), _location(10.01, 1.0));
+    osmium::builder::add_way(buffer, _id(5001), _nodes({1001, 1}));
+
+    osmium::thread::Pool pool{4};
+    index_type index;
+    osmium::handler::NodeLocationsForWays<index_type> handler{index};
+
+    handler.handle_buffer(buffer, pool);
+
+    for (const auto& way : buffer.select<osmium::Way>()) {
+        for (const auto& node_ref : way.nodes()) {
+            REQUIRE(node_ref.location() == osmium::Location(static_cast<double>(node_ref.ref()) / 100, 1.0));
+        }
+    }
+}
+
+TEST_CASE("NodeLocationsForWays on whole buffer in pool with dense index") {
+    test_handle_buffer<osmium::index::map::DenseMemArray<osmium::unsigned_object_id_type, osmium::Location>>();
+}
+
+TEST_CASE("NodeLocationsForWays on whole buffer in pool with sparse index") {
+    test_handle_buffer<osmium::index::map::SparseMemArray<osmium::unsigned_object_id_type, osmium::Location>>();
+}
+
+TEST_CASE("NodeLocationsForWays on whole buffer with missing node") {
+    using index_type = osmium::index::map::DenseMemArray<osmium::unsigned_object_id_type, osmium::Location>;
+
+    osmium::memory::Buffer buffer{1024 * 1024};
+    osmium::builder::add_node(buffer, _id(1), _location(1.0, 1.0));
+    for (osmium::object_id_type id = 1; id <= 5000; ++id) {
+        osmium::builder::add_way(buffer, _id(id), _nodes({1, id == 4000 ? 2 : 1}));
+    }
+
+    osmium::thread::Pool pool{4};
+    index_type index;
+    osmium::handler::NodeLocationsForWays<index_type> handler{index};
+
+    SECTION("throws") {
+        REQUIRE_THROWS_AS(handler.handle_buffer(buffer, pool), osmium::not_found);
+    }
+
+    SECTION("ignore errors") {
+        handler.ignore_errors();
+        handler.handle_buffer(buffer, pool);
+    }
+
+    // All ways get their locations even if there is an error.
+    for (const auto& way : buffer.select<osmium::Way>()) {
+        REQUIRE(way.nodes()[0].location() == osmium::Location(1.0, 1.0));
+        if (way.id() == 4000) {
+            REQUIRE_FALSE(way.nodes()[1].location());
+        } else {
+            REQUIRE(way.nodes()[1].location() == osmium::Location(1.0, 1.0));
+        }
+    }
+}
@@ -1,5 +1,6 @@
 #include "catch.hpp"
 
+#include <osmium/index/map/compressed_mem.hpp>
 #include <osmium/index/map/dense_file_array.hpp>
 #include <osmium/index/map/dense_mem_array.hpp>
 #include <osmium/index/map/dense_mmap_array.hpp>
@@ -9,12 +10,18 @@
 #include <osmium/index/map/sparse_mem_array.hpp>
 #include <osmium/index/map/sparse_mem_map.hpp>
 #include <osmium/index/map/sparse_mmap_array.hpp>
+#include <osmium/index/detail/parallel_sort.hpp>
 #include <osmium/index/node_locations_map.hpp>
 #include <osmium/osm/location.hpp>
 #include <osmium/osm/types.hpp>
+#include <osmium/thread/pool.hpp>
 
+#include <algorithm>
+#include <fstream>
 #include <memory>
+#include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 
 static_assert(osmium::index::empty_value<osmium::Location>() == osmium::Location{}, "Empty value for location is wrong");
@@ -92,6 +99,72 @@ void test_func_real(TIndex& index) {
     REQUIRE(index.get_noexcept(100) == osmium::Location{});
 }
 
+template <typename TIndex>
+void test_func_many(TIndex& index) {
+    const osmium::Location loc1{1.2, 4.5};
+    const osmium::Location loc2{3.5, -7.2};
+
+    for (osmium::unsigned_object_id_type id = 10; id < 100; id += 3) {
+        index.set(id, (id % 2) != 0 ? loc1 : loc2);
+    }
+
+    index.sort();
+
+    std::vector<osmium::unsigned_object_id_type> ids;
+    for (osmium::unsigned_object_id_type id = 0; id < 110; ++id) {
+        ids.push_back((id * 7) % 110);
+    }
+    std::vector<osmium::Location> locations(ids.size());
+
+    index.get_many(ids.data(), locations.data(), ids.size());
+
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        REQUIRE(locations[i] == index.get_noexcept(ids[i]));
+    }
+    REQUIRE(locations[10] == loc2); // id 70
+    REQUIRE(locations[1] == osmium::Location{}); // id 7
+}
+
+template <typename TIndex>
+void test_func_set_range_concurrently(TIndex& index) {
+    constexpr const osmium::unsigned_object_id_type num_ids = 100000;
+    constexpr const int num_threads = 4;
+
+    index.grow_to(num_ids - 1);
+    REQUIRE(index.size() >= num_ids);
+
+    // Each thread sets every num_threads-th id in several calls.
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&index, t]() {
+            std::vector<osmium::unsigned_object_id_type> ids;
+            std::vector<osmium::Location> locations;
+            for (auto id = static_cast<osmium::unsigned_object_id_type>(t); id < num_ids; id += num_threads) {
+                ids.push_back(id);
+                locations.emplace_back(static_cast<int32_t>(id), static_cast<int32_t>(id) + 1);
+                if (ids.size() == 1000) {
+                    index.set_range(ids.data(), locations.data(), ids.size());
+                    ids.clear();
+                    locations.clear();
+                }
+            }
+            index.set_range(ids.data(), locations.data(), ids.size());
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (osmium::unsigned_object_id_type id = 0; id < num_ids; ++id) {
+        REQUIRE(index.get(id) == osmium::Location(static_cast<int32_t>(id), static_cast<int32_t>(id) + 1));
+    }
+
+    const osmium::unsigned_object_id_type too_large = num_ids + 1000000;
+    const osmium::Location location{1, 1};
+    REQUIRE_THROWS_AS(index.set_range(&too_large, &location, 1), std::out_of_range);
+    REQUIRE(index.get_noexcept(too_large) == osmium::Location{});
+}
+
 TEST_CASE("Map Id to location: Dummy") {
     using index_type = osmium::index::map::Dummy<osmium::unsigned_object_id_type, osmium::Location>;
 
@@ -118,6 +191,13 @@ TEST_CASE("Map Id to location: DenseMemArray") {
     test_func_real<index_type>(index2);
 }
 
+TEST_CASE("Map Id to location: DenseMemArray set_range from several threads") {
+    using index_type = osmium::index::map::DenseMemArray<osmium::unsigned_object_id_type, osmium::Location>;
+
+    index_type index;
+    test_func_set_range_concurrently<index_type>(index);
+}
+
 #ifdef __linux__
 TEST_CASE("Map Id to location: DenseMmapArray") {
     using index_type = osmium::index::map::DenseMmapArray<osmium::unsigned_object_id_type, osmium::Location>;
@@ -128,6 +208,27 @@ TEST_CASE("Map Id to location: DenseMmapArray") {
     index_type index2;
     test_func_real<index_type>(index2);
 }
+
+TEST_CASE("Map Id to location: DenseMmapArray with memory mapping flags") {
+    using index_type = osmium::index::map::DenseMmapArray<osmium::unsigned_object_id_type, osmium::Location>;
+
+    const auto flags = osmium::memory_mapping_flags::huge_pages |
+                       osmium::memory_mapping_flags::populate |
+                       osmium::memory_mapping_flags::random_access;
+
+    index_type index1{flags};
+    test_func_all<index_type>(index1);
+
+    index_type index2{flags};
+    test_func_real<index_type>(index2);
+}
+
+TEST_CASE("Map Id to location: DenseMmapArray set_range from several threads") {
+    using index_type = osmium::index::map::DenseMmapArray<osmium::unsigned_object_id_type, osmium::Location>;
+
+    index_type index;
+    test_func_set_range_concurrently<index_type>(index);
+}
 #else
 # pragma message("not running 'DenseMmapArray' test case on this machine")
 #endif
@@ -182,6 +283,46 @@ TEST_CASE("Map Id to location: SparseMmapArray") {
 # pragma message("not running 'SparseMmapArray' test case on this machine")
 #endif
 
+TEST_CASE("Map Id to location: SparseMemArray sorted in pool") {
+    using index_type = osmium::index::map::SparseMemArray<osmium::unsigned_object_id_type, osmium::Location>;
+
+    constexpr const osmium::unsigned_object_id_type num_ids = 1000000;
+    const auto location_for = [](osmium::unsigned_object_id_type id) {
+        return osmium::Location{static_cast<int32_t>(id), static_cast<int32_t>(id % 1000)};
+    };
+
+    osmium::thread::Pool pool{4};
+    index_type index;
+
+    SECTION("unsorted") {
+        for (osmium::unsigned_object_id_type n = 0; n < num_ids; ++n) {
+            const auto id = (n * 7919) % num_ids;
+            index.set(id, location_for(id));
+        }
+    }
+
+    SECTION("sorted") {
+        for (osmium::unsigned_object_id_type id = 0; id < num_ids; ++id) {
+            index.set(id, location_for(id));
+        }
+    }
+
+    SECTION("partly sorted") {
+        for (osmium::unsigned_object_id_type id = 0; id < num_ids; ++id) {
+            const auto rotated_id = (id + num_ids / 2) % num_ids;
+            index.set(rotated_id, location_for(rotated_id));
+        }
+    }
+
+    osmium::index::sort(index, pool);
+
+    REQUIRE(index.size() == num_ids);
+    REQUIRE(std::is_sorted(index.cbegin(), index.cend()));
+    for (osmium::unsigned_object_id_type id = 0; id < num_ids; id += 997) {
+        REQUIRE(index.get(id) == location_for(id));
+    }
+}
+
 TEST_CASE("Map Id to location: FlexMem sparse") {
     using index_type = osmium::index::map::FlexMem<osmium::unsigned_object_id_type, osmium::Location>;
 
@@ -234,6 +375,58 @@ TEST_CASE("Map Id to location: FlexMem switch") {
     REQUIRE(index.get_noexcept(2000000000) == osmium::Location{});
 }
 
+TEST_CASE("Map Id to location: CompressedMem") {
+    using index_type = osmium::index::map::CompressedMem<osmium::unsigned_object_id_type, osmium::Location>;
+
+    index_type index1;
+    test_func_all<index_type>(index1);
+
+    index_type index2;
+    test_func_real<index_type>(index2);
+}
+
+TEST_CASE("Map Id to location: CompressedMem with many locations") {
+    using index_type = osmium::index::map::CompressedMem<osmium::unsigned_object_id_type, osmium::Location>;
+
+    const auto location_for = [](osmium::unsigned_object_id_type id) {
+        if (id % 7 == 0) {
+            return osmium::Location{};
+        }
+        if (id % 1000 == 1) { // some far away locations
+            return osmium::Location{-179.9999999, 89.9999999};
+        }
+        return osmium::Location{static_cast<int32_t>(id * 37 % 100000), -static_cast<int32_t>(id * 13 % 5000)};
+    };
+
+    index_type index;
+    for (osmium::unsigned_object_id_type id = 0; id < 10000; ++id) {
+        index.set(id, location_for(id));
+    }
+    index.set(100000, osmium::Location{1.5, 2.5});
+
+    // set some locations out of order into blocks already compressed
+    index.set(3, osmium::Location{4.5, 5.5});
+    index.set(700, osmium::Location{-4.5, -5.5});
+
+    index.sort();
+
+    REQUIRE(index.size() >= 100001);
+    REQUIRE(index.used_memory() < 10000 * sizeof(osmium::Location));
+
+    for (osmium::unsigned_object_id_type id = 0; id < 10000; ++id) {
+        if (id == 3) {
+            REQUIRE(index.get(id) == osmium::Location(4.5, 5.5));
+        } else if (id == 700) {
+            REQUIRE(index.get(id) == osmium::Location(-4.5, -5.5));
+        } else {
+            REQUIRE(index.get_noexcept(id) == location_for(id));
+        }
+    }
+    REQUIRE(index.get(100000) == osmium::Location(1.5, 2.5));
+    REQUIRE(index.get_noexcept(100001) == osmium::Location{});
+    REQUIRE(index.get_noexcept(200000) == osmium::Location{});
+}
+
 TEST_CASE("Map Id to location: Dynamic map choice") {
     using map_type = osmium::index::map::Map<osmium::unsigned_object_id_type, osmium::Location>;
     const auto& map_factory = osmium::index::MapFactory<osmium::unsigned_object_id_type, osmium::Location>::instance();
@@ -254,6 +447,34 @@ TEST_CASE("Map Id to location: Dynamic map choice") {
         std::unique_ptr<map_type> index2 = map_factory.create_map(map_type_name);
         index2->reserve(1000);
         test_func_real<map_type>(*index2);
+
+        std::unique_ptr<map_type> index3 = map_factory.create_map(map_type_name);
+        index3->reserve(1000);
+        test_func_many<map_type>(*index3);
     }
 }
 
+#ifdef __linux__
+TEST_CASE("Map Id to location: Dynamic map choice with memory mapping flags") {
+    using map_type = osmium::index::map::Map<osmium::unsigned_object_id_type, osmium::Location>;
+    const auto& map_factory = osmium::index::MapFactory<osmium::unsigned_object_id_type, osmium::Location>::instance();
+
+    REQUIRE_THROWS_AS(map_factory.create_map("dense_mmap_array,foo"), osmium::map_factory_error);
+    REQUIRE_THROWS_WITH(map_factory.create_map("sparse_mmap_array,huge_pages,foo"), "Unknown map option 'foo'");
+
+    const char* map_type_name = GENERATE("dense_mmap_array,huge_pages,random_access",
+                                         "sparse_mmap_array,populate,will_need",
+                                         "dense_file_array,huge_pages",
+                                         "sparse_file_array,random_access,will_need");
+
+    std::unique_ptr<map_type> index1 = map_factory.create_map(map_type_name);
+    test_func_all<map_type>(*index1);
+
+    std::unique_ptr<map_type> index2 = map_factory.create_map(map_type_name);
+    test_func_real<map_type>(*index2);
+
+    // Flags in place of the file name use a temporary file.
+    REQUIRE_FALSE(std::ifstream{"huge_pages"});
+    REQUIRE_FALSE(std::ifstream{"random_access"});
+}
+#endif
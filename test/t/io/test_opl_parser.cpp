@@ -7,7 +7,9 @@
 #include <osmium/opl.hpp>
 
 #include <algorithm>
+#include <cstdint>
 #include <cstring>
+#include <fstream>
 #include <initializer_list>
 #include <string>
 #include <vector>
@@ -1307,3 +1309,113 @@ TEST_CASE("line_by_line for OPL parser 28") {
     check_lbl({"foo\nb", "ar"}, {"foo", "bar"});
 }
 
+
+TEST_CASE("count_opl_lines") {
+    REQUIRE(osmium::io::detail::count_opl_lines("") == 0);
+    REQUIRE(osmium::io::detail::count_opl_lines("\n\n") == 0);
+    REQUIRE(osmium::io::detail::count_opl_lines("n1") == 1);
+    REQUIRE(osmium::io::detail::count_opl_lines("n1\nn2\n") == 2);
+    REQUIRE(osmium::io::detail::count_opl_lines("n1\r\nn2\r\n\nn3") == 3);
+}
+
+namespace {
+
+    // Write an OPL file big enough to be split into several chunks.
+    // If error_line is not 0, that line will contain an error.
+    void write_big_opl_file(const std::string& filename, int error_line = 0) {
+        std::ofstream file{filename, std::ios::binary};
+        for (int i = 1; i <= 100000; ++i) {
+            if (i == error_line) {
+                file << "x" << i << '\n';
+            } else if (i % 10 == 0) {
+                file << "w" << i << " v1 dV Tname=way%20%" << i << " Nn" << i << ",n" << (i + 1) << "\r\n";
+            } else {
+                file << "n" << i << " v" << (i % 5 + 1) << " dV c0 t2020-01-01T00:00:00Z i1 ufoo Thighway=bus_stop,name=Stop%20%" << i << " x1.5 y" << (i % 90) << "\n";
+            }
+            if (i % 1000 == 0) {
+                file << "\n";
+            }
+        }
+    }
+
+    std::vector<std::string> read_opl_objects(const osmium::io::File& file, std::size_t* num_buffers = nullptr) {
+        std::vector<std::string> objects;
+        osmium::io::Reader reader{file};
+        while (const osmium::memory::Buffer buffer = reader.read()) {
+            if (num_buffers) {
+                ++*num_buffers;
+            }
+            for (const auto& object : buffer.select<osmium::OSMObject>()) {
+                std::string str{osmium::item_type_to_char(object.type())};
+                str += std::to_string(object.id());
+                str += 'v';
+                str += std::to_string(object.version());
+                for (const auto& tag : object.tags()) {
+                    str += ' ';
+                    str += tag.key();
+                    str += '=';
+                    str += tag.value();
+                }
+                objects.push_back(std::move(str));
+            }
+        }
+        reader.close();
+        return objects;
+    }
+
+} // anonymous namespace
+
+TEST_CASE("Parallel OPL parsing gives same result as sequential parsing") {
+    const temp_file tmp{"test-opl-parallel.opl"};
+    write_big_opl_file(tmp.name());
+
+    osmium::io::File file{tmp.name()};
+    osmium::io::File file_parallel{tmp.name()};
+    file_parallel.set("opl_parallel");
+
+    const auto expected = read_opl_objects(file);
+    std::size_t num_buffers = 0;
+    const auto result = read_opl_objects(file_parallel, &num_buffers);
+
+    REQUIRE(expected.size() == 100000);
+    REQUIRE(result == expected);
+    REQUIRE(num_buffers > 1);
+}
+
+TEST_CASE("Parallel OPL parsing reports correct line numbers") {
+    const temp_file tmp{"test-opl-parallel-error.opl"};
+    write_big_opl_file(tmp.name(), 90000);
+
+    const auto error_line = [&](bool parallel) {
+        osmium::io::File file{tmp.name()};
+        if (parallel) {
+            file.set("opl_parallel");
+        }
+        osmium::io::Reader reader{file};
+        uint64_t line = 0;
+        const auto read_all = [&]() {
+            try {
+                while (reader.read()) {
+                }
+            } catch (const osmium::opl_error& e) {
+                line = e.line;
+                throw;
+            }
+        };
+        REQUIRE_THROWS_AS(read_all(), osmium::opl_error);
+        reader.close();
+        return line;
+    };
+
+    REQUIRE(error_line(false) == 89999);
+    REQUIRE(error_line(true) == 89999);
+}
+
+TEST_CASE("Parallel OPL parsing of small file") {
+    osmium::io::File file{with_data_dir("t/io/data.opl")};
+    file.set("opl_parallel");
+
+    const auto result = read_opl_objects(file);
+    REQUIRE_FALSE(result.empty());
+    REQUIRE(result == read_opl_objects(osmium::io::File{with_data_dir("t/io/data.opl")}));
+}
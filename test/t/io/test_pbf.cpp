@@ -2,9 +2,28 @@
 
 #include "utils.hpp"
 
+#include <osmium/builder/attr.hpp>
+#include <osmium/io/location_prefilter.hpp>
+#include <osmium/io/opl_output.hpp>
 #include <osmium/io/pbf_input.hpp>
+#include <osmium/io/pbf_output.hpp>
 #include <osmium/io/reader.hpp>
+#include <osmium/io/writer.hpp>
+#include <osmium/io/xml_input.hpp>
+#include <osmium/memory/buffer_pool.hpp>
 #include <osmium/osm/object.hpp>
+#include <osmium/thread/pool.hpp>
+#include <osmium/util/file.hpp>
+
+#include <protozero/pbf_builder.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 TEST_CASE("Get supported PBF compression types") {
     const auto types = osmium::io::supported_pbf_compression_types();
@@ -50,3 +69,642 @@ TEST_CASE("Read PBF file with version=-1 and changeset=-1 and DenseNodes (writte
     REQUIRE(object.version() == 0);
     REQUIRE(object.changeset() == 0);
 }
+
+namespace {
+
+    void write_pbf_test_file(const std::string& filename, const char* compression, const char* options = "pbf") {
+        osmium::io::File file{filename, options};
+        file.set("pbf_compression", compression);
+
+        osmium::io::Reader reader{with_data_dir("t/io/data-n5w1r3.osm")};
+        osmium::io::Writer writer{file, reader.header(), osmium::io::overwrite::allow};
+        while (osmium::memory::Buffer buffer = reader.read()) {
+            writer(std::move(buffer));
+        }
+        writer.close();
+        reader.close();
+    }
+
+    std::size_t count_objects(const osmium::io::File& file, osmium::osm_entity_bits::type entities) {
+        osmium::io::Reader reader{file, entities};
+        std::size_t count = 0;
+        while (const osmium::memory::Buffer buffer = reader.read()) {
+            count += std::distance(buffer.cbegin<osmium::OSMObject>(), buffer.cend<osmium::OSMObject>());
+        }
+        reader.close();
+        return count;
+    }
+
+    std::string read_whole_file(const char* filename) {
+        const int fd = osmium::io::detail::open_for_reading(filename);
+        std::string data(osmium::util::file_size(fd), '\0');
+        REQUIRE(osmium::io::detail::read_exactly(fd, &*data.begin(), static_cast<unsigned int>(data.size())));
+        osmium::io::detail::reliable_close(fd);
+        return data;
+    }
+
+} // anonymous namespace
+
+TEST_CASE("Write and read PBF file with all supported compression types") {
+    for (const auto& compression : osmium::io::supported_pbf_compression_types()) {
+        const std::string filename{"test-pbf-compression-" + compression + ".osm.pbf"};
+        write_pbf_test_file(filename, compression.c_str());
+        REQUIRE(count_objects(osmium::io::File{filename}, osmium::osm_entity_bits::all) == 9);
+    }
+}
+
+TEST_CASE("Write PBF file with parallel encoding") {
+    const char* options = GENERATE("pbf", "pbf,pbf_dense_nodes=false", "pbf,add_metadata=false");
+    const std::string parallel_options{std::string{options} + ",pbf_parallel_encoding=true"};
+
+    write_pbf_test_file("test-pbf-sequential.osm.pbf", "zlib", options);
+    write_pbf_test_file("test-pbf-parallel.osm.pbf", "zlib", parallel_options.c_str());
+
+    osmium::io::File file{"test-pbf-parallel.osm.pbf"};
+    REQUIRE(count_objects(file, osmium::osm_entity_bits::all) == 9);
+    REQUIRE(count_objects(file, osmium::osm_entity_bits::node) == 5);
+    REQUIRE(count_objects(file, osmium::osm_entity_bits::way) == 1);
+    REQUIRE(count_objects(file, osmium::osm_entity_bits::relation) == 3);
+
+    // Blocks are cut at the same places, so the files are identical.
+    REQUIRE(read_whole_file("test-pbf-sequential.osm.pbf") == read_whole_file("test-pbf-parallel.osm.pbf"));
+}
+
+TEST_CASE("Write PBF file with parallel encoding and many blocks") {
+    using namespace osmium::builder::attr; // NOLINT(google-build-using-namespace)
+
+    osmium::memory::Buffer buffer{1024 * 1024, osmium::memory::Buffer::auto_grow::yes};
+    for (osmium::object_id_type id = 1; id <= 20000; ++id) {
+        osmium::builder::add_node(buffer, _id(id), _version(1), _location(id * 0.0001, 1.0), _tag("n", std::to_string(id)));
+    }
+    for (osmium::object_id_type id = 1; id <= 10000; ++id) {
+        osmium::builder::add_way(buffer, _id(id), _version(1), _nodes({id, id + 1}));
+    }
+
+    for (const char* filename : {"test-pbf-many-sequential.osm.pbf", "test-pbf-many-parallel.osm.pbf"}) {
+        osmium::io::File file{filename, "pbf"};
+        if (filename == std::string{"test-pbf-many-parallel.osm.pbf"}) {
+            file.set("pbf_parallel_encoding");
+        }
+        osmium::io::Writer writer{file, osmium::io::overwrite::allow};
+        // write in several buffers, so ranges span buffer boundaries
+        osmium::memory::Buffer part{1024 * 1024, osmium::memory::Buffer::auto_grow::yes};
+        std::size_t n = 0;
+        for (const auto& object : buffer.select<osmium::OSMObject>()) {
+            part.add_item(object);
+            part.commit();
+            if (++n % 3001 == 0) {
+                writer(std::move(part));
+                part = osmium::memory::Buffer{1024 * 1024, osmium::memory::Buffer::auto_grow::yes};
+            }
+        }
+        writer(std::move(part));
+        writer.close();
+    }
+
+    osmium::io::File file{"test-pbf-many-parallel.osm.pbf"};
+    REQUIRE(count_objects(file, osmium::osm_entity_bits::node) == 20000);
+    REQUIRE(count_objects(file, osmium::osm_entity_bits::way) == 10000);
+
+    file.set("pbf_blob_index");
+    REQUIRE(count_objects(file, osmium::osm_entity_bits::nwr) == 30000);
+
+    REQUIRE(read_whole_file("test-pbf-many-sequential.osm.pbf") == read_whole_file("test-pbf-many-parallel.osm.pbf"));
+}
+
+TEST_CASE("Write PBF file with string table sorted by frequency") {
+    const char* options = GENERATE("pbf", "pbf,pbf_dense_nodes=false", "pbf,pbf_parallel_encoding=true");
+    const std::string sorted_options{std::string{options} + ",pbf_stringtable_sort=frequency"};
+
+    write_pbf_test_file("test-pbf-unsorted.osm.pbf", "none", options);
+    write_pbf_test_file("test-pbf-sorted.osm.pbf", "none", sorted_options.c_str());
+
+    // Same objects in both files...
+    for (const char* filename : {"test-pbf-unsorted", "test-pbf-sorted"}) {
+        osmium::io::Reader reader{std::string{filename} + ".osm.pbf"};
+        osmium::io::Writer writer{std::string{filename} + ".opl", osmium::io::overwrite::allow};
+        while (osmium::memory::Buffer buffer = reader.read()) {
+            writer(std::move(buffer));
+        }
+        writer.close();
+        reader.close();
+    }
+    REQUIRE(read_whole_file("test-pbf-unsorted.opl") == read_whole_file("test-pbf-sorted.opl"));
+
+    // ...but encoded differently.
+    REQUIRE(read_whole_file("test-pbf-unsorted.osm.pbf") != read_whole_file("test-pbf-sorted.osm.pbf"));
+}
+
+TEST_CASE("Read PBF file with tags prefilter") {
+    using namespace osmium::builder::attr; // NOLINT(google-build-using-namespace)
+
+    const char* options = GENERATE("pbf", "pbf,pbf_dense_nodes=false");
+
+    osmium::memory::Buffer buffer{1024 * 1024, osmium::memory::Buffer::auto_grow::yes};
+    for (osmium::object_id_type id = 1; id <= 3000; ++id) {
+        const std::string user{"user" + std::to_string(id % 7)};
+        if (id % 100 == 0) {
+            osmium::builder::add_node(buffer, _id(id), _version(id % 5 + 1), _cid(id * 2), _uid(id), _user(user), _timestamp(1500000000 + id),
+                                      _location(id * 0.001, 1.0), _tag("amenity", "cafe"), _tag("name", std::to_string(id)));
+        } else if (id % 3 == 0) {
+            osmium::builder::add_node(buffer, _id(id), _version(id % 5 + 1), _cid(id * 2), _uid(id), _user(user), _timestamp(1500000000 + id),
+                                      _location(id * 0.001, 1.0), _tag("name", std::to_string(id)));
+        } else {
+            osmium::builder::add_node(buffer, _id(id), _version(id % 5 + 1), _cid(id * 2), _uid(id), _user(user), _timestamp(1500000000 + id),
+                                      _location(id * 0.001, 1.0));
+        }
+    }
+    for (osmium::object_id_type id = 1; id <= 100; ++id) {
+        osmium::builder::add_way(buffer, _id(id), _version(1), _nodes({id, id + 1}), _tag(id % 10 == 0 ? "amenity" : "highway", "x"));
+    }
+    osmium::builder::add_relation(buffer, _id(1), _version(1), _member(osmium::item_type::way, 1), _tag("amenity", "y"));
+    osmium::builder::add_relation(buffer, _id(2), _version(1), _member(osmium::item_type::way, 2), _tag("type", "route"));
+
+    {
+        osmium::io::Writer writer{osmium::io::File{"test-pbf-prefilter.osm.pbf", options}, osmium::io::overwrite::allow};
+        writer(std::move(buffer));
+        writer.close();
+    }
+
+    const auto is_amenity = [](const char* key, const char* /*value*/) {
+        return !std::strcmp(key, "amenity");
+    };
+    const osmium::io::File file{"test-pbf-prefilter.osm.pbf"};
+
+    // Read the file with the filter in the reader or, to get the
+    // expected result, without it and filtering afterwards.
+    const auto read_to_opl = [&](const char* opl_filename, const osmium::io::tags_prefilter& filter, bool filter_in_reader) {
+        osmium::io::Reader reader{file, filter_in_reader ? filter : osmium::io::tags_prefilter{}};
+        osmium::io::Writer writer{opl_filename, osmium::io::overwrite::allow};
+        while (osmium::memory::Buffer buffer = reader.read()) {
+            if (!filter_in_reader) {
+                for (auto& object : buffer.select<osmium::OSMObject>()) {
+                    if ((filter.entities() & osmium::osm_entity_bits::from_item_type(object.type())) &&
+                        std::none_of(object.tags().cbegin(), object.tags().cend(), [&](const osmium::Tag& tag) {
+                            return is_amenity(tag.key(), tag.value());
+                        })) {
+                        object.set_removed(true);
+                    }
+                }
+                buffer.purge_removed();
+            }
+            writer(std::move(buffer));
+        }
+        writer.close();
+        reader.close();
+    };
+
+    SECTION("Filter all object types") {
+        const osmium::io::tags_prefilter filter{is_amenity};
+        read_to_opl("test-pbf-prefilter-expected.opl", filter, false);
+        read_to_opl("test-pbf-prefilter.opl", filter, true);
+        REQUIRE(count_objects(file, osmium::osm_entity_bits::nwr) == 3102);
+        REQUIRE(read_whole_file("test-pbf-prefilter.opl") == read_whole_file("test-pbf-prefilter-expected.opl"));
+    }
+
+    SECTION("Filter nodes only") {
+        const osmium::io::tags_prefilter filter{is_amenity, osmium::osm_entity_bits::node};
+        read_to_opl("test-pbf-prefilter-expected.opl", filter, false);
+        read_to_opl("test-pbf-prefilter.opl", filter, true);
+        REQUIRE(read_whole_file("test-pbf-prefilter.opl") == read_whole_file("test-pbf-prefilter-expected.opl"));
+    }
+
+    SECTION("Filter with read_meta::no") {
+        const osmium::io::tags_prefilter filter{is_amenity};
+        osmium::io::Reader reader{file, filter, osmium::io::read_meta::no};
+        std::size_t count = 0;
+        while (const osmium::memory::Buffer buffer = reader.read()) {
+            for (const auto& object : buffer.select<osmium::OSMObject>()) {
+                REQUIRE(object.tags().has_key("amenity"));
+                ++count;
+            }
+        }
+        reader.close();
+        REQUIRE(count == 30 + 10 + 1);
+    }
+}
+
+TEST_CASE("Location prefilter") {
+    SECTION("Empty filter") {
+        const osmium::io::location_prefilter filter;
+        REQUIRE(filter.empty());
+    }
+
+    SECTION("Invalid box") {
+        REQUIRE_THROWS_AS(osmium::io::location_prefilter{osmium::Box{}}, std::invalid_argument);
+    }
+
+    SECTION("Box") {
+        const osmium::io::location_prefilter filter{osmium::Box{1.0, 2.0, 3.0, 4.0}};
+        REQUIRE_FALSE(filter.empty());
+        REQUIRE(filter.contains(osmium::Location{2.0, 3.0}));
+        REQUIRE(filter.contains(osmium::Location{1.0, 4.0}));
+        REQUIRE_FALSE(filter.contains(osmium::Location{0.5, 3.0}));
+        REQUIRE_FALSE(filter.contains(osmium::Location{2.0, 4.5}));
+        REQUIRE(filter.contains(osmium::Location{}));
+    }
+
+    SECTION("Polygon") {
+        // L-shaped polygon, the last location closes the ring
+        const osmium::io::location_prefilter filter{std::vector<osmium::Location>{
+            {0.0, 0.0}, {2.0, 0.0}, {2.0, 1.0}, {1.0, 1.0}, {1.0, 2.0}, {0.0, 2.0}, {0.0, 0.0}
+        }};
+        REQUIRE(filter.box() == osmium::Box(0.0, 0.0, 2.0, 2.0));
+        REQUIRE(filter.contains(osmium::Location{0.5, 0.5}));
+        REQUIRE(filter.contains(osmium::Location{1.5, 0.5}));
+        REQUIRE(filter.contains(osmium::Location{0.5, 1.5}));
+        REQUIRE(filter.contains(osmium::Location{1.0, 1.5}));
+        REQUIRE(filter.contains(osmium::Location{2.0, 0.0}));
+        REQUIRE_FALSE(filter.contains(osmium::Location{1.5, 1.5}));
+        REQUIRE_FALSE(filter.contains(osmium::Location{3.0, 0.5}));
+    }
+
+    SECTION("Polygon with too few locations") {
+        REQUIRE_THROWS_AS(osmium::io::location_prefilter(std::vector<osmium::Location>{{0.0, 0.0}, {1.0, 1.0}, {0.0, 0.0}}), std::invalid_argument);
+    }
+
+    SECTION("Polygon with invalid location") {
+        REQUIRE_THROWS_AS(osmium::io::location_prefilter(std::vector<osmium::Location>{{0.0, 0.0}, {1.0, 1.0}, osmium::Location{}}), std::invalid_argument);
+    }
+}
+
+TEST_CASE("Read PBF file with location prefilter") {
+    using namespace osmium::builder::attr; // NOLINT(google-build-using-namespace)
+
+    const char* options = GENERATE("pbf", "pbf,pbf_dense_nodes=false");
+
+    osmium::memory::Buffer buffer{1024 * 1024, osmium::memory::Buffer::auto_grow::yes};
+    for (osmium::object_id_type id = 1; id <= 3000; ++id) {
+        const std::string user{"user" + std::to_string(id % 7)};
+        const osmium::Location location{(id % 60) * 0.1, (id / 60) * 0.1};
+        if (id % 100 == 0) {
+            osmium::builder::add_node(buffer, _id(id), _version(id % 5 + 1), _cid(id * 2), _uid(id), _user(user), _timestamp(1500000000 + id),
+                                      _location(location), _tag("amenity", "cafe"), _tag("name", std::to_string(id)));
+        } else if (id % 13 == 0) {
+            osmium::builder::add_node(buffer, _id(id), _version(id % 5 + 1), _cid(id * 2), _uid(id), _user(user), _timestamp(1500000000 + id),
+                                      _deleted());
+        } else {
+            osmium::builder::add_node(buffer, _id(id), _version(id % 5 + 1), _cid(id * 2), _uid(id), _user(user), _timestamp(1500000000 + id),
+                                      _location(location), _tag("name", std::to_string(id)));
+        }
+    }
+    for (osmium::object_id_type id = 1; id <= 100; ++id) {
+        osmium::builder::add_way(buffer, _id(id), _version(1), _nodes({id, id + 1}), _tag("highway", "x"));
+    }
+
+    {
+        osmium::io::Writer writer{osmium::io::File{"test-pbf-location-prefilter.osm.pbf", std::string{options} + ",history=true"}, osmium::io::overwrite::allow};
+        writer(std::move(buffer));
+        writer.close();
+    }
+
+    const auto has_amenity = [](const char* key, const char* /*value*/) {
+        return !std::strcmp(key, "amenity");
+    };
+    const osmium::io::File file{"test-pbf-location-prefilter.osm.pbf"};
+
+    // Read the file with the filters in the reader or, to get the
+    // expected result, without them and filtering afterwards.
+    const auto read_to_opl = [&](const char* opl_filename, const osmium::io::location_prefilter& filter, const osmium::io::tags_prefilter& tags_filter, bool filter_in_reader) {
+        osmium::io::Reader reader{file,
+                                  filter_in_reader ? filter : osmium::io::location_prefilter{},
+                                  filter_in_reader ? tags_filter : osmium::io::tags_prefilter{}};
+        osmium::io::Writer writer{opl_filename, osmium::io::overwrite::allow};
+        while (osmium::memory::Buffer buffer = reader.read()) {
+            if (!filter_in_reader) {
+                for (auto& node : buffer.select<osmium::Node>()) {
+                    // Deleted nodes are never dropped by the location
+                    // filter, but the tags filter drops them.
+                    if ((node.visible() && !filter.contains(node.location())) ||
+                        (!tags_filter.empty() && !node.tags().has_key("amenity"))) {
+                        node.set_removed(true);
+                    }
+                }
+                buffer.purge_removed();
+            }
+            writer(std::move(buffer));
+        }
+        writer.close();
+        reader.close();
+    };
+
+    SECTION("Box") {
+        const osmium::io::location_prefilter filter{osmium::Box{1.0, 1.0, 3.0, 2.0}};
+        read_to_opl("test-pbf-location-prefilter-expected.opl", filter, osmium::io::tags_prefilter{}, false);
+        read_to_opl("test-pbf-location-prefilter.opl", filter, osmium::io::tags_prefilter{}, true);
+        REQUIRE(count_objects(file, osmium::osm_entity_bits::node) == 3000);
+        REQUIRE(read_whole_file("test-pbf-location-prefilter.opl") == read_whole_file("test-pbf-location-prefilter-expected.opl"));
+    }
+
+    SECTION("Polygon") {
+        const osmium::io::location_prefilter filter{std::vector<osmium::Location>{
+            {0.5, 0.5}, {4.5, 1.0}, {2.0, 4.5}
+        }};
+        read_to_opl("test-pbf-location-prefilter-expected.opl", filter, osmium::io::tags_prefilter{}, false);
+        read_to_opl("test-pbf-location-prefilter.opl", filter, osmium::io::tags_prefilter{}, true);
+        REQUIRE(read_whole_file("test-pbf-location-prefilter.opl") == read_whole_file("test-pbf-location-prefilter-expected.opl"));
+    }
+
+    SECTION("Box and tags") {
+        const osmium::io::location_prefilter filter{osmium::Box{0.0, 0.0, 3.0, 3.0}};
+        const osmium::io::tags_prefilter tags_filter{has_amenity, osmium::osm_entity_bits::node};
+        read_to_opl("test-pbf-location-prefilter-expected.opl", filter, tags_filter, false);
+        read_to_opl("test-pbf-location-prefilter.opl", filter, tags_filter, true);
+        REQUIRE(read_whole_file("test-pbf-location-prefilter.opl") == read_whole_file("test-pbf-location-prefilter-expected.opl"));
+    }
+}
+
+TEST_CASE("Unknown value for pbf_stringtable_sort option") {
+    const osmium::io::File file{"test-pbf-sort-unknown.osm.pbf", "pbf,pbf_stringtable_sort=foo"};
+    const osmium::io::Header header;
+    REQUIRE_THROWS_AS(osmium::io::Writer(file, header, osmium::io::overwrite::allow), std::invalid_argument);
+}
+
+#ifdef OSMIUM_WITH_ZSTD
+TEST_CASE("Get zstd in supported PBF compression types") {
+    const auto types = osmium::io::supported_pbf_compression_types();
+    REQUIRE(std::find(types.cbegin(), types.cend(), "zstd") != types.cend());
+}
+
+TEST_CASE("Check zstd compression level") {
+    osmium::io::File file{"test-pbf-zstd-level.osm.pbf", "pbf,pbf_compression=zstd,pbf_compression_level=100"};
+    osmium::io::Header header;
+    REQUIRE_THROWS_AS(osmium::io::Writer(file, header, osmium::io::overwrite::allow), std::invalid_argument);
+}
+#endif
+
+TEST_CASE("Read PBF file using blob index") {
+    const char* compression = GENERATE("none", "zlib");
+    const std::string filename{std::string{"test-pbf-blob-index-"} + compression + ".osm.pbf"};
+    write_pbf_test_file(filename, compression);
+
+    osmium::io::File file{filename};
+    file.set("pbf_blob_index");
+
+    REQUIRE(count_objects(file, osmium::osm_entity_bits::all) == 9);
+    REQUIRE(count_objects(file, osmium::osm_entity_bits::node) == 5);
+    REQUIRE(count_objects(file, osmium::osm_entity_bits::way) == 1);
+    REQUIRE(count_objects(file, osmium::osm_entity_bits::relation) == 3);
+    REQUIRE(count_objects(file, osmium::osm_entity_bits::changeset) == 0);
+}
+
+TEST_CASE("Read PBF file using blob index keeps order of objects") {
+    write_pbf_test_file("test-pbf-blob-index-order.osm.pbf", "zlib");
+
+    osmium::io::File file{"test-pbf-blob-index-order.osm.pbf"};
+    file.set("pbf_blob_index");
+
+    osmium::io::Reader reader{file};
+    std::vector<osmium::item_type> types;
+    while (const osmium::memory::Buffer buffer = reader.read()) {
+        for (const auto& object : buffer.select<osmium::OSMObject>()) {
+            types.push_back(object.type());
+        }
+    }
+    reader.close();
+
+    REQUIRE(types.size() == 9);
+    REQUIRE(std::is_sorted(types.cbegin(), types.cend()));
+}
+
+TEST_CASE("Read PBF file using blob index from sidecar file") {
+    write_pbf_test_file("test-pbf-blob-index-sidecar.osm.pbf", "zlib");
+    std::remove("test-pbf-blob-index-sidecar.idx");
+
+    osmium::io::File file{"test-pbf-blob-index-sidecar.osm.pbf"};
+    file.set("pbf_blob_index_file", "test-pbf-blob-index-sidecar.idx");
+
+    // First run creates the index file...
+    REQUIRE(count_objects(file, osmium::osm_entity_bits::way) == 1);
+
+    osmium::io::detail::PBFBlobIndex blob_index;
+    int fd = osmium::io::detail::open_for_reading("test-pbf-blob-index-sidecar.osm.pbf");
+    REQUIRE(blob_index.load("test-pbf-blob-index-sidecar.idx", fd));
+    REQUIRE(blob_index.size() == 3);
+    osmium::io::detail::reliable_close(fd);
+
+    // ...second run uses it.
+    REQUIRE(count_objects(file, osmium::osm_entity_bits::nwr) == 9);
+
+    // Index doesn't fit any more if the PBF file changes.
+    write_pbf_test_file("test-pbf-blob-index-sidecar.osm.pbf", "none");
+    fd = osmium::io::detail::open_for_reading("test-pbf-blob-index-sidecar.osm.pbf");
+    REQUIRE_FALSE(blob_index.load("test-pbf-blob-index-sidecar.idx", fd));
+    osmium::io::detail::reliable_close(fd);
+
+    // It is recreated on the next run.
+    REQUIRE(count_objects(file, osmium::osm_entity_bits::nwr) == 9);
+    fd = osmium::io::detail::open_for_reading("test-pbf-blob-index-sidecar.osm.pbf");
+    REQUIRE(blob_index.load("test-pbf-blob-index-sidecar.idx", fd));
+    osmium::io::detail::reliable_close(fd);
+}
+
+TEST_CASE("Read PBF file using memory mapping") {
+    const char* compression = GENERATE("none", "zlib");
+    const std::string filename{std::string{"test-pbf-mmap-"} + compression + ".osm.pbf"};
+    write_pbf_test_file(filename, compression);
+
+    osmium::io::File file{filename};
+    file.set("pbf_mmap");
+
+    REQUIRE(count_objects(file, osmium::osm_entity_bits::all) == 9);
+    REQUIRE(count_objects(file, osmium::osm_entity_bits::way) == 1);
+
+    file.set("pbf_blob_index");
+    REQUIRE(count_objects(file, osmium::osm_entity_bits::nwr) == 9);
+    REQUIRE(count_objects(file, osmium::osm_entity_bits::relation) == 3);
+}
+
+TEST_CASE("Read PBF file using memory mapping from existing test file") {
+    osmium::io::File file{with_data_dir("t/io/deleted_nodes.osh.pbf")};
+    const auto count = count_objects(file, osmium::osm_entity_bits::all);
+    REQUIRE(count > 0);
+
+    file.set("pbf_mmap");
+    REQUIRE(count_objects(file, osmium::osm_entity_bits::all) == count);
+}
+
+TEST_CASE("Read PBF file from memory buffer") {
+    write_pbf_test_file("test-pbf-buffer.osm.pbf", "zlib");
+
+    const int fd = osmium::io::detail::open_for_reading("test-pbf-buffer.osm.pbf");
+    std::string data(osmium::util::file_size(fd), '\0');
+    REQUIRE(osmium::io::detail::read_exactly(fd, &*data.begin(), static_cast<unsigned int>(data.size())));
+    osmium::io::detail::reliable_close(fd);
+
+    const osmium::io::File file{data.data(), data.size(), "pbf"};
+    REQUIRE(count_objects(file, osmium::osm_entity_bits::all) == 9);
+}
+
+namespace {
+
+    // Create a PrimitiveBlock with more objects per group than libosmium
+    // would write: one group with DenseNodes and one with ways.
+    std::string create_large_primitive_block(int num) {
+        namespace OSMFormat = osmium::io::detail::OSMFormat;
+
+        std::string data;
+        protozero::pbf_builder<OSMFormat::PrimitiveBlock> pbf_primitive_block{data};
+
+        {
+            protozero::pbf_builder<OSMFormat::StringTable> pbf_string_table{pbf_primitive_block, OSMFormat::PrimitiveBlock::required_StringTable_stringtable};
+            for (const char* str : {"", "user", "amenity", "cafe", "name", "highway", "primary"}) {
+                pbf_string_table.add_bytes(OSMFormat::StringTable::repeated_bytes_s, str);
+            }
+        }
+
+        {
+            std::vector<int64_t> ids;
+            std::vector<int64_t> lats;
+            std::vector<int64_t> lons;
+            std::vector<int32_t> tags;
+            std::vector<int32_t> versions;
+            std::vector<int64_t> timestamps;
+            std::vector<int64_t> changesets;
+            std::vector<int32_t> uids;
+            std::vector<int32_t> user_sids;
+            std::vector<int32_t> visibles;
+
+            // everything except versions and visibles is delta encoded
+            for (int i = 1; i <= num; ++i) {
+                ids.push_back(1);
+                lats.push_back(i % 2 == 0 ? 1000 : -999);
+                lons.push_back(7);
+                if (i % 10 == 0) {
+                    tags.insert(tags.end(), {2, 3, 4, 1});
+                } else if (i % 3 == 0) {
+                    tags.insert(tags.end(), {4, 1});
+                }
+                tags.push_back(0);
+                versions.push_back(i % 5 + 1);
+                timestamps.push_back(i == 1 ? 1500000000 : 1);
+                changesets.push_back(i == 1 ? 1000 : (i % 2 == 0 ? 3 : -2));
+                uids.push_back(i == 1 ? 100 : 0);
+                user_sids.push_back(i == 1 ? 1 : 0);
+                visibles.push_back(i % 17 == 0 ? 0 : 1);
+            }
+
+            protozero::pbf_builder<OSMFormat::PrimitiveGroup> pbf_primitive_group{pbf_primitive_block, OSMFormat::PrimitiveBlock::repeated_PrimitiveGroup_primitivegroup};
+            protozero::pbf_builder<OSMFormat::DenseNodes> pbf_dense_nodes{pbf_primitive_group, OSMFormat::PrimitiveGroup::optional_DenseNodes_dense};
+            pbf_dense_nodes.add_packed_sint64(OSMFormat::DenseNodes::packed_sint64_id, ids.cbegin(), ids.cend());
+            {
+                protozero::pbf_builder<OSMFormat::DenseInfo> pbf_dense_info{pbf_dense_nodes, OSMFormat::DenseNodes::optional_DenseInfo_denseinfo};
+                pbf_dense_info.add_packed_int32(OSMFormat::DenseInfo::packed_int32_version, versions.cbegin(), versions.cend());
+                pbf_dense_info.add_packed_sint64(OSMFormat::DenseInfo::packed_sint64_timestamp, timestamps.cbegin(), timestamps.cend());
+                pbf_dense_info.add_packed_sint64(OSMFormat::DenseInfo::packed_sint64_changeset, changesets.cbegin(), changesets.cend());
+                pbf_dense_info.add_packed_sint32(OSMFormat::DenseInfo::packed_sint32_uid, uids.cbegin(), uids.cend());
+                pbf_dense_info.add_packed_sint32(OSMFormat::DenseInfo::packed_sint32_user_sid, user_sids.cbegin(), user_sids.cend());
+                pbf_dense_info.add_packed_bool(OSMFormat::DenseInfo::packed_bool_visible, visibles.cbegin(), visibles.cend());
+            }
+            pbf_dense_nodes.add_packed_sint64(OSMFormat::DenseNodes::packed_sint64_lat, lats.cbegin(), lats.cend());
+            pbf_dense_nodes.add_packed_sint64(OSMFormat::DenseNodes::packed_sint64_lon, lons.cbegin(), lons.cend());
+            pbf_dense_nodes.add_packed_int32(OSMFormat::DenseNodes::packed_int32_keys_vals, tags.cbegin(), tags.cend());
+        }
+
+        {
+            protozero::pbf_builder<OSMFormat::PrimitiveGroup> pbf_primitive_group{pbf_primitive_block, OSMFormat::PrimitiveBlock::repeated_PrimitiveGroup_primitivegroup};
+            for (int i = 1; i <= num; ++i) {
+                protozero::pbf_builder<OSMFormat::Way> pbf_way{pbf_primitive_group, OSMFormat::PrimitiveGroup::repeated_Way_ways};
+                pbf_way.add_int64(OSMFormat::Way::required_int64_id, i);
+                const std::vector<uint32_t> keys{i % 10 == 0 ? 2U : 5U};
+                const std::vector<uint32_t> vals{i % 10 == 0 ? 3U : 6U};
+                pbf_way.add_packed_uint32(OSMFormat::Way::packed_uint32_keys, keys.cbegin(), keys.cend());
+                pbf_way.add_packed_uint32(OSMFormat::Way::packed_uint32_vals, vals.cbegin(), vals.cend());
+                {
+                    protozero::pbf_builder<OSMFormat::Info> pbf_info{pbf_way, OSMFormat::Way::optional_Info_info};
+                    pbf_info.add_int32(OSMFormat::Info::optional_int32_version, i % 3 + 1);
+                    pbf_info.add_uint32(OSMFormat::Info::optional_uint32_user_sid, 1);
+                }
+                const std::vector<int64_t> refs{i, 1};
+                pbf_way.add_packed_sint64(OSMFormat::Way::packed_sint64_refs, refs.cbegin(), refs.cend());
+            }
+        }
+
+        return data;
+    }
+
+    // Get the contents of the buffer and all buffers nested in it in the
+    // order the Reader would return them.
+    std::string buffer_contents(osmium::memory::Buffer&& buffer, std::size_t* count = nullptr) {
+        std::string result;
+        const auto append = [&](const osmium::memory::Buffer& b) {
+            result.append(reinterpret_cast<const char*>(b.data()), b.committed());
+            if (count) {
+                *count += std::distance(b.cbegin<osmium::OSMObject>(), b.cend<osmium::OSMObject>());
+            }
+        };
+        while (buffer.has_nested_buffers()) {
+            append(*buffer.get_last_nested());
+        }
+        append(buffer);
+        return result;
+    }
+
+} // anonymous namespace
+
+TEST_CASE("Decode large PBF block in parts in the pool threads") {
+    const std::string block{create_large_primitive_block(50000)};
+    const protozero::data_view data{block.data(), block.size()};
+
+    osmium::thread::Pool pool{4};
+
+    const auto read_metadata = GENERATE(osmium::io::read_meta::yes, osmium::io::read_meta::no);
+    const auto read_types = GENERATE(osmium::osm_entity_bits::nwr, osmium::osm_entity_bits::way);
+
+    SECTION("Without filter") {
+        osmium::io::detail::PBFPrimitiveBlockDecoder decoder{data, read_types, read_metadata};
+        osmium::io::detail::PBFPrimitiveBlockDecoder parallel_decoder{data, read_types, read_metadata, osmium::io::tags_prefilter{}, osmium::io::location_prefilter{}, &pool};
+
+        const std::string expected{buffer_contents(decoder())};
+        std::size_t count = 0;
+        REQUIRE(buffer_contents(parallel_decoder(), &count) == expected);
+        REQUIRE(count == (read_types == osmium::osm_entity_bits::nwr ? 100000 : 50000));
+    }
+
+    SECTION("With filters") {
+        const osmium::io::tags_prefilter tags_filter{[](const char* key, const char* /*value*/) {
+            return !std::strcmp(key, "amenity");
+        }};
+        const osmium::io::location_prefilter location_filter{osmium::Box{0.0, 0.0, 1.0, 1.0}};
+
+        osmium::io::detail::PBFPrimitiveBlockDecoder decoder{data, read_types, read_metadata, tags_filter, location_filter};
+        osmium::io::detail::PBFPrimitiveBlockDecoder parallel_decoder{data, read_types, read_metadata, tags_filter, location_filter, &pool};
+
+        const std::string expected{buffer_contents(decoder())};
+        REQUIRE_FALSE(expected.empty());
+        REQUIRE(buffer_contents(parallel_decoder()) == expected);
+    }
+    SECTION("With buffer pool") {
+        osmium::memory::BufferPool buffer_pool;
+
+        osmium::io::detail::PBFPrimitiveBlockDecoder decoder{data, read_types, read_metadata};
+        osmium::io::detail::PBFPrimitiveBlockDecoder parallel_decoder{data, read_types, read_metadata, osmium::io::tags_prefilter{}, osmium::io::location_prefilter{}, &pool, &buffer_pool};
+
+        const std::string expected{buffer_contents(decoder())};
+        osmium::memory::Buffer buffer{parallel_decoder()};
+
+        // The buffer is large enough for all objects in the block and the
+        // buffers of the parts are back in the pool.
+        REQUIRE_FALSE(buffer.has_nested_buffers());
+        REQUIRE(buffer_pool.size() > 0);
+        REQUIRE(buffer_contents(std::move(buffer)) == expected);
+    }
+}
+
+TEST_CASE("Read PBF file with buffer pool") {
+    write_pbf_test_file("test-pbf-buffer-pool.osm.pbf", "zlib");
+
+    osmium::memory::BufferPool buffer_pool;
+
+    for (int run = 0; run < 2; ++run) {
+        osmium::io::Reader reader{"test-pbf-buffer-pool.osm.pbf", buffer_pool};
+        std::size_t count = 0;
+        while (osmium::memory::Buffer buffer = reader.read()) {
+            count += std::distance(buffer.cbegin<osmium::OSMObject>(), buffer.cend<osmium::OSMObject>());
+            buffer_pool.put(std::move(buffer));
+        }
+        reader.close();
+        REQUIRE(count == 9);
+        REQUIRE(buffer_pool.size() > 0);
+    }
+}
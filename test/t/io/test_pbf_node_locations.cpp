@@ -0,0 +1,131 @@
+#include "catch.hpp"
+
+#include "utils.hpp"
+
+#include <osmium/builder/attr.hpp>
+#include <osmium/handler/node_locations_for_ways.hpp>
+#include <osmium/index/map/sparse_mem_array.hpp>
+#include <osmium/io/pbf_input.hpp>
+#include <osmium/io/pbf_node_locations.hpp>
+#include <osmium/io/pbf_output.hpp>
+#include <osmium/io/reader.hpp>
+#include <osmium/io/writer.hpp>
+#include <osmium/osm/node.hpp>
+#include <osmium/visitor.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+    using location_list = std::vector<std::pair<osmium::object_id_type, osmium::Location>>;
+    using index_type = osmium::index::map::SparseMemArray<osmium::unsigned_object_id_type, osmium::Location>;
+
+    location_list read_with_reader(const osmium::io::File& file) {
+        location_list locations;
+        osmium::io::Reader reader{file, osmium::osm_entity_bits::node};
+        while (const osmium::memory::Buffer buffer = reader.read()) {
+            for (const auto& node : buffer.select<osmium::Node>()) {
+                locations.emplace_back(node.id(), node.location());
+            }
+        }
+        reader.close();
+        return locations;
+    }
+
+    location_list read_locations_only(const osmium::io::File& file) {
+        location_list locations;
+        osmium::io::for_each_pbf_node_location(file, [&](const osmium::object_id_type id, const osmium::Location location) {
+            locations.emplace_back(id, location);
+        });
+        return locations;
+    }
+
+    void write_many_nodes(const std::string& filename, const char* format, const char* sorting) {
+        using namespace osmium::builder::attr; // NOLINT(google-build-using-namespace)
+
+        osmium::memory::Buffer buffer{1024 * 1024, osmium::memory::Buffer::auto_grow::yes};
+        osmium::builder::add_node(buffer, _id(-5), _version(1), _location(2.0, 3.0));
+        for (osmium::object_id_type id = 1; id <= 20000; ++id) {
+            osmium::builder::add_node(buffer, _id(id), _version(1), _location(id * 0.0001, 1.0), _tag("n", std::to_string(id)));
+        }
+        for (osmium::object_id_type id = 1; id <= 10000; ++id) {
+            osmium::builder::add_way(buffer, _id(id), _version(1), _nodes({id, id + 1}));
+        }
+
+        osmium::io::Header header;
+        header.set("sorting", sorting);
+        osmium::io::Writer writer{osmium::io::File{filename, format}, header, osmium::io::overwrite::allow};
+        writer(std::move(buffer));
+        writer.close();
+    }
+
+} // anonymous namespace
+
+TEST_CASE("Read node locations from PBF test files") {
+    const char* filename = GENERATE("t/io/data_pbf_version-1.osm.pbf",
+                                    "t/io/data_pbf_version-1-densenodes.osm.pbf",
+                                    "t/io/deleted_nodes.osh.pbf");
+    const osmium::io::File file{with_data_dir(filename)};
+
+    const auto expected = read_with_reader(file);
+    REQUIRE_FALSE(expected.empty());
+    REQUIRE(read_locations_only(file) == expected);
+}
+
+TEST_CASE("Deleted nodes have undefined locations") {
+    const osmium::io::File file{with_data_dir("t/io/deleted_nodes.osh.pbf")};
+    const auto locations = read_locations_only(file);
+    REQUIRE(std::any_of(locations.cbegin(), locations.cend(), [](const location_list::value_type& l) {
+        return !l.second.valid();
+    }));
+}
+
+TEST_CASE("Read node locations from PBF file with many blocks") {
+    const char* format = GENERATE("pbf", "pbf,pbf_dense_nodes=false", "pbf,add_metadata=false");
+    const char* sorting = GENERATE("", "Type_then_ID");
+    write_many_nodes("test-pbf-node-locations.osm.pbf", format, sorting);
+    const osmium::io::File file{"test-pbf-node-locations.osm.pbf"};
+
+    const auto expected = read_with_reader(file);
+    REQUIRE(expected.size() == 20001);
+    REQUIRE(read_locations_only(file) == expected);
+}
+
+TEST_CASE("Fill node location indexes from PBF file") {
+    write_many_nodes("test-pbf-node-locations-index.osm.pbf", "pbf", "");
+    const osmium::io::File file{"test-pbf-node-locations-index.osm.pbf"};
+
+    index_type expected_pos;
+    index_type expected_neg;
+    {
+        osmium::handler::NodeLocationsForWays<index_type, index_type> handler{expected_pos, expected_neg};
+        osmium::io::Reader reader{file, osmium::osm_entity_bits::node};
+        osmium::apply(reader, handler);
+        reader.close();
+    }
+
+    index_type index_pos;
+    index_type index_neg;
+    osmium::io::read_pbf_node_locations(file, index_pos, index_neg);
+
+    REQUIRE(index_pos.size() == 20000);
+    REQUIRE(index_neg.size() == 1);
+    REQUIRE(index_neg.get(5) == osmium::Location(2.0, 3.0));
+    for (osmium::unsigned_object_id_type id = 1; id <= 20000; ++id) {
+        REQUIRE(index_pos.get(id) == expected_pos.get(id));
+    }
+
+    index_type index_only_pos;
+    osmium::io::read_pbf_node_locations(file, index_only_pos);
+    REQUIRE(index_only_pos.size() == 20000);
+    REQUIRE(index_only_pos.get(17) == expected_pos.get(17));
+}
+
+TEST_CASE("Reading node locations only works on PBF files") {
+    const osmium::io::File file{with_data_dir("t/io/data.osm")};
+    REQUIRE_THROWS_AS(osmium::io::for_each_pbf_node_location(file, [](osmium::object_id_type, osmium::Location) {}), std::invalid_argument);
+}
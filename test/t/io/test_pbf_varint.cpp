@@ -0,0 +1,99 @@
+#include "catch.hpp"
+
+#include <osmium/io/detail/pbf_varint.hpp>
+
+#include <protozero/exception.hpp>
+#include <protozero/varint.hpp>
+
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+    std::string encode(const std::vector<uint64_t>& values) {
+        std::string data;
+        for (const auto value : values) {
+            protozero::write_varint(std::back_inserter(data), value);
+        }
+        return data;
+    }
+
+    std::vector<uint64_t> decode(const std::string& data) {
+        std::vector<uint64_t> values;
+        osmium::io::detail::for_each_varint(data.data(), data.data() + data.size(), [&values](uint64_t value) {
+            values.push_back(value);
+        });
+        return values;
+    }
+
+} // anonymous namespace
+
+TEST_CASE("Decode no varints") {
+    REQUIRE(decode("").empty());
+}
+
+TEST_CASE("Decode long run of one-byte varints") {
+    std::vector<uint64_t> values;
+    for (uint64_t i = 0; i < 100; ++i) {
+        values.push_back(i);
+    }
+    REQUIRE(decode(encode(values)) == values);
+}
+
+TEST_CASE("Decode varints of all lengths") {
+    std::vector<uint64_t> values;
+    for (unsigned int bits = 0; bits <= 64; ++bits) {
+        const uint64_t value = bits == 64 ? ~0ULL : (1ULL << bits) - 1;
+        values.push_back(value);
+        values.push_back(1);
+        values.push_back(value);
+        values.push_back(value + 1);
+    }
+    REQUIRE(decode(encode(values)) == values);
+}
+
+TEST_CASE("Decode varints with one-byte varints at all offsets") {
+    for (std::size_t offset = 0; offset < 40; ++offset) {
+        std::vector<uint64_t> values(offset, 5);
+        values.push_back(300);
+        values.push_back(1ULL << 40U);
+        values.push_back(7);
+        values.push_back(~0ULL);
+        REQUIRE(decode(encode(values)) == values);
+    }
+}
+
+TEST_CASE("Decode truncated varint throws") {
+    std::string data = encode({1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 1ULL << 50U});
+    data.resize(data.size() - 1);
+    REQUIRE_THROWS_AS(decode(data), protozero::end_of_buffer_exception);
+
+    data = encode({1ULL << 50U});
+    data.resize(data.size() - 1);
+    REQUIRE_THROWS_AS(decode(data), protozero::end_of_buffer_exception);
+}
+
+TEST_CASE("Decode packed uint32 varints") {
+    const std::string data = encode({0, 1, 127, 128, 4294967295ULL});
+    std::vector<uint32_t> output{42};
+    osmium::io::detail::decode_packed_varints(protozero::data_view{data.data(), data.size()}, output);
+    REQUIRE(output == std::vector<uint32_t>({0, 1, 127, 128, 4294967295U}));
+}
+
+TEST_CASE("Decode packed delta encoded sint64 varints") {
+    const std::vector<int64_t> values{100, 101, 99, -5, 1LL << 40U, 0, -(1LL << 50U)};
+
+    std::vector<uint64_t> deltas;
+    int64_t last = 0;
+    for (const auto value : values) {
+        deltas.push_back(protozero::encode_zigzag64(value - last));
+        last = value;
+    }
+    const std::string data = encode(deltas);
+
+    std::vector<int64_t> output;
+    osmium::io::detail::decode_packed_sint64_delta(protozero::data_view{data.data(), data.size()}, output);
+    REQUIRE(output == values);
+}
@@ -5,7 +5,9 @@
 #include <osmium/handler.hpp>
 #include <osmium/io/any_compression.hpp>
 #include <osmium/io/any_input.hpp>
+#include <osmium/io/location_prefilter.hpp>
 #include <osmium/memory/buffer.hpp>
+#include <osmium/osm/object.hpp>
 #include <osmium/visitor.hpp>
 
 #include <iterator>
@@ -378,3 +380,24 @@ TEST_CASE("Reader with single object type per buffer") {
     check_buffer_counts("t/io/data-n5w1r0", {{5, 0, 0}, {0, 1, 0}}, osmium::io::buffers_type::single);
 }
 
+
+TEST_CASE("Reader with location prefilter on o5m file") {
+    const osmium::io::location_prefilter filter{osmium::Box{1.05, 0.5, 1.25, 1.5}};
+    osmium::io::Reader reader{with_data_dir("t/io/data-n5w1r3.osm.o5m"), filter};
+
+    std::vector<osmium::object_id_type> node_ids;
+    std::size_t others = 0;
+    while (const osmium::memory::Buffer buffer = reader.read()) {
+        for (const auto& object : buffer.select<osmium::OSMObject>()) {
+            if (object.type() == osmium::item_type::node) {
+                node_ids.push_back(object.id());
+            } else {
+                ++others;
+            }
+        }
+    }
+    reader.close();
+
+    REQUIRE(node_ids == std::vector<osmium::object_id_type>({11, 12}));
+    REQUIRE(others == 4);
+}
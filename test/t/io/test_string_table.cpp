@@ -129,3 +129,85 @@ TEST_CASE("Lots of strings in string table so chunk overflows") {
     REQUIRE(it == st.end());
 }
 
+
+TEST_CASE("Strings with same prefix in string table") {
+    osmium::io::detail::StringTable st;
+
+    REQUIRE(st.add("abcdefghijklmnop") == 1);
+    REQUIRE(st.add("abcdefghijklmno") == 2);
+    REQUIRE(st.add("abcdefghijklmnopq") == 3);
+    REQUIRE(st.add("abcdefgh") == 4);
+    REQUIRE(st.add("abcdefghijklmnop") == 1);
+    REQUIRE(st.add("abcdefghijklmno") == 2);
+    REQUIRE(st.add("abcdefghijklmnopq") == 3);
+    REQUIRE(st.add("abcdefgh") == 4);
+    REQUIRE(st.size() == 5);
+}
+
+TEST_CASE("String table finds strings after growing") {
+    osmium::io::detail::StringTable st{100};
+    const std::size_t bucket_count = st.get_bucket_count();
+
+    const int n = 10000;
+    for (int i = 0; i < n; ++i) {
+        const auto s = "k" + std::to_string(i);
+        REQUIRE(st.add(s.c_str()) == i + 1);
+    }
+    REQUIRE(st.get_bucket_count() > bucket_count);
+
+    // frequent short strings go through the cache
+    for (int j = 0; j < 3; ++j) {
+        REQUIRE(st.add("k0") == 1);
+        REQUIRE(st.add("k1") == 2);
+        REQUIRE(st.add("k17") == 18);
+    }
+
+    for (int i = 0; i < n; ++i) {
+        const auto s = "k" + std::to_string(i);
+        REQUIRE(st.add(s.c_str()) == i + 1);
+    }
+    REQUIRE(st.size() == n + 1);
+}
+
+TEST_CASE("String table bucket count is rounded up to power of two") {
+    const osmium::io::detail::StringTable st1;
+    REQUIRE(st1.get_bucket_count() >= 1);
+
+    const osmium::io::detail::StringTable st2{100, 1000};
+    REQUIRE(st2.get_bucket_count() == 1024);
+
+    const osmium::io::detail::StringTable st3{100, st2.get_bucket_count() - 1};
+    REQUIRE(st3.get_bucket_count() == 1024);
+}
+
+TEST_CASE("Add string with length to StringStore") {
+    osmium::io::detail::StringStore ss{100};
+
+    const char* s1 = ss.add("foobar", 3);
+    REQUIRE(std::string{s1} == "foo");
+}
+
+TEST_CASE("Frequency mapping of string table") {
+    osmium::io::detail::StringTable st;
+
+    st.add("once");
+    st.add("thrice");
+    st.add("twice");
+    st.add("thrice");
+    st.add("twice");
+    st.add("thrice");
+    st.add("also once");
+
+    REQUIRE(st.count(1) == 1);
+    REQUIRE(st.count(2) == 3);
+    REQUIRE(st.count(3) == 2);
+    REQUIRE(std::string{st.get(3)} == "twice");
+
+    const auto mapping = st.frequency_mapping();
+    REQUIRE(mapping.size() == 5);
+    REQUIRE(mapping[0] == 0);
+    REQUIRE(mapping[1] == 3); // once
+    REQUIRE(mapping[2] == 1); // thrice
+    REQUIRE(mapping[3] == 2); // twice
+    REQUIRE(mapping[4] == 4); // also once
+}
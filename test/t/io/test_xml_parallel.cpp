@@ -0,0 +1,176 @@
+#include "catch.hpp"
+
+#include "utils.hpp"
+
+#include <osmium/builder/attr.hpp>
+#include <osmium/io/xml_input.hpp>
+#include <osmium/io/xml_output.hpp>
+#include <osmium/memory/buffer.hpp>
+#include <osmium/osm/object.hpp>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+    // Create a file big enough to be split into several chunks.
+    void write_test_file(const std::string& filename, const char* format) {
+        using namespace osmium::builder::attr; // NOLINT(google-build-using-namespace)
+
+        osmium::memory::Buffer buffer{1024UL * 1024UL, osmium::memory::Buffer::auto_grow::yes};
+        for (int i = 1; i <= 30000; ++i) {
+            osmium::builder::add_node(buffer,
+                _id(i),
+                _version(i % 3 + 1),
+                _visible(i % 7 != 0),
+                _user("some user"),
+                _location(i * 0.001, i * 0.002),
+                _tag("name", "node " + std::to_string(i)));
+        }
+        for (int i = 1; i <= 5000; ++i) {
+            osmium::builder::add_way(buffer,
+                _id(i),
+                _version(i % 2 + 1),
+                _nodes({i, i + 1, i + 2}),
+                _tag("highway", "residential"));
+        }
+        for (int i = 1; i <= 500; ++i) {
+            osmium::builder::add_relation(buffer,
+                _id(i),
+                _version(1),
+                _member(osmium::item_type::way, i, "outer"),
+                _tag("type", "multipolygon"));
+        }
+
+        osmium::io::File file{filename, format};
+        osmium::io::Header header;
+        header.set("generator", "test");
+        header.add_box(osmium::Box{1.0, 2.0, 3.0, 4.0});
+        osmium::io::Writer writer{file, header, osmium::io::overwrite::allow};
+        writer(std::move(buffer));
+        writer.close();
+    }
+
+    struct read_result {
+        std::vector<std::string> objects;
+        std::size_t num_buffers = 0;
+        std::string generator;
+        std::size_t num_boxes = 0;
+    };
+
+    read_result read_objects(const osmium::io::File& file, osmium::osm_entity_bits::type entities = osmium::osm_entity_bits::all) {
+        read_result result;
+        osmium::io::Reader reader{file, entities};
+        result.generator = reader.header().get("generator");
+        result.num_boxes = reader.header().boxes().size();
+        while (const osmium::memory::Buffer buffer = reader.read()) {
+            ++result.num_buffers;
+            for (const auto& object : buffer.select<osmium::OSMObject>()) {
+                std::string str{osmium::item_type_to_char(object.type())};
+                str += std::to_string(object.id());
+                str += 'v';
+                str += std::to_string(object.version());
+                str += object.visible() ? 'V' : 'D';
+                str += object.user();
+                for (const auto& tag : object.tags()) {
+                    str += ' ';
+                    str += tag.key();
+                    str += '=';
+                    str += tag.value();
+                }
+                result.objects.push_back(std::move(str));
+            }
+        }
+        reader.close();
+        return result;
+    }
+
+} // anonymous namespace
+
+TEST_CASE("Parallel XML parsing gives same result as sequential parsing") {
+    const char* format = GENERATE("osm", "osc");
+    const temp_file tmp{(std::string{"test-xml-parallel."} + format).c_str()};
+    write_test_file(tmp.name(), format);
+
+    const osmium::io::File file{tmp.name(), format};
+    osmium::io::File file_parallel{tmp.name(), format};
+    file_parallel.set("xml_parallel");
+
+    const auto expected = read_objects(file);
+    const auto result = read_objects(file_parallel);
+
+    REQUIRE(expected.objects.size() == 35500);
+    REQUIRE(result.objects == expected.objects);
+    REQUIRE(result.num_buffers > 1);
+    REQUIRE(result.generator == expected.generator);
+    REQUIRE(result.num_boxes == expected.num_boxes);
+}
+
+TEST_CASE("Parallel XML parsing of some entity types") {
+    const temp_file tmp{"test-xml-parallel-types.osm"};
+    write_test_file(tmp.name(), "osm");
+    osmium::io::File file{tmp.name()};
+    file.set("xml_parallel");
+
+    REQUIRE(read_objects(file, osmium::osm_entity_bits::way).objects.size() == 5000);
+    REQUIRE(read_objects(file, osmium::osm_entity_bits::node | osmium::osm_entity_bits::relation).objects.size() == 30500);
+
+    osmium::io::Reader reader{file, osmium::osm_entity_bits::nothing};
+    REQUIRE(reader.header().get("generator") == "test");
+    REQUIRE_FALSE(reader.read());
+    reader.close();
+}
+
+TEST_CASE("Parallel XML parsing of small file") {
+    osmium::io::File file{with_data_dir("t/io/data.osm")};
+    file.set("xml_parallel");
+
+    const auto result = read_objects(file);
+    REQUIRE_FALSE(result.objects.empty());
+    REQUIRE(result.objects == read_objects(osmium::io::File{with_data_dir("t/io/data.osm")}).objects);
+}
+
+TEST_CASE("Parallel XML parsing of file without objects") {
+    const temp_file tmp{"test-xml-parallel-empty.osm"};
+    osmium::io::File file{tmp.name()};
+    osmium::io::Writer writer{file, osmium::io::overwrite::allow};
+    writer.close();
+    file.set("xml_parallel");
+
+    REQUIRE(read_objects(file).objects.empty());
+}
+
+TEST_CASE("Parallel XML parsing of broken file") {
+    const std::string data{"<osm version=\"0.6\"><node id=\"1\"><foo/></node></osm>"};
+    osmium::io::File broken{data.data(), data.size(), "osm"};
+    broken.set("xml_parallel");
+
+    osmium::io::Reader reader{broken};
+    REQUIRE_THROWS_AS(reader.read(), osmium::xml_error);
+    reader.close();
+}
+
+TEST_CASE("Parallel XML parsing of chunk with many buffers") {
+    // With buffers of a single type, every change of the type starts a
+    // new buffer, so one chunk creates more buffers than fit into the
+    // default size of a queue.
+    std::string data{"<osm version=\"0.6\">\n"};
+    for (int i = 1; i <= 3000; ++i) {
+        data += "<node id=\"" + std::to_string(i) + "\" lat=\"1\" lon=\"1\"/>\n";
+        data += "<way id=\"" + std::to_string(i) + "\"/>\n";
+    }
+    data += "</osm>\n";
+
+    osmium::io::File file{data.data(), data.size(), "osm"};
+    file.set("xml_parallel");
+
+    osmium::io::Reader reader{file, osmium::io::buffers_type::single};
+    std::size_t count = 0;
+    while (const osmium::memory::Buffer buffer = reader.read()) {
+        count += static_cast<std::size_t>(std::distance(buffer.begin(), buffer.end()));
+    }
+    reader.close();
+
+    REQUIRE(count == 6000);
+}
@@ -0,0 +1,104 @@
+#include "catch.hpp"
+
+#include <osmium/builder/attr.hpp>
+#include <osmium/memory/buffer_pool.hpp>
+
+#include <utility>
+
+using namespace osmium::builder::attr; // NOLINT(google-build-using-namespace)
+
+TEST_CASE("Buffer pool creates new buffers if it is empty") {
+    osmium::memory::BufferPool pool;
+    REQUIRE(pool.size() == 0);
+
+    auto buffer = pool.get(1000);
+    REQUIRE(buffer);
+    REQUIRE(buffer.capacity() >= 1000);
+    REQUIRE(buffer.committed() == 0);
+    REQUIRE(pool.size() == 0);
+}
+
+TEST_CASE("Buffer pool reuses memory") {
+    osmium::memory::BufferPool pool;
+
+    auto buffer = pool.get(1000);
+    osmium::builder::add_node(buffer, _id(1));
+    const auto* data = buffer.data();
+    const auto capacity = buffer.capacity();
+
+    pool.put(std::move(buffer));
+    REQUIRE_FALSE(buffer); // NOLINT(bugprone-use-after-move,hicpp-invalid-access-moved,clang-analyzer-cplusplus.Move)
+    REQUIRE(pool.size() == 1);
+
+    SECTION("small enough") {
+        auto new_buffer = pool.get(500, osmium::memory::Buffer::auto_grow::no);
+        REQUIRE(pool.size() == 0);
+        REQUIRE(new_buffer.data() == data);
+        REQUIRE(new_buffer.capacity() == capacity);
+        REQUIRE(new_buffer.committed() == 0);
+        REQUIRE(new_buffer.written() == 0);
+        REQUIRE(new_buffer.begin() == new_buffer.end());
+
+        // auto_grow setting of the new buffer is used
+        REQUIRE_THROWS_AS(new_buffer.reserve_space(capacity + 8), osmium::buffer_is_full);
+    }
+
+    SECTION("too large") {
+        auto new_buffer = pool.get(capacity + 1000);
+        REQUIRE(pool.size() == 1);
+        REQUIRE(new_buffer.capacity() >= capacity + 1000);
+    }
+}
+
+TEST_CASE("Buffer pool uses smallest block that is large enough") {
+    osmium::memory::BufferPool pool;
+
+    pool.put(osmium::memory::Buffer{4000});
+    pool.put(osmium::memory::Buffer{1000});
+    pool.put(osmium::memory::Buffer{2000});
+    REQUIRE(pool.size() == 3);
+
+    REQUIRE(pool.get(1500).capacity() == 2000);
+    REQUIRE(pool.get(1500).capacity() == 4000);
+    REQUIRE(pool.size() == 1);
+
+    pool.clear();
+    REQUIRE(pool.size() == 0);
+}
+
+TEST_CASE("Buffer pool takes memory of nested buffers") {
+    osmium::memory::BufferPool pool;
+
+    osmium::memory::Buffer buffer{128, osmium::memory::Buffer::auto_grow::internal};
+    for (int i = 1; i < 100; ++i) {
+        osmium::builder::add_node(buffer, _id(i));
+    }
+    REQUIRE(buffer.has_nested_buffers());
+
+    pool.put(std::move(buffer));
+    REQUIRE(pool.size() > 1);
+}
+
+TEST_CASE("Buffer pool ignores invalid buffers and external memory") {
+    osmium::memory::BufferPool pool;
+
+    pool.put(osmium::memory::Buffer{});
+
+    alignas(osmium::memory::align_bytes) unsigned char data[64];
+    pool.put(osmium::memory::Buffer{data, sizeof(data), 0});
+
+    REQUIRE(pool.size() == 0);
+}
+
+TEST_CASE("Buffer pool keeps only the largest blocks") {
+    osmium::memory::BufferPool pool{2};
+
+    pool.put(osmium::memory::Buffer{1000});
+    pool.put(osmium::memory::Buffer{3000});
+    pool.put(osmium::memory::Buffer{2000});
+    pool.put(osmium::memory::Buffer{500});
+    REQUIRE(pool.size() == 2);
+
+    REQUIRE(pool.get(100).capacity() == 2000);
+    REQUIRE(pool.get(100).capacity() == 3000);
+}
@@ -45,6 +45,16 @@ TEST_CASE("Tags filter") {
         REQUIRE_FALSE(filter(*std::next(tag_list2.begin())));
     }
 
+    SECTION("Filter on key and value strings") {
+        osmium::TagsFilter filter;
+        filter.add_rule(true, "highway");
+        filter.add_rule(true, "amenity", "restaurant");
+        REQUIRE(filter("highway", "primary"));
+        REQUIRE(filter("amenity", "restaurant"));
+        REQUIRE_FALSE(filter("amenity", "cafe"));
+        REQUIRE_FALSE(filter("name", "Main Street"));
+    }
+
     SECTION("Filter based on key only: fail") {
         osmium::TagsFilter filter;
         filter.add_rule(true, osmium::StringMatcher::equal{"foo"});
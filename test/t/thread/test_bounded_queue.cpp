@@ -0,0 +1,149 @@
+#include "catch.hpp"
+
+#include <osmium/thread/bounded_queue.hpp>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("Basic use of bounded queue") {
+    osmium::thread::BoundedQueue<int> queue;
+    REQUIRE(queue.empty());
+    queue.push(22);
+    REQUIRE_FALSE(queue.empty());
+    REQUIRE(queue.size() == 1);
+    int value = 0;
+    queue.wait_and_pop(value);
+    REQUIRE(value == 22);
+    REQUIRE(queue.empty());
+}
+
+TEST_CASE("Bounded queue can have max elements and can be named") {
+    const osmium::thread::BoundedQueue<int> queue{100, "Queue of max size 100"};
+    REQUIRE(queue.capacity() == 128);
+}
+
+TEST_CASE("Bounded queue without max size is unbounded") {
+    osmium::thread::BoundedQueue<int> queue;
+    REQUIRE(queue.capacity() == 0);
+
+    constexpr const int num_values = 5000;
+    for (int i = 0; i < num_values; ++i) {
+        queue.push(i);
+    }
+    REQUIRE(queue.size() == num_values);
+
+    for (int i = 0; i < num_values; ++i) {
+        int value = -1;
+        REQUIRE(queue.try_pop(value));
+        REQUIRE(value == i);
+        if (i == num_values / 2) {
+            // Elements pushed now must come after the older ones.
+            queue.push(num_values);
+        }
+    }
+    int value = -1;
+    REQUIRE(queue.try_pop(value));
+    REQUIRE(value == num_values);
+    REQUIRE(queue.empty());
+}
+
+TEST_CASE("Bounded queue keeps order of elements") {
+    osmium::thread::BoundedQueue<int> queue{4};
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            queue.push(i * 10 + j);
+        }
+        REQUIRE(queue.size() == 4);
+        for (int j = 0; j < 4; ++j) {
+            int value = 0;
+            REQUIRE(queue.try_pop(value));
+            REQUIRE(value == i * 10 + j);
+        }
+        int value = 0;
+        REQUIRE_FALSE(queue.try_pop(value));
+    }
+}
+
+TEST_CASE("When bounded queue is shut down, nothing goes in or out") {
+    osmium::thread::BoundedQueue<std::string> queue;
+    REQUIRE(queue.in_use());
+    REQUIRE(queue.empty());
+    queue.push("foo");
+    queue.push("bar");
+    queue.push("baz");
+    REQUIRE(queue.size() == 3);
+
+    std::string value;
+
+    queue.wait_and_pop(value);
+    REQUIRE(value == "foo");
+    REQUIRE(queue.size() == 2);
+    REQUIRE(queue.in_use());
+    queue.shutdown();
+    REQUIRE_FALSE(queue.in_use());
+    REQUIRE(queue.empty());
+    queue.push("lost");
+    REQUIRE(queue.empty());
+
+    value.clear();
+    queue.try_pop(value);
+    REQUIRE(value.empty());
+    queue.wait_and_pop(value);
+    REQUIRE(value.empty());
+}
+
+TEST_CASE("Shutting down bounded queue wakes up waiting consumer") {
+    osmium::thread::BoundedQueue<int> queue{2};
+    int value = 0;
+    std::thread consumer{[&] {
+        queue.wait_and_pop(value);
+    }};
+    queue.shutdown();
+    consumer.join();
+    REQUIRE(value == 0);
+}
+
+TEST_CASE("Bounded queue with several producers and consumers") {
+    const std::size_t max_size = GENERATE(4, 0);
+    osmium::thread::BoundedQueue<int> queue{max_size};
+    constexpr const int num_producers = 3;
+    constexpr const int num_values = 10000;
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < num_producers; ++p) {
+        producers.emplace_back([&queue] {
+            for (int i = 1; i <= num_values; ++i) {
+                queue.push(i);
+            }
+        });
+    }
+
+    std::vector<long> sums(2, 0);
+    std::vector<std::thread> consumers;
+    for (std::size_t c = 0; c < sums.size(); ++c) {
+        consumers.emplace_back([&queue, &sums, c] {
+            while (true) {
+                int value = 0;
+                queue.wait_and_pop(value);
+                if (value == 0) { // end marker
+                    return;
+                }
+                sums[c] += value;
+            }
+        });
+    }
+
+    for (auto& thread : producers) {
+        thread.join();
+    }
+    for (std::size_t c = 0; c < sums.size(); ++c) {
+        queue.push(0);
+    }
+    for (auto& thread : consumers) {
+        thread.join();
+    }
+
+    REQUIRE(sums[0] + sums[1] == static_cast<long>(num_producers) * num_values * (num_values + 1) / 2);
+    REQUIRE(queue.empty());
+}
@@ -0,0 +1,32 @@
+#include "catch.hpp"
+
+#include <osmium/thread/numa.hpp>
+
+TEST_CASE("NUMA nodes have CPUs") {
+    const auto nodes = osmium::thread::get_numa_nodes();
+    for (const auto& node : nodes) {
+        REQUIRE(node.id >= 0);
+        REQUIRE_FALSE(node.cpus.empty());
+    }
+}
+
+TEST_CASE("reading NUMA nodes from non-existing directory") {
+    REQUIRE(osmium::thread::detail::read_numa_nodes("does-not-exist").empty());
+}
+
+TEST_CASE("create one pool per NUMA node") {
+    const auto pools = osmium::thread::create_numa_node_pools(1);
+    REQUIRE_FALSE(pools.empty());
+
+    const auto nodes = osmium::thread::get_numa_nodes();
+    if (!nodes.empty()) {
+        REQUIRE(pools.size() == nodes.size());
+        REQUIRE(pools[0]->cpus() == nodes[0].cpus);
+    }
+
+    for (const auto& pool : pools) {
+        REQUIRE(pool->num_threads() == 1);
+        auto future = pool->submit([]() { return 17; });
+        REQUIRE(future.get() == 17);
+    }
+}
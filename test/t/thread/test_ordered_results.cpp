@@ -0,0 +1,63 @@
+#include "catch.hpp"
+
+#include <osmium/thread/ordered_results.hpp>
+#include <osmium/thread/pool.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST_CASE("ordered results are handed on in submission order") {
+    osmium::thread::Pool pool{4};
+    std::vector<int> output;
+
+    {
+        osmium::thread::OrderedResults<int> results{pool};
+        const auto collect = [&output](int&& value) {
+            output.push_back(value);
+        };
+
+        for (int i = 0; i < 100; ++i) {
+            results.submit([i]() {
+                // Later tasks finish earlier.
+                std::this_thread::sleep_for(std::chrono::microseconds{(100 - i) * 10});
+                return i;
+            }, collect);
+            REQUIRE(results.size() <= 2 * static_cast<std::size_t>(pool.num_threads()) + 1);
+        }
+        results.output_all(collect);
+        REQUIRE(results.empty());
+    }
+
+    REQUIRE(output.size() == 100);
+    for (int i = 0; i < 100; ++i) {
+        REQUIRE(output[i] == i);
+    }
+}
+
+TEST_CASE("ordered results rethrow exceptions and wait for running tasks") {
+    osmium::thread::Pool pool{2};
+    std::atomic<int> done{0};
+
+    const auto ignore = [](int&& /*value*/) {};
+    {
+        osmium::thread::OrderedResults<int> results{pool};
+        results.submit([]() -> int {
+            throw std::runtime_error{"error"};
+        }, ignore);
+        for (int i = 0; i < 3; ++i) {
+            results.submit([&done]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds{10});
+                ++done;
+                return 1;
+            }, ignore);
+        }
+        REQUIRE_THROWS_AS(results.output_oldest(ignore), std::runtime_error);
+    }
+
+    // The destructor has waited for the other tasks.
+    REQUIRE(done == 3);
+}
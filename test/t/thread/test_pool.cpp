@@ -2,7 +2,15 @@
 
 #include <osmium/thread/pool.hpp>
 
+#include <atomic>
+#include <future>
+#include <mutex>
 #include <stdexcept>
+#include <vector>
+
+#if defined(__linux__)
+# include <sched.h>
+#endif
 
 struct test_job_with_result {
     int operator()() const {
@@ -16,6 +24,27 @@ struct test_job_throw {
     }
 };
 
+// Returns the first CPU this process is allowed to run on or -1 if there
+// is none. On systems other than Linux the affinity of the pool threads
+// isn't set, so any CPU number will do.
+static int first_available_cpu() {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+        return -1;
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &set)) {
+            return cpu;
+        }
+    }
+    return -1;
+#else
+    return 0;
+#endif
+}
+
 TEST_CASE("number of threads in pool") {
 
     // hardcoded setting
@@ -104,3 +133,177 @@ TEST_CASE("can throw from job in user provided thread pool") {
     REQUIRE_THROWS_AS(future.get(), std::runtime_error);
 }
 
+
+TEST_CASE("tasks with higher priority run first") {
+    osmium::thread::Pool pool{1};
+
+    // Block the only worker thread until all tasks are queued.
+    std::promise<void> start;
+    std::shared_future<void> started{start.get_future()};
+    auto blocker = pool.submit([started]() { started.wait(); });
+
+    std::mutex mutex;
+    std::vector<int> order;
+    auto add = [&](int n) {
+        return [&mutex, &order, n]() {
+            const std::lock_guard<std::mutex> lock{mutex};
+            order.push_back(n);
+        };
+    };
+
+    std::vector<std::future<void>> futures;
+    futures.push_back(pool.submit(add(1), osmium::thread::task_priority::low));
+    futures.push_back(pool.submit(add(2), osmium::thread::task_priority::normal));
+    futures.push_back(pool.submit(add(3), osmium::thread::task_priority::high));
+    futures.push_back(pool.submit(add(4), osmium::thread::task_priority::high));
+    futures.push_back(pool.submit(add(5)));
+
+    start.set_value();
+    blocker.get();
+    for (auto& future : futures) {
+        future.get();
+    }
+
+    const std::vector<int> expected{3, 4, 2, 5, 1};
+    REQUIRE(order == expected);
+}
+
+TEST_CASE("run many tasks in pool") {
+    osmium::thread::Pool pool{4, 3};
+
+    std::atomic<int> sum{0};
+    std::vector<std::future<int>> futures;
+    for (int i = 1; i <= 1000; ++i) {
+        futures.push_back(pool.submit([i, &sum]() {
+            sum += i;
+            return i;
+        }));
+    }
+
+    int results = 0;
+    for (auto& future : futures) {
+        results += future.get();
+    }
+
+    REQUIRE(results == 500500);
+    REQUIRE(sum == 500500);
+    REQUIRE(pool.queue_empty());
+}
+
+TEST_CASE("tasks can submit tasks and help while waiting") {
+    osmium::thread::Pool pool{2, 2};
+
+    // Each outer task waits for inner tasks. Without helping this would
+    // deadlock, because all workers would be waiting.
+    std::vector<std::future<int>> futures;
+    for (int i = 0; i < 10; ++i) {
+        futures.push_back(pool.submit([&pool]() {
+            std::vector<std::future<int>> inner;
+            for (int j = 0; j < 10; ++j) {
+                inner.push_back(pool.submit(test_job_with_result{}));
+            }
+            int sum = 0;
+            for (auto& future : inner) {
+                pool.help_while_waiting(future);
+                sum += future.get();
+            }
+            return sum;
+        }));
+    }
+
+    for (auto& future : futures) {
+        REQUIRE(future.get() == 420);
+    }
+}
+
+TEST_CASE("run pending task in current thread") {
+    osmium::thread::Pool pool{1};
+
+    std::promise<void> running;
+    std::promise<void> start;
+    std::shared_future<void> started{start.get_future()};
+    auto blocker = pool.submit([&running, started]() {
+        running.set_value();
+        started.wait();
+    });
+    running.get_future().wait();
+
+    auto future = pool.submit(test_job_with_result{});
+    REQUIRE(pool.queue_size() == 1);
+    REQUIRE(pool.run_pending_task());
+    REQUIRE_FALSE(pool.run_pending_task());
+    REQUIRE(future.get() == 42);
+
+    start.set_value();
+    blocker.get();
+}
+
+TEST_CASE("queued tasks are run before pool shuts down") {
+    std::atomic<int> count{0};
+    {
+        osmium::thread::Pool pool{2, 100};
+        for (int i = 0; i < 50; ++i) {
+            pool.submit([&count]() { ++count; });
+        }
+    }
+    REQUIRE(count == 50);
+}
+
+TEST_CASE("pool restricted to CPUs") {
+    const int cpu = first_available_cpu();
+    if (cpu < 0) {
+        WARN("no CPU available, test skipped");
+        return;
+    }
+
+    osmium::thread::Pool pool{0, 0, {cpu}};
+    REQUIRE(pool.cpus() == std::vector<int>{cpu});
+    REQUIRE(pool.num_threads() == 1);
+
+    auto future = pool.submit(test_job_with_result{});
+    REQUIRE(future.get() == 42);
+}
+
+TEST_CASE("run pending task only with minimum priority") {
+    osmium::thread::Pool pool{1};
+
+    std::promise<void> running;
+    std::promise<void> start;
+    std::shared_future<void> started{start.get_future()};
+    auto blocker = pool.submit([&running, started]() {
+        running.set_value();
+        started.wait();
+    });
+    running.get_future().wait();
+
+    auto low = pool.submit(test_job_with_result{}, osmium::thread::task_priority::low);
+    auto high = pool.submit(test_job_with_result{}, osmium::thread::task_priority::high);
+    REQUIRE(pool.queue_size() == 2);
+
+    // Outside the pool only tasks with at least the priority of the
+    // awaited task are run while waiting.
+    pool.help_while_waiting(high, osmium::thread::task_priority::high);
+    REQUIRE(high.get() == 42);
+    REQUIRE(pool.queue_size() == 1);
+    REQUIRE_FALSE(pool.run_pending_task(osmium::thread::task_priority::normal));
+    REQUIRE(pool.run_pending_task());
+    REQUIRE(low.get() == 42);
+
+    start.set_value();
+    blocker.get();
+}
+
+TEST_CASE("many submits from outside the pool with small queue") {
+    osmium::thread::Pool pool{2, 1};
+
+    std::vector<std::future<int>> futures;
+    for (int i = 0; i < 1000; ++i) {
+        futures.push_back(pool.submit(test_job_with_result{}));
+    }
+
+    int sum = 0;
+    for (auto& future : futures) {
+        sum += future.get();
+    }
+    REQUIRE(sum == 42000);
+}
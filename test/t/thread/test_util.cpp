@@ -4,7 +4,9 @@
 
 #include <future>
 #include <stdexcept>
+#include <thread>
 #include <type_traits>
+#include <vector>
 
 TEST_CASE("check_for_exception") {
     std::promise<int> p;
@@ -59,3 +61,40 @@ TEST_CASE("valid thread_handler") {
     REQUIRE(foo == 5);
 }
 
+
+TEST_CASE("parse_cpu_list") {
+    using osmium::thread::parse_cpu_list;
+
+    REQUIRE(parse_cpu_list(nullptr).empty());
+    REQUIRE(parse_cpu_list("").empty());
+    REQUIRE(parse_cpu_list("0") == std::vector<int>{0});
+    REQUIRE(parse_cpu_list("0-3") == (std::vector<int>{0, 1, 2, 3}));
+    REQUIRE(parse_cpu_list("0-1,8,10-11\n") == (std::vector<int>{0, 1, 8, 10, 11}));
+    REQUIRE(parse_cpu_list("5,1-2,2") == (std::vector<int>{1, 2, 5}));
+    REQUIRE(parse_cpu_list("1,") == std::vector<int>{1});
+}
+
+TEST_CASE("parse_cpu_list with invalid input") {
+    using osmium::thread::parse_cpu_list;
+
+    REQUIRE(parse_cpu_list("x").empty());
+    REQUIRE(parse_cpu_list("-1").empty());
+    REQUIRE(parse_cpu_list("3-1").empty());
+    REQUIRE(parse_cpu_list("1-").empty());
+    REQUIRE(parse_cpu_list("1;2").empty());
+}
+
+TEST_CASE("set_thread_affinity with empty CPU list fails") {
+    REQUIRE_FALSE(osmium::thread::set_thread_affinity({}));
+}
+
+#ifdef __linux__
+TEST_CASE("set_thread_affinity to first CPU") {
+    bool result = false;
+    std::thread thread{[&result]() {
+        result = osmium::thread::set_thread_affinity({0});
+    }};
+    thread.join();
+    REQUIRE(result);
+}
+#endif
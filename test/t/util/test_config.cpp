@@ -33,6 +33,14 @@ TEST_CASE("get_pool_threads") {
     REQUIRE(osmium::config::get_pool_threads() == 2);
 }
 
+TEST_CASE("get_pool_cpus") {
+    osmium::detail::env = nullptr;
+    REQUIRE(osmium::config::get_pool_cpus().empty());
+    REQUIRE(osmium::detail::name == "OSMIUM_POOL_CPUS");
+    osmium::detail::env = "0-3,8";
+    REQUIRE(osmium::config::get_pool_cpus() == "0-3,8");
+}
+
 TEST_CASE("use_pool_threads_for_pbf_parsing") {
     osmium::detail::env = nullptr;
     REQUIRE(osmium::config::use_pool_threads_for_pbf_parsing());
@@ -3,8 +3,11 @@
 #include <osmium/util/file.hpp>
 #include <osmium/util/memory_mapping.hpp>
 
+#include <cstdint>
 #include <cstdlib>
 #include <limits>
+#include <memory>
+#include <system_error>
 #include <utility>
 
 #if defined(_MSC_VER) || (defined(__GNUC__) && defined(_WIN32))
@@ -408,3 +411,69 @@ TEST_CASE("Anonymous memory mapping class: remapping to smaller size should work
 }
 #endif
 
+TEST_CASE("Huge page size is known") {
+    const auto size = osmium::MemoryMapping::huge_page_size();
+    REQUIRE(size > 0);
+    REQUIRE(size % osmium::get_pagesize() == 0);
+}
+
+#ifdef __linux__
+TEST_CASE("Anonymous mapping: memory mapping with flags should work") {
+    const auto flags = osmium::memory_mapping_flags::huge_pages |
+                       osmium::memory_mapping_flags::populate |
+                       osmium::memory_mapping_flags::random_access |
+                       osmium::memory_mapping_flags::will_need;
+
+    osmium::MemoryMapping mapping{1000, osmium::MemoryMapping::mapping_mode::write_private, -1, 0, flags};
+    REQUIRE(mapping.flags() == flags);
+    REQUIRE(mapping.size() == 1000);
+
+    auto* addr1 = mapping.get_addr<int>();
+    *addr1 = 42;
+
+    mapping.resize(8000);
+    REQUIRE(mapping.flags() == flags);
+
+    const auto* addr2 = mapping.get_addr<int>();
+    REQUIRE(*addr2 == 42);
+}
+
+TEST_CASE("Anonymous mapping: memory mapping with explicit huge pages") {
+    std::unique_ptr<osmium::AnonymousMemoryMapping> mapping;
+    try {
+        mapping.reset(new osmium::AnonymousMemoryMapping{1000, osmium::memory_mapping_flags::huge_tlb});
+    } catch (const std::system_error&) {
+        // There are no reserved huge pages on this system.
+        return;
+    }
+    REQUIRE(mapping->size() == 1000);
+
+    auto* addr1 = mapping->get_addr<int>();
+    *addr1 = 42;
+
+    mapping->resize(osmium::MemoryMapping::huge_page_size() + 1000);
+
+    const auto* addr2 = mapping->get_addr<int>();
+    REQUIRE(*addr2 == 42);
+}
+#endif
+
+TEST_CASE("Typed file-based mapping with flags should work") {
+    char filename[] = "test_mmap_flags_XXXXXX";
+    const int fd = mkstemp(filename);
+    REQUIRE(fd > 0);
+
+    {
+        osmium::TypedMemoryMapping<uint32_t> mapping{1000, osmium::MemoryMapping::mapping_mode::write_shared, fd, 0, osmium::memory_mapping_flags::random_access};
+        REQUIRE(mapping.flags() == osmium::memory_mapping_flags::random_access);
+        mapping.begin()[999] = 17;
+
+        mapping.resize(2000);
+        REQUIRE(mapping.begin()[999] == 17);
+    }
+
+    REQUIRE(osmium::file_size(fd) == 2000 * sizeof(uint32_t));
+
+    REQUIRE(0 == close(fd));
+    REQUIRE(0 == unlink(filename));
+}